@@ -31,6 +31,9 @@ struct {
   // Sorted by how recently the buffer was used.
   // head.next is most recent, head.prev is least. head->prev是LRU块
   struct buf head; // head没有数据，只是一个头指针
+
+  // for bpeek() of a block that isn't cached; not in the list.
+  struct buf raw;
 } bcache;
 
 void
@@ -38,7 +41,7 @@ binit(void)
 {
   struct buf *b;
 
-  initlock(&bcache.lock, "bcache");
+  initticketlock(&bcache.lock, "bcache");
 
   // Create linked list of buffers
   bcache.head.prev = &bcache.head;
@@ -50,6 +53,7 @@ binit(void)
     bcache.head.next->prev = b;
     bcache.head.next = b;
   }
+  initsleeplock(&bcache.raw.lock, "rawbuf");
 }
 
 // Look through buffer cache for block on device dev.
@@ -150,4 +154,38 @@ bunpin(struct buf *b) {
   release(&bcache.lock);
 }
 
+// Copy block blockno into dst, for the page cache (pcache.c).
+// If the block is cached, the cached copy may be newer than
+// the disk, so copy that; otherwise read it from the disk
+// without caching it, so that file data doesn't push
+// metadata out of the cache.
+void
+bpeek(uint dev, uint blockno, char *dst)
+{
+  struct buf *b;
+
+  acquire(&bcache.lock);
+  for(b = bcache.head.next; b != &bcache.head; b = b->next){
+    if(b->dev == dev && b->blockno == blockno){
+      b->refcnt++;
+      release(&bcache.lock);
+      acquiresleep(&b->lock);
+      if(!b->valid) {
+        virtio_disk_rw(b, 0);
+        b->valid = 1;
+      }
+      memmove(dst, b->data, BSIZE);
+      brelse(b);
+      return;
+    }
+  }
+  release(&bcache.lock);
 
+  b = &bcache.raw;
+  acquiresleep(&b->lock);
+  b->dev = dev;
+  b->blockno = blockno;
+  virtio_disk_rw(b, 0);
+  memmove(dst, b->data, BSIZE);
+  releasesleep(&b->lock);
+}
@@ -17,6 +17,7 @@
 #include "sleeplock.h"
 #include "fs.h"
 #include "file.h"
+#include "poll.h"
 #include "memlayout.h"
 #include "riscv.h"
 #include "defs.h"
@@ -50,6 +51,7 @@ struct {
   uint r;  // Read index
   uint w;  // Write index
   uint e;  // Edit index
+  struct waitq wq;  // poll()s of the console
 } cons;
 
 //
@@ -172,6 +174,7 @@ consoleintr(int c)
         // has arrived.
         cons.w = cons.e;
         wakeup(&cons.r);
+        pollwakeup(&cons.wq);
       }
     }
     break;
@@ -180,6 +183,20 @@ consoleintr(int c)
   release(&cons.lock);
 }
 
+// a line is ready to read(), and write()s never wait.
+int
+consolepoll(int events, struct poller *pt)
+{
+  int r = POLLOUT;
+
+  acquire(&cons.lock);
+  if(cons.r != cons.w)
+    r |= POLLIN;
+  pollwait(&cons.wq, pt);
+  release(&cons.lock);
+  return r & events;
+}
+
 void
 consoleinit(void)
 {
@@ -191,4 +208,5 @@ consoleinit(void)
   // to consoleread and consolewrite.
   devsw[CONSOLE].read = consoleread;
   devsw[CONSOLE].write = consolewrite;
+  devsw[CONSOLE].poll = consolepoll;
 }
@@ -1,13 +1,22 @@
 struct buf;
 struct context;
+struct epoll;
 struct file;
 struct inode;
+struct lockstat;
+struct page;
 struct pipe;
+struct pollent;
+struct poller;
 struct proc;
 struct spinlock;
+struct shm;
 struct sleeplock;
+struct sock;
 struct stat;
 struct superblock;
+struct ushared;
+struct waitq;
 
 // bio.c 文件系统的磁盘块缓存
 void            binit(void);
@@ -16,6 +25,7 @@ void            brelse(struct buf*);
 void            bwrite(struct buf*);
 void            bpin(struct buf*);
 void            bunpin(struct buf*);
+void            bpeek(uint, uint, char*);
 
 // console.c 连接到用户的键盘和屏幕
 void            consoleinit(void);
@@ -29,10 +39,13 @@ int             exec(char*, char**);
 struct file*    filealloc(void);
 void            fileclose(struct file*);
 struct file*    filedup(struct file*);
+struct file*    fdfile(int);
 void            fileinit(void);
 int             fileread(struct file*, uint64, int n);
 int             filestat(struct file*, uint64 addr);
 int             filewrite(struct file*, uint64, int n);
+int             filepread(struct file*, uint64, int, uint);
+int             filepwrite(struct file*, uint64, int, uint);
 
 // fs.c  文件系统
 void            fsinit(int);
@@ -53,16 +66,35 @@ int             readi(struct inode*, int, uint64, uint, uint);
 void            stati(struct inode*, struct stat*);
 int             writei(struct inode*, int, uint64, uint, uint);
 void            itrunc(struct inode*);
+uint            bmap(struct inode*, uint);
+
+// pcache.c
+void            pcinit(void);
+struct page*    pcget(struct inode*, uint);
+struct page*    pclookup(struct inode*, uint);
+void            pcput(struct page*);
+void            pcdup(struct inode*, uint, char*);
+void            pcunmap(struct inode*, uint, char*);
+void            pcinval(struct inode*);
+int             pcreclaim(void);
 
 // ramdisk.c  使用由qemu -initrd fs.img加载的磁盘镜像的ramdisk。
 void            ramdiskinit(void);
 void            ramdiskintr(void);
 void            ramdiskrw(struct buf*);
 
+// futex.c      用户空间锁的睡眠和唤醒
+void            futexinit(void);
+int             futexwait(uint64, int);
+int             futexwake(uint64, int);
+
 // kalloc.c  物理页面分配器
 void*           kalloc(void);
 void            kfree(void *);
 void            kinit(void);
+void            kref(void *);
+void*           superalloc(void);
+void            superfree(void*);
 
 // log.c 文件系统日志记录以及崩溃修复
 void            initlog(int, struct superblock*);
@@ -73,18 +105,45 @@ void            end_op(void);
 // pipe.c  管道
 int             pipealloc(struct file**, struct file**);
 void            pipeclose(struct pipe*, int);
-int             piperead(struct pipe*, uint64, int);
-int             pipewrite(struct pipe*, uint64, int);
+int             piperead(struct pipe*, uint64, int, int);
+int             pipewrite(struct pipe*, uint64, int, int);
+int             pipepoll(struct pipe*, int, int, struct poller*);
+
+// poll.c       等待多个文件之一就绪
+void            pollinit(void);
+void            pollqueue(struct waitq*, struct pollent*);
+void            pollunqueue(struct pollent*);
+void            pollwait(struct waitq*, struct poller*);
+void            pollwakeup(struct waitq*);
+void            polltimer(void);
+int             filepoll(struct file*, int, struct poller*);
+int             poll(uint64, int, int);
+
+// epoll.c      登记过的文件的就绪事件
+struct file*    epollalloc(void);
+void            epollclose(struct epoll*);
+int             epollctl(struct epoll*, int, int, uint64);
+int             epollwait(struct epoll*, uint64, int, int);
 
 // printf.c   格式化输出到控制台
 void            printf(char*, ...);
 void            panic(char*) __attribute__((noreturn));
 void            printfinit(void);
 
+// prof.c  采样分析器
+void            profinit(void);
+void            profintr(int);
+
 // proc.c  进程和调度
 int             cpuid(void);
 void            exit(int);
 int             fork(void);
+int             clone(uint64, uint64, uint64);
+int             join(int, uint64);
+void            killthreads(struct proc*);
+int             kthread(void (*)(void*), void*);
+void            vmlock(struct proc*);
+void            vmunlock(struct proc*);
 int             growproc(int);
 pagetable_t     proc_pagetable(struct proc *);
 void            proc_freepagetable(pagetable_t, uint64);
@@ -100,11 +159,39 @@ void            sleep(void*, struct spinlock*);
 void            userinit(void);
 int             wait(uint64);
 void            wakeup(void*);
+int             wakeupn(void*, int);
 void            yield(void);
 int             either_copyout(int user_dst, uint64 dst, void *src, uint64 len);
 int             either_copyin(void *dst, int user_src, uint64 src, uint64 len);
 void            procdump(void);
 
+// shm.c        进程间共享内存
+void            shminit(void);
+struct shm*     shmalloc(uint64);
+void            shmput(struct shm*);
+char*           shmpage(struct shm*, uint);
+
+// uring.c      异步的提交和完成队列
+uint64          uringsetup(int);
+int             uringenter(int, int);
+void            uringfree(struct proc*);
+
+// sock.c       Unix domain stream sockets
+void            sockinit(void);
+struct file*    sockalloc(void);
+void            sockclose(struct sock*);
+int             sockbind(struct sock*, char*);
+int             socklisten(struct sock*, int);
+int             sockconnect(struct sock*, char*);
+struct file*    sockaccept(struct sock*, int);
+int             sockread(struct sock*, uint64, int, int);
+int             sockwrite(struct sock*, uint64, int, int);
+int             sockpoll(struct sock*, int, struct poller*);
+
+// start.c
+void            timerarm(uint64);
+int             timerpending(void);
+
 // swtch.S  线程切换
 void            swtch(struct context*, struct context*);
 
@@ -112,6 +199,12 @@ void            swtch(struct context*, struct context*);
 void            acquire(struct spinlock*);
 int             holding(struct spinlock*);
 void            initlock(struct spinlock*, char*);
+void            initticketlock(struct spinlock*, char*);
+struct lockstat* lockstatfor(char*, int);
+void            lockstatacquire(struct lockstat*, uint64, uint64, uint64);
+void            lockstatrelease(struct lockstat*, uint64);
+int             lockstatcopy(uint64, int);
+void            lockstatreset(void);
 void            release(struct spinlock*);
 void            push_off(void);
 void            pop_off(void);
@@ -138,12 +231,27 @@ int             argaddr(int, uint64 *);
 int             fetchstr(uint64, char*, int);
 int             fetchaddr(uint64, uint64*);
 void            syscall();
+int             syslatcopy(uint64, int);
+void            syslatreset(void);
+
+// sysfile.c    文件相关的系统调用
+int             fileopen(char*, int);
+struct inode*   create(char*, short, short, short);
+
+// trace.c      系统调用跟踪
+void            traceinit(void);
+void            tracesys(int, uint64*, uint64, uint64, uint64);
+int             traceread(uint64, int);
 
 // trap.c       对陷入指令和中断进行处理并返回的C代码
 extern uint     ticks;
+extern struct ushared *ushared;
 void            trapinit(void);
 void            trapinithart(void);
 extern struct spinlock tickslock;
+extern struct spinlock hrtimelock;
+uint64          readmtime(void);
+void            ipi(int);
 void            usertrapret(void);
 
 // uart.c      串口控制台设备驱动程序
@@ -156,6 +264,14 @@ int             uartgetc(void);
 // vm.c      管理页表和地址空间
 void            kvminit(void);
 void            kvminithart(void);
+pagetable_t     kvmcreate(pagetable_t);
+void            kvmsetuser(pagetable_t, pagetable_t);
+void            kvmfree(pagetable_t);
+int             kvmasid(int);
+void            kvmswitch(struct proc*);
+void            tlbflushall(struct proc*);
+void            tlbflushrange(struct proc*, uint64, uint64);
+void            tlbcheck(void);
 uint64          kvmpa(uint64);
 void            kvmmap(uint64, uint64, uint64, int);
 int             mappages(pagetable_t, uint64, uint64, uint64, int);
@@ -166,7 +282,9 @@ uint64          uvmdealloc(pagetable_t, uint64, uint64);
 int             uvmcopy(pagetable_t, pagetable_t, uint64);
 void            uvmfree(pagetable_t, uint64);
 void            uvmunmap(pagetable_t, uint64, uint64, int);
-void            uvmclear(pagetable_t, uint64);
+int             uvmclear(pagetable_t, uint64);
+int             uvmsplit(pagetable_t, uint64);
+pte_t *         walk(pagetable_t, uint64, int);
 uint64          walkaddr(pagetable_t, uint64);
 int             copyout(pagetable_t, uint64, char *, uint64);
 int             copyin(pagetable_t, char *, uint64, uint64);
@@ -178,6 +296,40 @@ void            plicinithart(void);
 int             plic_claim(void);
 void            plic_complete(int);
 
+// vma.c        mmap()的内存区域
+uint64          mmap(uint64, uint64, int, int, struct file*, uint64);
+int             munmap(uint64, uint64);
+uint64          vmalow(struct proc*);
+int             vmafault(struct proc*, uint64, int);
+int             vmatrap(struct proc*, uint64, uint64);
+int             vmatouch(pagetable_t, uint64, uint64, int);
+int             vmafork(struct proc*, struct proc*);
+void            vmaexit(struct proc*);
+
+// vmcopyin.c   通过进程的内核页表直接拷贝用户内存
+int             ucopyok(pagetable_t, uint64, uint64);
+int             copyout_new(uint64, char*, uint64);
+int             copyin_new(char*, uint64, uint64);
+int             copyinstr_new(char*, uint64, uint64);
+int             ucopytrap(uint64, uint64*);
+
+// xregs.c      用户进程的浮点和向量寄存器
+extern uint64   misa;
+extern int      hwcap;
+void            xregsinit(void);
+int             xregstrap(struct proc*);
+void            xregssave(struct proc*);
+uint64          xregsreturn(struct proc*, uint64);
+int             xregsfork(struct proc*, struct proc*);
+void            xregsfree(struct proc*);
+int             kvectorbegin(void);
+void            kvectorend(void);
+
+// rvv.S        向量版本的内存操作
+void            vmemcpy(void*, const void*, uint64);
+void            vmemset(void*, int, uint64);
+int             vmemcmp(const void*, const void*, uint64);
+
 // virtio_disk.c 	磁盘设备驱动程序
 void            virtio_disk_init(void);
 void            virtio_disk_rw(struct buf *, int);
@@ -0,0 +1,300 @@
+//
+// epoll sets: a file that remembers which files to watch, so
+// that waiting for them doesn't cost a look at each one.
+//
+// epoll_ctl() puts an item for each file on the file's
+// waitq, once, and it stays there until removed. When
+// pollwakeup() says a file may have become ready, its item
+// goes on the set's ready list, and epoll_wait() looks only
+// at the files on that list: the cost of a wait is the number
+// of files that are ready, not the number watched.
+//
+// Readiness is level-triggered, as poll(): epoll_wait() puts
+// an item it reports back on the ready list, to be looked at
+// again by the next wait, and drops those no longer ready.
+//
+// An item holds a reference to its file, so a file stays open
+// until removed from the set (EPOLL_CTL_DEL) or the set is
+// closed. Items are indexed by fd, so a set holds at most
+// NOFILE of them. Sets can't be put in sets.
+//
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+#include "poll.h"
+#include "epoll.h"
+#include "defs.h"
+
+struct epitem {
+  struct pollent ent;     // on f's waitq; arg is the item
+  struct epoll *ep;
+  struct file *f;         // 0 if the item is free
+  int events;
+  uint64 data;
+  int ready;              // on ep's ready list
+  struct epitem *rnext;
+};
+
+struct epoll {
+  struct sleeplock lk;            // one epoll_ctl() or epoll_wait() at a time
+  struct epitem *rhead, *rtail;   // ready list, protected by polllock
+  struct epitem items[NOFILE];    // by fd
+};
+
+extern struct spinlock polllock;
+extern struct waitq polltimeq;
+
+// put it on its set's ready list. polllock held.
+static void
+epready(struct epitem *it)
+{
+  struct epoll *ep = it->ep;
+
+  if(it->ready)
+    return;
+  it->ready = 1;
+  it->rnext = 0;
+  if(ep->rtail)
+    ep->rtail->rnext = it;
+  else
+    ep->rhead = it;
+  ep->rtail = it;
+}
+
+// the item's file may have become ready.
+static void
+epwake(struct pollent *e)
+{
+  struct epitem *it = e->arg;
+
+  epready(it);
+  wakeup(it->ep);
+}
+
+// the timer went off, for a set waiting with a timeout.
+static void
+eptimeout(struct pollent *e)
+{
+  wakeup(e->arg);
+}
+
+// the poller given to filepoll() when an item is added.
+static void
+epqueue(struct poller *pt, struct waitq *wq)
+{
+  struct epitem *it = pt->arg;
+
+  if(it->ent.wq == 0)
+    pollqueue(wq, &it->ent);
+}
+
+// take it off its file's waitq and out of the set.
+static void
+epremove(struct epitem *it)
+{
+  struct epoll *ep = it->ep;
+  struct epitem **pp;
+
+  pollunqueue(&it->ent);
+  acquire(&polllock);
+  if(it->ready){
+    for(pp = &ep->rhead; *pp != it; pp = &(*pp)->rnext)
+      ;
+    *pp = it->rnext;
+    if(ep->rtail == it){
+      for(ep->rtail = ep->rhead; ep->rtail && ep->rtail->rnext; )
+        ep->rtail = ep->rtail->rnext;
+    }
+    it->ready = 0;
+  }
+  release(&polllock);
+  fileclose(it->f);
+  it->f = 0;
+}
+
+// a new, empty set, as a file.
+struct file*
+epollalloc(void)
+{
+  struct epoll *ep;
+  struct file *f;
+  int i;
+
+  if((f = filealloc()) == 0)
+    return 0;
+  if((ep = kalloc()) == 0){
+    fileclose(f);
+    return 0;
+  }
+  memset(ep, 0, sizeof(*ep));
+  initsleeplock(&ep->lk, "epoll");
+  for(i = 0; i < NOFILE; i++)
+    ep->items[i].ep = ep;
+  f->type = FD_EPOLL;
+  f->ep = ep;
+  return f;
+}
+
+// the set's file is closed.
+void
+epollclose(struct epoll *ep)
+{
+  int i;
+
+  for(i = 0; i < NOFILE; i++)
+    if(ep->items[i].f)
+      epremove(&ep->items[i]);
+  kfree(ep);
+}
+
+// add, remove or change (op) the set's item for the current
+// process's file descriptor fd; addr is a user address of a
+// struct epoll_event, for add and change.
+int
+epollctl(struct epoll *ep, int op, int fd, uint64 addr)
+{
+  struct proc *p = myproc();
+  struct epoll_event ev;
+  struct epitem *it;
+  struct poller pt;
+  struct file *f;
+  int r = -1;
+
+  if(fd < 0 || fd >= NOFILE)
+    return -1;
+  if(op != EPOLL_CTL_DEL && copyin(p->pagetable, (char*)&ev, addr, sizeof(ev)) < 0)
+    return -1;
+  it = &ep->items[fd];
+
+  acquiresleep(&ep->lk);
+  if(op == EPOLL_CTL_ADD){
+    if(it->f || (f = fdfile(fd)) == 0)
+      goto out;
+    if(f->type == FD_EPOLL){
+      fileclose(f);
+      goto out;
+    }
+    it->f = f;
+    it->events = ev.events;
+    it->data = ev.data;
+    it->ent.wake = epwake;
+    it->ent.arg = it;
+    pt.queue = epqueue;
+    pt.arg = it;
+    filepoll(f, it->events, &pt);
+    // the first epoll_wait() looks at it.
+    acquire(&polllock);
+    epready(it);
+    release(&polllock);
+    r = 0;
+  } else if(op == EPOLL_CTL_DEL){
+    if(it->f == 0)
+      goto out;
+    epremove(it);
+    r = 0;
+  } else if(op == EPOLL_CTL_MOD){
+    if(it->f == 0)
+      goto out;
+    it->events = ev.events;
+    it->data = ev.data;
+    acquire(&polllock);
+    epready(it);
+    release(&polllock);
+    r = 0;
+  }
+ out:
+  releasesleep(&ep->lk);
+  return r;
+}
+
+// Wait until some of the set's files are ready, or for
+// timeout milliseconds; -1 is forever, and 0 doesn't wait.
+// Fills in up to max struct epoll_event at user address addr
+// and returns how many, or -1.
+int
+epollwait(struct epoll *ep, uint64 addr, int max, int timeout)
+{
+  struct proc *p = myproc();
+  struct epoll_event evs[NOFILE];
+  struct epitem *list[NOFILE], *it;
+  struct pollent te;
+  uint64 deadline = 0;
+  int i, nlist, n, r;
+
+  if(max < 1)
+    return -1;
+  if(max > NOFILE)
+    max = NOFILE;
+  if(timeout > 0)
+    deadline = readmtime() + (uint64)timeout * MTIME_FREQ / 1000;
+
+  acquiresleep(&ep->lk);
+  for(;;){
+    // take the ready list. a file that becomes ready from
+    // here on goes on the list again, which sets its rnext,
+    // so copy the list out rather than walk it later.
+    acquire(&polllock);
+    nlist = 0;
+    for(it = ep->rhead; it; it = it->rnext){
+      it->ready = 0;
+      list[nlist++] = it;
+    }
+    ep->rhead = ep->rtail = 0;
+    release(&polllock);
+
+    n = 0;
+    for(i = 0; i < nlist; i++){
+      it = list[i];
+      r = n < max ? filepoll(it->f, it->events, 0) : 0;
+      if(r){
+        evs[n].events = r;
+        evs[n].pad = 0;
+        evs[n].data = it->data;
+        n++;
+      }
+      // still ready, or not looked at: for the next wait.
+      if(r || n >= max){
+        acquire(&polllock);
+        epready(it);
+        release(&polllock);
+      }
+    }
+    if(n > 0 || timeout == 0 || p->killed)
+      break;
+    if(deadline && readmtime() >= deadline)
+      break;
+
+    // let epoll_ctl() in while we wait.
+    releasesleep(&ep->lk);
+    if(deadline){
+      te.wake = eptimeout;
+      te.arg = ep;
+      pollqueue(&polltimeq, &te);
+    }
+    acquire(&polllock);
+    while(ep->rhead == 0 && !p->killed && (deadline == 0 || readmtime() < deadline)){
+      // polllock keeps interrupts off: see poll().
+      if(deadline)
+        timerarm(deadline);
+      sleep(ep, &polllock);
+    }
+    release(&polllock);
+    if(deadline)
+      pollunqueue(&te);
+    acquiresleep(&ep->lk);
+  }
+  releasesleep(&ep->lk);
+
+  if(p->killed)
+    return -1;
+  if(n > 0 && copyout(p->pagetable, addr, (char*)evs, n * sizeof(evs[0])) < 0)
+    return -1;
+  return n;
+}
@@ -0,0 +1,14 @@
+// epoll sets (epoll.c): what epoll_ctl() registers and
+// epoll_wait() reports.
+// Both the kernel and user programs use this header file.
+
+struct epoll_event {
+  int events;      // POLLIN and/or POLLOUT (poll.h)
+  int pad;
+  uint64 data;     // anything, handed back by epoll_wait()
+};
+
+// epoll_ctl() operations
+#define EPOLL_CTL_ADD 1  // watch fd
+#define EPOLL_CTL_DEL 2  // stop watching fd
+#define EPOLL_CTL_MOD 3  // change what to watch fd for
@@ -23,6 +23,10 @@ exec(char *path, char **argv) // 它使用一个存储在文件系统中的文
   pagetable_t pagetable = 0, oldpagetable;
   struct proc *p = myproc();
 
+  // the other threads would be left without their memory.
+  if(p->leader != p)
+    return -1;
+
   begin_op();
 
   if((ip = namei(path)) == 0){
@@ -73,7 +77,8 @@ exec(char *path, char **argv) // 它使用一个存储在文件系统中的文
   if((sz1 = uvmalloc(pagetable, sz, sz + 2*PGSIZE)) == 0)
     goto bad;
   sz = sz1;
-  uvmclear(pagetable, sz-2*PGSIZE);
+  if(uvmclear(pagetable, sz-2*PGSIZE) < 0)
+    goto bad;
   sp = sz;
   stackbase = sp - PGSIZE;
 
@@ -111,12 +116,18 @@ exec(char *path, char **argv) // 它使用一个存储在文件系统中的文
   safestrcpy(p->name, last, sizeof(p->name));
     
   // Commit to the user image.
+  killthreads(p);
+  uringfree(p);
+  vmaexit(p);
   oldpagetable = p->pagetable;
   p->pagetable = pagetable;
   p->sz = sz;
   p->trapframe->epc = elf.entry;  // initial program counter = main
   p->trapframe->sp = sp; // initial stack pointer
+  kvmsetuser(p->kpagetable, pagetable);
+  tlbflushall(p);
   proc_freepagetable(oldpagetable, oldsz);
+  xregsfree(p);
 
   return argc; // this ends up in a0, the first argument to main(argc, argv)
 
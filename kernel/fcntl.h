@@ -3,3 +3,17 @@
 #define O_RDWR    0x002
 #define O_CREATE  0x200
 #define O_TRUNC   0x400
+#define O_NONBLOCK 0x800  // read() and write() fail rather than wait
+
+// mmap() protection
+#define PROT_NONE  0x0
+#define PROT_READ  0x1
+#define PROT_WRITE 0x2
+#define PROT_EXEC  0x4
+
+// mmap() flags
+#define MAP_SHARED    0x01  // writes go back to the file
+#define MAP_PRIVATE   0x02  // writes stay in this process
+#define MAP_ANONYMOUS 0x20  // zeroed memory, no file
+
+#define MAP_FAILED ((void*)-1)
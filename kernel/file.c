@@ -11,6 +11,8 @@
 #include "sleeplock.h"
 #include "file.h"
 #include "stat.h"
+#include "poll.h"
+#include "fcntl.h"
 #include "proc.h" 
 
 struct devsw devsw[NDEV];
@@ -35,6 +37,7 @@ filealloc(void)
   for(f = ftable.file; f < ftable.file + NFILE; f++){
     if(f->ref == 0){
       f->ref = 1;
+      f->nonblock = 0;
       release(&ftable.lock);
       return f;
     }
@@ -55,6 +58,24 @@ filedup(struct file *f)
   return f;
 }
 
+// the current process's open file fd, with a reference of
+// its own, or 0. the caller fileclose()s it when done.
+struct file*
+fdfile(int fd)
+{
+  struct proc *g = myproc()->leader;
+  struct file *f = 0;
+
+  if(fd < 0 || fd >= NOFILE)
+    return 0;
+  // another thread may be closing it.
+  acquire(&g->lock);
+  if(g->ofile[fd])
+    f = filedup(g->ofile[fd]);
+  release(&g->lock);
+  return f;
+}
+
 // Close file f.  (Decrement ref count, close when reaches 0.)
 void
 fileclose(struct file *f)
@@ -79,6 +100,12 @@ fileclose(struct file *f)
     begin_op();
     iput(ff.ip);
     end_op();
+  } else if(ff.type == FD_SHM){
+    shmput(ff.shm);
+  } else if(ff.type == FD_EPOLL){
+    epollclose(ff.ep);
+  } else if(ff.type == FD_SOCK){
+    sockclose(ff.sock);
   }
 }
 
@@ -101,82 +128,163 @@ filestat(struct file *f, uint64 addr)
   return -1;
 }
 
+// fault in the n bytes at user address addr for access
+// (vma.c), before taking the locks of a file: copies made
+// with them held fail rather than fault. Returns the old
+// p->nofault for fileunfault(), or -1.
+static int
+fileprefault(uint64 addr, int n, int access)
+{
+  struct proc *p = myproc();
+  int old = p->nofault;
+
+  if(n > 0 && vmatouch(p->pagetable, addr, n, access) < 0)
+    return -1;
+  p->nofault = 1;
+  return old;
+}
+
+static void
+fileunfault(int old)
+{
+  myproc()->nofault = old;
+}
+
 // Read from file f.
 // addr is a user virtual address.
 int
 fileread(struct file *f, uint64 addr, int n)
 {
-  int r = 0;
+  int r = 0, nf;
 
   if(f->readable == 0)
     return -1;
+  // FD_SHM only through mmap(), FD_EPOLL through epoll_wait().
+  if(f->type == FD_SHM || f->type == FD_EPOLL)
+    return -1;
+  if(f->type == FD_DEVICE && (f->major < 0 || f->major >= NDEV || !devsw[f->major].read))
+    return -1;
+  if((nf = fileprefault(addr, n, PROT_WRITE)) < 0)
+    return -1;
 
   if(f->type == FD_PIPE){
-    r = piperead(f->pipe, addr, n);
+    r = piperead(f->pipe, addr, n, f->nonblock);
   } else if(f->type == FD_DEVICE){
-    if(f->major < 0 || f->major >= NDEV || !devsw[f->major].read)
-      return -1;
-    r = devsw[f->major].read(1, addr, n);
+    if(f->nonblock && (filepoll(f, POLLIN, 0) & POLLIN) == 0)
+      r = -1;
+    else
+      r = devsw[f->major].read(1, addr, n);
   } else if(f->type == FD_INODE){
     ilock(f->ip);
     if((r = readi(f->ip, 1, addr, f->off, n)) > 0)
       f->off += r;
     iunlock(f->ip);
+  } else if(f->type == FD_SOCK){
+    r = sockread(f->sock, addr, n, f->nonblock);
   } else {
     panic("fileread");
   }
 
+  fileunfault(nf);
   return r;
 }
 
+// write n bytes at user address addr to ip at *off, and
+// advance *off. returns n, or -1.
+static int
+inodewrite(struct inode *ip, uint64 addr, int n, uint *off)
+{
+  // write a few blocks at a time to avoid exceeding
+  // the maximum log transaction size, including
+  // i-node, indirect block, allocation blocks,
+  // and 2 blocks of slop for non-aligned writes.
+  // this really belongs lower down, since writei()
+  // might be writing a device like the console.
+  int max = ((MAXOPBLOCKS-1-1-2) / 2) * BSIZE;
+  int i = 0, r = 0;
+
+  while(i < n){
+    int n1 = n - i;
+    if(n1 > max)
+      n1 = max;
+
+    begin_op();
+    ilock(ip);
+    if ((r = writei(ip, 1, addr + i, *off, n1)) > 0)
+      *off += r;
+    iunlock(ip);
+    end_op();
+
+    if(r < 0)
+      break;
+    if(r != n1)
+      panic("short filewrite");
+    i += r;
+  }
+  return i == n ? n : -1;
+}
+
 // Write to file f.
 // addr is a user virtual address.
 int
 filewrite(struct file *f, uint64 addr, int n)
 {
-  int r, ret = 0;
+  int ret = 0, nf;
 
   if(f->writable == 0)
     return -1;
+  if(f->type == FD_SHM || f->type == FD_EPOLL)
+    return -1;
+  if(f->type == FD_DEVICE && (f->major < 0 || f->major >= NDEV || !devsw[f->major].write))
+    return -1;
+  if((nf = fileprefault(addr, n, PROT_READ)) < 0)
+    return -1;
 
   if(f->type == FD_PIPE){
-    ret = pipewrite(f->pipe, addr, n);
+    ret = pipewrite(f->pipe, addr, n, f->nonblock);
   } else if(f->type == FD_DEVICE){
-    if(f->major < 0 || f->major >= NDEV || !devsw[f->major].write)
-      return -1;
     ret = devsw[f->major].write(1, addr, n);
   } else if(f->type == FD_INODE){
-    // write a few blocks at a time to avoid exceeding
-    // the maximum log transaction size, including
-    // i-node, indirect block, allocation blocks,
-    // and 2 blocks of slop for non-aligned writes.
-    // this really belongs lower down, since writei()
-    // might be writing a device like the console.
-    int max = ((MAXOPBLOCKS-1-1-2) / 2) * BSIZE;
-    int i = 0;
-    while(i < n){
-      int n1 = n - i;
-      if(n1 > max)
-        n1 = max;
-
-      begin_op();
-      ilock(f->ip);
-      if ((r = writei(f->ip, 1, addr + i, f->off, n1)) > 0)
-        f->off += r;
-      iunlock(f->ip);
-      end_op();
-
-      if(r < 0)
-        break;
-      if(r != n1)
-        panic("short filewrite");
-      i += r;
-    }
-    ret = (i == n ? n : -1);
+    ret = inodewrite(f->ip, addr, n, &f->off);
+  } else if(f->type == FD_SOCK){
+    ret = sockwrite(f->sock, addr, n, f->nonblock);
   } else {
     panic("filewrite");
   }
 
+  fileunfault(nf);
   return ret;
 }
 
+// Read from file f at offset off, leaving f->off alone.
+// Only for files; addr is a user virtual address.
+int
+filepread(struct file *f, uint64 addr, int n, uint off)
+{
+  int r, nf;
+
+  if(f->readable == 0 || f->type != FD_INODE)
+    return -1;
+  if((nf = fileprefault(addr, n, PROT_WRITE)) < 0)
+    return -1;
+  ilock(f->ip);
+  r = readi(f->ip, 1, addr, off, n);
+  iunlock(f->ip);
+  fileunfault(nf);
+  return r;
+}
+
+// Write to file f at offset off, leaving f->off alone.
+int
+filepwrite(struct file *f, uint64 addr, int n, uint off)
+{
+  int r, nf;
+
+  if(f->writable == 0 || f->type != FD_INODE)
+    return -1;
+  if((nf = fileprefault(addr, n, PROT_READ)) < 0)
+    return -1;
+  r = inodewrite(f->ip, addr, n, &off);
+  fileunfault(nf);
+  return r;
+}
@@ -1,12 +1,16 @@
 struct file {
-  enum { FD_NONE, FD_PIPE, FD_INODE, FD_DEVICE } type;
+  enum { FD_NONE, FD_PIPE, FD_INODE, FD_DEVICE, FD_SHM, FD_EPOLL, FD_SOCK } type;
   int ref; // reference count
   char readable;
   char writable;
+  char nonblock;     // O_NONBLOCK
   struct pipe *pipe; // FD_PIPE
   struct inode *ip;  // FD_INODE and FD_DEVICE
   uint off;          // FD_INODE
   short major;       // FD_DEVICE
+  struct shm *shm;   // FD_SHM
+  struct epoll *ep;  // FD_EPOLL
+  struct sock *sock; // FD_SOCK
 };
 
 #define major(dev)  ((dev) >> 16 & 0xFFFF)
@@ -29,12 +33,39 @@ struct inode {
   uint addrs[NDIRECT+1];
 };
 
+struct pollent;
+
+// those waiting for something to become ready, such as a
+// pipe: poll() and epoll sets (poll.c). protected by polllock.
+struct waitq {
+  struct pollent *head;
+};
+
+// a place on a waitq. wake(e) is called, with polllock held,
+// when what it waits for may have become ready.
+struct pollent {
+  struct waitq *wq;
+  struct pollent *next;
+  void (*wake)(struct pollent*);
+  void *arg;       // for wake
+};
+
+// given to a poll function, which calls queue(pt, wq) to
+// have it wait for wq.
+struct poller {
+  void (*queue)(struct poller*, struct waitq*);
+  void *arg;       // for queue
+};
+
 // map major device number to device functions.
+// a device without poll is always ready.
 struct devsw {
   int (*read)(int, uint64, int);
   int (*write)(int, uint64, int);
+  int (*poll)(int, struct poller*);
 };
 
 extern struct devsw devsw[];
 
 #define CONSOLE 1
+#define PROF    2  // sampling profiler, see prof.c
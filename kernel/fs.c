@@ -21,6 +21,7 @@
 #include "fs.h"
 #include "buf.h"
 #include "file.h"
+#include "pcache.h"
 
 #define min(a, b) ((a) < (b) ? (a) : (b))
 // there should be one superblock per disk device, but we run with
@@ -379,7 +380,7 @@ iunlockput(struct inode *ip)
 
 // Return the disk block address of the nth block in inode ip.
 // If there is no such block, bmap allocates one. // 返回节点ip中第n个块的磁盘块地址。 如果没有这样的块，bmap会分配一个
-static uint
+uint
 bmap(struct inode *ip, uint bn)
 {
   uint addr, *a;
@@ -439,6 +440,7 @@ itrunc(struct inode *ip)
 
   ip->size = 0;
   iupdate(ip);
+  pcinval(ip);
 }
 
 // Copy stat information from inode.
@@ -457,11 +459,14 @@ stati(struct inode *ip, struct stat *st)
 // Caller must hold ip->lock.
 // If user_dst==1, then dst is a user virtual address;
 // otherwise, dst is a kernel address. 将ip中对应的数据块中的数据复制到dst上
+// File data comes from the page cache, if it can hold it.
 int
 readi(struct inode *ip, int user_dst, uint64 dst, uint off, uint n)
 {
   uint tot, m;
   struct buf *bp;
+  struct page *pg;
+  int r;
 
   if(off > ip->size || off + n < off)
     return 0;
@@ -469,6 +474,14 @@ readi(struct inode *ip, int user_dst, uint64 dst, uint off, uint n)
     n = ip->size - off;
 
   for(tot=0; tot<n; tot+=m, off+=m, dst+=m){
+    if(ip->type == T_FILE && (pg = pcget(ip, off/PGSIZE)) != 0){
+      m = min(n - tot, PGSIZE - off%PGSIZE);
+      r = either_copyout(user_dst, dst, pg->data + (off % PGSIZE), m);
+      pcput(pg);
+      if(r == -1)
+        break;
+      continue;
+    }
     bp = bread(ip->dev, bmap(ip, off/BSIZE));
     m = min(n - tot, BSIZE - off%BSIZE);
     if(either_copyout(user_dst, dst, bp->data + (off % BSIZE), m) == -1) {
@@ -484,11 +497,13 @@ readi(struct inode *ip, int user_dst, uint64 dst, uint off, uint n)
 // Caller must hold ip->lock.
 // If user_src==1, then src is a user virtual address;
 // otherwise, src is a kernel address.  将src中的数据写入到ip对应off的数据块上
+// A cached page of the file gets the new data too.
 int
 writei(struct inode *ip, int user_src, uint64 src, uint off, uint n)
 {
   uint tot, m;
   struct buf *bp;
+  struct page *pg;
 
   if(off > ip->size || off + n < off)
     return -1;
@@ -503,6 +518,10 @@ writei(struct inode *ip, int user_src, uint64 src, uint off, uint n)
       break;
     }
     log_write(bp);
+    if(ip->type == T_FILE && (pg = pclookup(ip, off/PGSIZE)) != 0){
+      memmove(pg->data + (off % PGSIZE), bp->data + (off % BSIZE), m);
+      pcput(pg);
+    }
     brelse(bp);
   }
 
@@ -633,11 +652,18 @@ static struct inode*
 namex(char *path, int nameiparent, char *name)
 {
   struct inode *ip, *next;
+  struct proc *g;
 
   if(*path == '/')
     ip = iget(ROOTDEV, ROOTINO);
-  else
-    ip = idup(myproc()->cwd);
+  else {
+    // a thread uses its process's cwd, which chdir() in
+    // another thread may change.
+    g = myproc()->leader;
+    acquire(&g->lock);
+    ip = idup(g->cwd);
+    release(&g->lock);
+  }
 
   while((path = skipelem(path, name)) != 0){
     ilock(ip);
@@ -0,0 +1,104 @@
+//
+// Futexes: futex_wait(addr, val) sleeps while the int at
+// user address addr holds val, until futex_wake(addr, n).
+// The locks in ulib.c use them so that user threads sleep
+// in the kernel only when a lock is contended, and never
+// spin or pass tokens through pipes.
+//
+// A futex is known by the physical address of its int, so
+// the threads of a process and processes that map the same
+// page (MAP_SHARED) meet at the same one. futex_wait()
+// checks the value and sleep()s holding the lock of the
+// futex's bucket, which futex_wake() takes too, so a wakeup
+// can't slip in between.
+//
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "defs.h"
+
+#define NFUTEX 61  // lock buckets
+
+struct spinlock futexlocks[NFUTEX];
+
+void
+futexinit(void)
+{
+  int i;
+
+  for(i = 0; i < NFUTEX; i++)
+    initlock(&futexlocks[i], "futex");
+}
+
+static struct spinlock*
+futexlock(uint64 pa)
+{
+  return &futexlocks[(pa / sizeof(int)) % NFUTEX];
+}
+
+// the physical address of the int at user address addr,
+// faulting its page in if need be, or 0.
+static uint64
+futexpa(uint64 addr)
+{
+  struct proc *p = myproc();
+  uint64 pa;
+  int x;
+
+  if(addr % sizeof(int) != 0)
+    return 0;
+  if(copyin(p->pagetable, (char*)&x, addr, sizeof(x)) < 0)
+    return 0;
+  // another thread could unmap the page before we look at
+  // it; that's the program's bug, and at worst it sleeps
+  // until it is killed.
+  if((pa = walkaddr(p->pagetable, addr)) == 0)
+    return 0;
+  return pa + addr % PGSIZE;
+}
+
+// Sleep until futexwake(addr), if the int at addr is val.
+// Returns 0 once woken, which may be spuriously, or -1 if
+// the int isn't val or addr is bad. Either way the caller
+// should look at the int again.
+int
+futexwait(uint64 addr, int val)
+{
+  struct proc *p = myproc();
+  struct spinlock *lk;
+  uint64 pa;
+
+  if((pa = futexpa(addr)) == 0)
+    return -1;
+  lk = futexlock(pa);
+  acquire(lk);
+  if(*(volatile int*)pa != val || p->killed){
+    release(lk);
+    return -1;
+  }
+  sleep((void*)pa, lk);
+  release(lk);
+  return 0;
+}
+
+// Wake up to n of the threads sleeping in futexwait(addr).
+// Returns how many, or -1 if addr is bad.
+int
+futexwake(uint64 addr, int n)
+{
+  struct spinlock *lk;
+  uint64 pa;
+  int woken;
+
+  if((pa = futexpa(addr)) == 0)
+    return -1;
+  lk = futexlock(pa);
+  acquire(lk);
+  woken = wakeupn((void*)pa, n);
+  release(lk);
+  return woken;
+}
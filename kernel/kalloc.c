@@ -1,6 +1,14 @@
 // Physical memory allocator, for user processes,
 // kernel stacks, page-table pages,
-// and pipe buffers. Allocates whole 4096-byte pages.
+// and pipe buffers. Allocates whole 4096-byte pages,
+// and 2-megabyte superpages for large regions of user
+// memory. Each aligned 2 MB block of RAM is either on
+// the superpage list or split into pages; kalloc() splits
+// a superpage when it runs out of pages, and kfree() puts
+// a block back together once all of its pages are free.
+// Pages have reference counts, for pages that several page
+// tables map (shm.c): kref() adds one, and kfree() frees
+// the page when it drops the last.
 // 物理页面分配器
 #include "types.h"
 #include "param.h"
@@ -16,17 +24,62 @@ extern char end[]; // first address after kernel. // 第一个可能的物理内
 
 struct run {
   struct run *next; //每个空闲页的列表元素是一个struct run
+  struct run *prev; // so kfree() can take a block's pages off the list
 };
 
+#define NBLOCK ((PHYSTOP - KERNBASE) / SUPERPGSIZE)
+
 struct {
   struct spinlock lock;
   struct run *freelist; // 空闲元素列表
+  struct run *superlist; // free superpages
+  short nfree[NBLOCK];  // pages of each 2 MB block on freelist
 } kmem;
 
+// references to each page, less one; kept with atomic
+// instructions rather than kmem.lock. pages that came from
+// a superpage (superdemote()) start at zero too.
+static int krefs[(PHYSTOP - KERNBASE) / PGSIZE];
+
+#define KREF(pa) krefs[((uint64)(pa) - KERNBASE) / PGSIZE]
+
+// the 2 MB block holding page pa, or -1 if the block
+// is not all free memory (it holds the kernel).
+static int
+block(void *pa)
+{
+  uint64 b = PGROUNDDOWN((uint64)pa) & ~(SUPERPGSIZE - 1);
+
+  if(b < (uint64)end)
+    return -1;
+  return (b - KERNBASE) / SUPERPGSIZE;
+}
+
+static void
+push(struct run *r)
+{
+  r->prev = 0;
+  r->next = kmem.freelist;
+  if(kmem.freelist)
+    kmem.freelist->prev = r;
+  kmem.freelist = r;
+}
+
+static void
+unlink(struct run *r)
+{
+  if(r->prev)
+    r->prev->next = r->next;
+  else
+    kmem.freelist = r->next;
+  if(r->next)
+    r->next->prev = r->prev;
+}
+
 void
 kinit()
 {
-  initlock(&kmem.lock, "kmem");
+  initticketlock(&kmem.lock, "kmem");
   freerange(end, (void*)PHYSTOP);
 }
 // 将内存添加到空闲列表中
@@ -47,21 +100,47 @@ void
 kfree(void *pa)
 {
   struct run *r;
+  int b, ref;
 
   if(((uint64)pa % PGSIZE) != 0 || (char*)pa < end || (uint64)pa >= PHYSTOP)
     panic("kfree");
 
+  // someone else still maps it. the check and the drop are
+  // one step, so that of two kfree()s racing for the last two
+  // references, exactly one frees the page.
+  while((ref = KREF(pa)) > 0)
+    if(__sync_bool_compare_and_swap(&KREF(pa), ref, ref - 1))
+      return;
+
   // Fill with junk to catch dangling refs.释放内存时会把原来的内容用全1也就是垃圾填充，防止别人可能会使用到
   memset(pa, 1, PGSIZE);
 
   r = (struct run*)pa;
 
   acquire(&kmem.lock);
-  r->next = kmem.freelist;
-  kmem.freelist = r;
+  push(r);
+  if((b = block(pa)) >= 0 && ++kmem.nfree[b] == SUPERPGSIZE / PGSIZE){
+    // the whole block is free: make it a superpage again.
+    char *s = (char*)KERNBASE + (uint64)b * SUPERPGSIZE;
+    for(int i = 0; i < SUPERPGSIZE / PGSIZE; i++)
+      unlink((struct run*)(s + i*PGSIZE));
+    kmem.nfree[b] = 0;
+    r = (struct run*)s;
+    r->next = kmem.superlist;
+    kmem.superlist = r;
+  }
   release(&kmem.lock);
 }
 
+// One more reference to page pa, which kfree() drops.
+void
+kref(void *pa)
+{
+  if(((uint64)pa % PGSIZE) != 0 || (char*)pa < end || (uint64)pa >= PHYSTOP)
+    panic("kref");
+  __sync_fetch_and_add(&KREF(pa), 1);
+}
+
 // Allocate one 4096-byte page of physical memory.
 // Returns a pointer that the kernel can use.
 // Returns 0 if the memory cannot be allocated. // 删除并返回空闲列表中的第一个元素。
@@ -69,14 +148,67 @@ void *
 kalloc(void)
 {
   struct run *r;
+  int b, i;
 
   acquire(&kmem.lock);
+  if(kmem.freelist == 0 && kmem.superlist){
+    // out of pages: split a superpage.
+    r = kmem.superlist;
+    kmem.superlist = r->next;
+    for(i = 0; i < SUPERPGSIZE / PGSIZE; i++)
+      push((struct run*)((char*)r + i*PGSIZE));
+    kmem.nfree[block(r)] = SUPERPGSIZE / PGSIZE;
+  }
   r = kmem.freelist;
-  if(r)
-    kmem.freelist = r->next;
+  if(r){
+    unlink(r);
+    if((b = block(r)) >= 0)
+      kmem.nfree[b]--;
+  }
   release(&kmem.lock);
 
   if(r)
     memset((char*)r, 5, PGSIZE); // fill with junk
+  else if(pcreclaim() > 0)
+    return kalloc(); // the page cache gave some back
+  return (void*)r;
+}
+
+// Free a superpage returned by superalloc().
+void
+superfree(void *pa)
+{
+  struct run *r;
+
+  if(((uint64)pa % SUPERPGSIZE) != 0 || block(pa) < 0 || (uint64)pa >= PHYSTOP)
+    panic("superfree");
+
+  memset(pa, 1, SUPERPGSIZE);
+
+  r = (struct run*)pa;
+
+  acquire(&kmem.lock);
+  r->next = kmem.superlist;
+  kmem.superlist = r;
+  release(&kmem.lock);
+}
+
+// Allocate one 2-megabyte superpage, aligned to 2 MB.
+// Returns 0 if there is none free, and the caller
+// makes do with pages. Parts of it may later be
+// kfree()d a page at a time.
+void *
+superalloc(void)
+{
+  struct run *r;
+
+  acquire(&kmem.lock);
+  r = kmem.superlist;
+  if(r)
+    kmem.superlist = r->next;
+  release(&kmem.lock);
+
+  if(r)
+    memset((char*)r, 5, SUPERPGSIZE); // fill with junk
   return (void*)r;
 }
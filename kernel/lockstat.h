@@ -0,0 +1,22 @@
+// Statistics about locks, shared by all the locks
+// that were initialized with the same name.
+// Both the kernel and user programs use this header file.
+#define LOCKNAME  16
+#define LOCKSITES 4   // call sites kept per lock name
+
+// Times are in cycles for spinlocks, but in CLINT_MTIME
+// units (MTIME_FREQ per second) for sleep locks, since a
+// process waiting for a sleep lock may move between harts.
+struct lockstat {
+  char name[LOCKNAME]; // Name passed to initlock() or initsleeplock()
+  int sleep;           // Sleep locks rather than spinlocks?
+  int ticket;          // Fair ticket locks rather than test-and-set?
+  int nlocks;          // Number of locks initialized with this name
+  uint64 nacquire;     // Acquisitions
+  uint64 ncontended;   // Acquisitions that had to wait
+  uint64 nspin;        // Iterations spent spinning (or sleeping) waiting
+  uint64 waitcycles;   // Time spent waiting
+  uint64 holdcycles;   // Time from acquisition to release
+  uint64 sitepc[LOCKSITES];    // Callers with the most contended
+  uint64 sitecount[LOCKSITES]; // acquisitions, and how many
+};
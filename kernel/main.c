@@ -24,11 +24,19 @@ main()
     procinit();      // process table 每个进程分配一个内核栈
     trapinit();      // trap vectors
     trapinithart();  // install kernel trap vector 安装内核trap vec
+    xregsinit();    // FP and vector registers
     plicinit();      // set up interrupt controller // 设置中断控制器
     plicinithart();  // ask PLIC for device interrupts // 告诉PLIC该CPU对设备中断感兴趣
     binit();         // buffer cache 
+    pcinit();        // page cache for file data
     iinit();         // inode cache
     fileinit();      // file table
+    profinit();      // sampling profiler device
+    traceinit();     // system call tracing
+    futexinit();     // futex buckets
+    shminit();       // shared memory objects
+    pollinit();      // poll() wait queues
+    sockinit();      // Unix domain sockets
     virtio_disk_init(); // emulated hard disk
     userinit();      // first user process
     __sync_synchronize(); // 告诉编译器不能改变指令顺序
@@ -27,8 +27,15 @@
 
 // local interrupt controller, which contains the timer.
 #define CLINT 0x2000000L
+#define CLINT_MSIP(hartid) (CLINT + 4*(hartid)) // software interrupt (IPI).
 #define CLINT_MTIMECMP(hartid) (CLINT + 0x4000 + 8*(hartid))
 #define CLINT_MTIME (CLINT + 0xBFF8) // cycles since boot.
+#define MTIME_FREQ 10000000          // CLINT_MTIME cycles per second in qemu.
+
+// why timervec in kernelvec.S raised a supervisor software interrupt.
+#define TIMER_TICK    1  // periodic clock interrupt
+#define TIMER_ONESHOT 2  // one-shot interrupt armed by timerarm()
+#define TIMER_IPI     4  // another hart called ipi() on this one
  
 // qemu puts programmable interrupt controller here.
 #define PLIC 0x0c000000L
@@ -55,6 +62,12 @@
 // each surrounded by invalid guard pages. p是0-63相当于给每一个内核进程分配两页，一页就是内核栈，一页是guard page
 #define KSTACK(p) (TRAMPOLINE - ((p)+1)* 2*PGSIZE)
 
+// each process's kernel page table (p->kpagetable) also
+// maps the process's user memory below UKSIZE at UKBASE,
+// for copyin() and copyout() (vmcopyin.c).
+#define UKBASE 0x1000000000L  // level-2 index 64
+#define UKSIZE (1L << 30)     // what one level-2 PTE maps
+
 // User memory layout.
 // Address zero first:
 //   text
@@ -62,6 +75,21 @@
 //   fixed-size stack
 //   expandable heap
 //   ...
+//   mmap() regions, down from MMAPTOP
+//   ...
+//   THREADFRAME(i) (trapframes of threads made by clone())
+//   USHARED (ushared, read-only, the same page in every process)
+//   USYSCALL (p->usyscall, read-only)
 //   TRAPFRAME (p->trapframe, used by the trampoline)
 //   TRAMPOLINE (the same page as in the kernel)
 #define TRAPFRAME (TRAMPOLINE - PGSIZE)
+#define USYSCALL  (TRAPFRAME - PGSIZE)
+#define USHARED   (USYSCALL - PGSIZE)
+
+// the trapframe of a thread in proc[] slot i, in the page
+// table it shares with the rest of its process.
+#define THREADFRAME(i) (USHARED - ((i)+1)*PGSIZE)
+
+// mmap() places regions below here, where copyin()
+// and copyout() can reach them through UKBASE.
+#define MMAPTOP   UKSIZE
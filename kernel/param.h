@@ -1,6 +1,9 @@
 #define NPROC        64  // maximum number of processes
 #define NCPU          8  // maximum number of CPUs
 #define NOFILE       16  // open files per process
+#define NVMA         16  // mmap() regions per process
+#define NSHM         32  // shared memory objects per system
+#define NSOCK        32  // sockets per system
 #define NFILE       100  // open files per system
 #define NINODE       50  // maximum number of active i-nodes
 #define NDEV         10  // maximum major device number
@@ -9,5 +12,8 @@
 #define MAXOPBLOCKS  10  // max # of blocks any FS op writes
 #define LOGSIZE      (MAXOPBLOCKS*3)  // max data blocks in on-disk log
 #define NBUF         (MAXOPBLOCKS*3)  // size of disk block cache
+#define NPCACHE      1024  // pages of file data in the page cache
 #define FSSIZE       1000  // size of file system in blocks
 #define MAXPATH      128   // maximum file path name
+#define TLBFLUSHMAX  32    // flush pages one by one up to this many
+#define NLOCKSTAT    64    // distinct lock names with statistics
@@ -0,0 +1,304 @@
+//
+// Page cache: file data, in 4096-byte pages, indexed by
+// (dev, inum, page number in the file). readi() and writei()
+// use it for T_FILE inodes, and mmap(MAP_SHARED) maps its
+// pages into user memory directly. Directories, inodes,
+// bitmap blocks and the log stay in the buffer cache (bio.c),
+// so a large file read no longer pushes them out of it.
+//
+// Pages are filled with bpeek(), which doesn't keep the blocks
+// in the buffer cache. Writes still go through the buffer
+// cache and the log, and writei() copies them into the page
+// if it is cached. Callers of pcget() and pclookup() hold the
+// inode's lock, so a page is never filled or written twice at
+// once; mappings only hold a reference (pg->ref).
+//
+// Pages no one refers to stay cached, least recently used
+// last, and kalloc() takes them back with pcreclaim() when
+// it runs out of memory.
+//
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+#include "pcache.h"
+#include "defs.h"
+
+#define NPCHASH 127
+
+struct {
+  struct spinlock lock;
+  struct page page[NPCACHE];
+  struct page *hash[NPCHASH];
+
+  // all pages, through prev/next. head.next is most recently
+  // used; unused slots (data == 0) are kept at the end.
+  struct page head;
+} pcache;
+
+static uint
+pchash(uint dev, uint inum, uint pgno)
+{
+  return (dev * 31 + inum * 17 + pgno) % NPCHASH;
+}
+
+// take pg out of the list.
+static void
+pcunlink(struct page *pg)
+{
+  pg->next->prev = pg->prev;
+  pg->prev->next = pg->next;
+}
+
+static void
+pcfront(struct page *pg)
+{
+  pcunlink(pg);
+  pg->next = pcache.head.next;
+  pg->prev = &pcache.head;
+  pcache.head.next->prev = pg;
+  pcache.head.next = pg;
+}
+
+static void
+pcback(struct page *pg)
+{
+  pcunlink(pg);
+  pg->next = &pcache.head;
+  pg->prev = pcache.head.prev;
+  pcache.head.prev->next = pg;
+  pcache.head.prev = pg;
+}
+
+// take pg out of the hash table, so that no one finds it.
+// Caller must hold pcache.lock.
+static void
+pcunhash(struct page *pg)
+{
+  struct page **pp;
+
+  if(!pg->hashed)
+    return;
+  for(pp = &pcache.hash[pchash(pg->dev, pg->inum, pg->pgno)]; *pp; pp = &(*pp)->hnext){
+    if(*pp == pg){
+      *pp = pg->hnext;
+      break;
+    }
+  }
+  pg->hashed = 0;
+}
+
+// Caller must hold pcache.lock.
+static struct page*
+pcfind(uint dev, uint inum, uint pgno)
+{
+  struct page *pg;
+
+  for(pg = pcache.hash[pchash(dev, inum, pgno)]; pg; pg = pg->hnext)
+    if(pg->dev == dev && pg->inum == inum && pg->pgno == pgno)
+      return pg;
+  return 0;
+}
+
+void
+pcinit(void)
+{
+  struct page *pg;
+
+  initlock(&pcache.lock, "pcache");
+  pcache.head.prev = &pcache.head;
+  pcache.head.next = &pcache.head;
+  for(pg = pcache.page; pg < pcache.page+NPCACHE; pg++){
+    pg->next = pcache.head.next;
+    pg->prev = &pcache.head;
+    pcache.head.next->prev = pg;
+    pcache.head.next = pg;
+  }
+}
+
+// read page pg->pgno of ip into pg->data, with zeroes past
+// the end of the file.
+static void
+pcfill(struct inode *ip, struct page *pg)
+{
+  uint off = pg->pgno * PGSIZE;
+  int i;
+
+  for(i = 0; i < PGSIZE; i += BSIZE){
+    if(off + i >= ip->size){
+      memset(pg->data + i, 0, PGSIZE - i);
+      break;
+    }
+    bpeek(ip->dev, bmap(ip, (off + i) / BSIZE), pg->data + i);
+  }
+  if(off < ip->size && ip->size - off < PGSIZE)
+    memset(pg->data + (ip->size - off), 0, PGSIZE - (ip->size - off));
+}
+
+// Return page pgno of ip, reading it in if it isn't cached,
+// with a reference that pcput() drops. Returns 0 if all the
+// pages are in use or out of memory.
+// Caller must hold ip->lock.
+struct page*
+pcget(struct inode *ip, uint pgno)
+{
+  struct page *pg;
+
+  acquire(&pcache.lock);
+  if((pg = pcfind(ip->dev, ip->inum, pgno)) != 0){
+    pg->ref++;
+    release(&pcache.lock);
+    return pg;
+  }
+
+  // recycle the least recently used page no one refers to,
+  // keeping its memory.
+  for(pg = pcache.head.prev; pg != &pcache.head; pg = pg->prev)
+    if(pg->ref == 0)
+      break;
+  if(pg == &pcache.head){
+    release(&pcache.lock);
+    return 0;
+  }
+  pcunhash(pg);
+  pg->dev = ip->dev;
+  pg->inum = ip->inum;
+  pg->pgno = pgno;
+  pg->ref = 1;
+  pcfront(pg);
+  release(&pcache.lock);
+
+  // not hashed yet, and pcreclaim() leaves it alone
+  // since ref is 1.
+  if(pg->data == 0 && (pg->data = kalloc()) == 0){
+    pcput(pg);
+    return 0;
+  }
+  pcfill(ip, pg);
+
+  acquire(&pcache.lock);
+  pg->hnext = pcache.hash[pchash(pg->dev, pg->inum, pgno)];
+  pcache.hash[pchash(pg->dev, pg->inum, pgno)] = pg;
+  pg->hashed = 1;
+  release(&pcache.lock);
+  return pg;
+}
+
+// Page pgno of ip with a reference, if it is cached, else 0.
+// Caller must hold ip->lock.
+struct page*
+pclookup(struct inode *ip, uint pgno)
+{
+  struct page *pg;
+
+  acquire(&pcache.lock);
+  if((pg = pcfind(ip->dev, ip->inum, pgno)) != 0)
+    pg->ref++;
+  release(&pcache.lock);
+  return pg;
+}
+
+// Drop a reference from pcget() or pclookup().
+void
+pcput(struct page *pg)
+{
+  acquire(&pcache.lock);
+  if(pg->ref < 1)
+    panic("pcput");
+  pg->ref--;
+  if(pg->ref == 0){
+    if(pg->hashed)
+      pcfront(pg);
+    else
+      pcback(pg);
+  }
+  release(&pcache.lock);
+}
+
+// the page of ip holding pa, which a mapping refers to.
+// Usually it is still page pgno; if ip was truncated since,
+// it is no longer in the hash table.
+// Caller must hold pcache.lock.
+static struct page*
+pcmapped(struct inode *ip, uint pgno, char *pa)
+{
+  struct page *pg;
+
+  if((pg = pcfind(ip->dev, ip->inum, pgno)) != 0 && pg->data == pa)
+    return pg;
+  for(pg = pcache.page; pg < pcache.page+NPCACHE; pg++)
+    if(pg->data == pa && pg->ref > 0)
+      return pg;
+  panic("pcmapped");
+}
+
+// Another mapping of pa, page pgno of ip, by fork().
+void
+pcdup(struct inode *ip, uint pgno, char *pa)
+{
+  acquire(&pcache.lock);
+  pcmapped(ip, pgno, pa)->ref++;
+  release(&pcache.lock);
+}
+
+// A mapping of pa, page pgno of ip, is gone.
+void
+pcunmap(struct inode *ip, uint pgno, char *pa)
+{
+  struct page *pg;
+
+  acquire(&pcache.lock);
+  pg = pcmapped(ip, pgno, pa);
+  release(&pcache.lock);
+  pcput(pg);
+}
+
+// ip is being truncated: forget its pages. Pages that are
+// still mapped stay with their mappings until unmapped.
+// Caller must hold ip->lock.
+void
+pcinval(struct inode *ip)
+{
+  struct page *pg;
+
+  acquire(&pcache.lock);
+  for(pg = pcache.page; pg < pcache.page+NPCACHE; pg++){
+    if(pg->hashed && pg->dev == ip->dev && pg->inum == ip->inum){
+      pcunhash(pg);
+      if(pg->ref == 0)
+        pcback(pg);
+    }
+  }
+  release(&pcache.lock);
+}
+
+// Out of memory: free up to PCRECLAIM of the least recently
+// used pages no one refers to. Called by kalloc().
+// Returns how many were freed.
+#define PCRECLAIM 32
+int
+pcreclaim(void)
+{
+  struct page *pg;
+  char *freed[PCRECLAIM];
+  int i, n = 0;
+
+  acquire(&pcache.lock);
+  for(pg = pcache.head.prev; pg != &pcache.head && n < PCRECLAIM; pg = pg->prev){
+    if(pg->ref == 0 && pg->data){
+      pcunhash(pg);
+      freed[n++] = pg->data;
+      pg->data = 0;
+    }
+  }
+  release(&pcache.lock);
+
+  for(i = 0; i < n; i++)
+    kfree(freed[i]);
+  return n;
+}
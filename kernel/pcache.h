@@ -0,0 +1,11 @@
+struct page {
+  uint dev;
+  uint inum;
+  uint pgno;         // offset in the file / PGSIZE
+  int hashed;        // can pcget() find it?
+  int ref;           // pcget()/pclookup() callers and mappings
+  char *data;        // PGSIZE bytes from kalloc(), or 0
+  struct page *prev; // LRU list
+  struct page *next;
+  struct page *hnext; // hash chain
+};
@@ -7,6 +7,7 @@
 #include "fs.h"
 #include "sleeplock.h"
 #include "file.h"
+#include "poll.h"
 
 #define PIPESIZE 512
 //管道
@@ -17,6 +18,7 @@ struct pipe {
   uint nwrite;    // number of bytes written
   int readopen;   // read fd is still open
   int writeopen;  // write fd is still open
+  struct waitq wq; // poll()s of either end
 };
 // f0 read, f1 write
 int
@@ -34,6 +36,7 @@ pipealloc(struct file **f0, struct file **f1)
   pi->writeopen = 1;
   pi->nwrite = 0;
   pi->nread = 0;
+  pi->wq.head = 0;
   initlock(&pi->lock, "pipe");
   (*f0)->type = FD_PIPE;
   (*f0)->readable = 1;
@@ -66,6 +69,7 @@ pipeclose(struct pipe *pi, int writable)
     pi->readopen = 0;
     wakeup(&pi->nwrite);
   }
+  pollwakeup(&pi->wq);
   if(pi->readopen == 0 && pi->writeopen == 0){
     release(&pi->lock);
     kfree((char*)pi);
@@ -73,8 +77,10 @@ pipeclose(struct pipe *pi, int writable)
     release(&pi->lock);
 }
 
+// with nonblock, write what fits, and return -1 if nothing
+// does.
 int
-pipewrite(struct pipe *pi, uint64 addr, int n)
+pipewrite(struct pipe *pi, uint64 addr, int n, int nonblock)
 {
   int i;
   char ch;
@@ -88,6 +94,9 @@ pipewrite(struct pipe *pi, uint64 addr, int n)
         return -1;
       }
       wakeup(&pi->nread); // 唤醒pi->nread这条chan上的线程让他读
+      pollwakeup(&pi->wq);
+      if(nonblock)
+        goto full;
       sleep(&pi->nwrite, &pi->lock); // 自己休眠在pi->nwrite这条chan上
     }
     if(copyin(pr->pagetable, &ch, addr + i, 1) == -1)
@@ -95,12 +104,18 @@ pipewrite(struct pipe *pi, uint64 addr, int n)
     pi->data[pi->nwrite++ % PIPESIZE] = ch;
   }
   wakeup(&pi->nread);
+  pollwakeup(&pi->wq);
   release(&pi->lock);
   return i;
+
+ full:
+  release(&pi->lock);
+  return i > 0 ? i : -1;
 }
 
+// with nonblock, return -1 rather than wait for a writer.
 int
-piperead(struct pipe *pi, uint64 addr, int n)
+piperead(struct pipe *pi, uint64 addr, int n, int nonblock)
 {
   int i;
   struct proc *pr = myproc();
@@ -108,7 +123,7 @@ piperead(struct pipe *pi, uint64 addr, int n)
 
   acquire(&pi->lock);
   while(pi->nread == pi->nwrite && pi->writeopen){  //DOC: pipe-empty 管道里面没有数据
-    if(pr->killed){
+    if(pr->killed || nonblock){
       release(&pi->lock);
       return -1;
     }
@@ -122,6 +137,31 @@ piperead(struct pipe *pi, uint64 addr, int n)
       break;
   }
   wakeup(&pi->nwrite);  //DOC: piperead-wakeup
+  pollwakeup(&pi->wq);
   release(&pi->lock);
   return i;
 }
+
+// which of events are ready on pi's read end, or its write
+// end if writable, and have pt, if any, wait for pi.
+int
+pipepoll(struct pipe *pi, int writable, int events, struct poller *pt)
+{
+  int r = 0;
+
+  acquire(&pi->lock);
+  if(writable){
+    if(pi->readopen == 0)
+      r |= POLLERR;
+    else if(pi->nwrite != pi->nread + PIPESIZE)
+      r |= POLLOUT;
+  } else {
+    if(pi->nread != pi->nwrite)
+      r |= POLLIN;
+    if(pi->writeopen == 0)
+      r |= POLLHUP;
+  }
+  pollwait(&pi->wq, pt);
+  release(&pi->lock);
+  return r & (events | POLLERR | POLLHUP);
+}
@@ -0,0 +1,232 @@
+//
+// poll(): wait until one of several files is ready to be
+// read or written, or a timeout.
+//
+// Things that can become ready (pipes, the console) have a
+// struct waitq. Asked whether it is ready, such a thing puts
+// the poller on its queue with pollwait(), holding its own
+// lock, so no change can slip in between the look and the
+// wait; whatever makes it ready calls pollwakeup(), which
+// calls the wake function of everything on the queue. Files
+// that are always ready (on disk) have no queue. poll() takes
+// itself off the queues once it wakes up, and looks at all
+// its files again; epoll sets (epoll.c) stay on them.
+//
+// A timeout puts the poller on polltimeq as well, which the
+// one-shot timer interrupt (hrtimerintr()) wakes.
+//
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+#include "poll.h"
+#include "defs.h"
+
+// a process in poll().
+struct pollwaiter {
+  struct poller pt;
+  int woken;                     // something it waits for happened
+  int n;                         // ent[] in use
+  struct pollent ent[NOFILE+1];  // one per file, and polltimeq
+};
+
+struct spinlock polllock;
+struct waitq polltimeq;
+
+void
+pollinit(void)
+{
+  initlock(&polllock, "poll");
+}
+
+// put e on wq.
+void
+pollqueue(struct waitq *wq, struct pollent *e)
+{
+  e->wq = wq;
+  acquire(&polllock);
+  e->next = wq->head;
+  wq->head = e;
+  release(&polllock);
+}
+
+// take e off its queue, if it is on one.
+void
+pollunqueue(struct pollent *e)
+{
+  struct pollent **pp;
+
+  if(e->wq == 0)
+    return;
+  acquire(&polllock);
+  for(pp = &e->wq->head; *pp; pp = &(*pp)->next){
+    if(*pp == e){
+      *pp = e->next;
+      break;
+    }
+  }
+  release(&polllock);
+  e->wq = 0;
+}
+
+// called by poll functions: have pt, if not 0, wait for wq
+// too. the caller holds the lock of what wq belongs to.
+void
+pollwait(struct waitq *wq, struct poller *pt)
+{
+  if(pt)
+    pt->queue(pt, wq);
+}
+
+// what wq belongs to may have become ready: wake whoever
+// waits for it.
+void
+pollwakeup(struct waitq *wq)
+{
+  struct pollent *e;
+
+  // no lock for the common case of no one: pollwait() is
+  // called with the same lock held as we are.
+  if(wq->head == 0)
+    return;
+  acquire(&polllock);
+  for(e = wq->head; e; e = e->next)
+    e->wake(e);
+  release(&polllock);
+}
+
+// the one-shot timer went off. a poller joins polltimeq
+// before it arms the timer, on the hart it interrupts.
+void
+polltimer(void)
+{
+  pollwakeup(&polltimeq);
+}
+
+static void
+pollwake(struct pollent *e)
+{
+  struct pollwaiter *w = e->arg;
+
+  w->woken = 1;
+  wakeup(w);
+}
+
+static void
+pollwaiterqueue(struct poller *pt, struct waitq *wq)
+{
+  struct pollwaiter *w = pt->arg;
+  struct pollent *e;
+
+  if(w->n == NELEM(w->ent))
+    return;
+  e = &w->ent[w->n++];
+  e->wake = pollwake;
+  e->arg = w;
+  pollqueue(wq, e);
+}
+
+// take w off all its queues.
+static void
+pollend(struct pollwaiter *w)
+{
+  int i;
+
+  for(i = 0; i < w->n; i++)
+    pollunqueue(&w->ent[i]);
+  w->n = 0;
+}
+
+// which of events are ready on f, and have pt, if any,
+// wait for f.
+int
+filepoll(struct file *f, int events, struct poller *pt)
+{
+  int r;
+
+  if(f->type == FD_PIPE)
+    return pipepoll(f->pipe, f->writable, events, pt);
+  if(f->type == FD_SOCK)
+    return sockpoll(f->sock, events, pt);
+  if(f->type == FD_DEVICE && f->major >= 0 && f->major < NDEV && devsw[f->major].poll)
+    return devsw[f->major].poll(events, pt);
+  r = 0;
+  if(f->readable)
+    r |= POLLIN;
+  if(f->writable)
+    r |= POLLOUT;
+  return r & events;
+}
+
+// Wait until one of the nfds struct pollfd at user address
+// addr is ready, or for timeout milliseconds; -1 is forever,
+// and 0 doesn't wait. Returns how many are ready, or -1.
+int
+poll(uint64 addr, int nfds, int timeout)
+{
+  struct proc *p = myproc();
+  struct pollfd fds[NOFILE];
+  struct file *files[NOFILE];
+  struct pollwaiter w;
+  uint64 deadline = 0;
+  int i, n, wait;
+
+  if(nfds < 0 || nfds > NOFILE)
+    return -1;
+  if(copyin(p->pagetable, (char*)fds, addr, nfds * sizeof(fds[0])) < 0)
+    return -1;
+  for(i = 0; i < nfds; i++)
+    files[i] = fds[i].fd >= 0 ? fdfile(fds[i].fd) : 0;
+  if(timeout > 0)
+    deadline = readmtime() + (uint64)timeout * MTIME_FREQ / 1000;
+
+  w.pt.queue = pollwaiterqueue;
+  w.pt.arg = &w;
+  w.n = 0;
+  for(;;){
+    wait = timeout != 0 && (deadline == 0 || readmtime() < deadline);
+    w.woken = 0;
+    n = 0;
+    for(i = 0; i < nfds; i++){
+      if(fds[i].fd < 0)
+        fds[i].revents = 0;
+      else if(files[i] == 0)
+        fds[i].revents = POLLNVAL;
+      else
+        fds[i].revents = filepoll(files[i], fds[i].events, wait ? &w.pt : 0);
+      if(fds[i].revents)
+        n++;
+    }
+    if(n > 0 || !wait || p->killed)
+      break;
+    if(deadline)
+      pollwait(&polltimeq, &w.pt);
+
+    acquire(&polllock);
+    while(!w.woken && !p->killed){
+      // holding polllock keeps interrupts off, so the
+      // one-shot is armed on the hart that will see it.
+      if(deadline)
+        timerarm(deadline);
+      sleep(&w, &polllock);
+    }
+    release(&polllock);
+    pollend(&w);
+  }
+  pollend(&w);
+
+  for(i = 0; i < nfds; i++)
+    if(files[i])
+      fileclose(files[i]);
+  if(p->killed)
+    return -1;
+  if(copyout(p->pagetable, addr, (char*)fds, nfds * sizeof(fds[0])) < 0)
+    return -1;
+  return n;
+}
@@ -0,0 +1,17 @@
+// poll(): what to wait for on each file descriptor.
+// Both the kernel and user programs use this header file.
+
+struct pollfd {
+  int fd;          // ignored if negative
+  short events;    // POLLIN and/or POLLOUT
+  short revents;   // what is ready, filled in by poll()
+};
+
+#define POLLIN   0x001  // read() won't block
+#define POLLOUT  0x004  // write() won't block
+#define POLLERR  0x008  // nothing will read what is written
+#define POLLHUP  0x010  // nothing more will be written
+#define POLLNVAL 0x020  // fd isn't open
+
+// POLLERR, POLLHUP and POLLNVAL are reported whether asked
+// for or not.
@@ -4,7 +4,9 @@
 #include "riscv.h"
 #include "spinlock.h"
 #include "proc.h"
+#include "syscall.h"
 #include "defs.h"
+#include "vdso.h"
 
 struct cpu cpus[NCPU];
 
@@ -16,7 +18,10 @@ int nextpid = 1;
 struct spinlock pid_lock;
 
 extern void  forkret(void);
+static void kthreadret(void);
 static void wakeup1(struct proc *chan);
+static void wakethreads(struct proc *g);
+static void kickidle(int n);
 static void freeproc(struct proc *p);
 
 extern char trampoline[]; // trampoline.S
@@ -41,6 +46,10 @@ procinit(void)
       // 分配了两页虚拟内存，但是只有上面那一页映射到了物理内存，下面那页是无效页也就是gurad page
       kvmmap(va, (uint64)pa, PGSIZE, PTE_R | PTE_W);
       p->kstack = va;
+
+      // each slot keeps the same two ASIDs.
+      p->asid = kvmasid(p - proc);
+      p->uasid = p->asid ? p->asid + 1 : 0;
   }
   kvminithart(); // 将内核页表重新加载到satp中，以便硬件知道新的PTE。
 }
@@ -90,8 +99,10 @@ allocpid() {
 // If found, initialize state required to run in the kernel,
 // and return with p->lock held.
 // If there are no free procs, or a memory allocation fails, return 0. // 这里已经获取了p的锁
+// With leader != 0, the proc is a thread of leader's
+// process (clone()): it uses leader's user page table.
 static struct proc*
-allocproc(void)
+allocproc(struct proc *leader)
 {
   struct proc *p;
 
@@ -114,13 +125,50 @@ found:
     return 0;
   }
 
-  // An empty user page table.
-  p->pagetable = proc_pagetable(p);
-  if(p->pagetable == 0){
+  if(leader){
+    // a thread: map its trapframe into the shared page
+    // table, at an address of its own.
+    p->leader = leader;
+    p->pagetable = leader->pagetable;
+    if(mappages(p->pagetable, THREADFRAME(p - proc), PGSIZE,
+                (uint64)(p->trapframe), PTE_R | PTE_W) < 0){
+      freeproc(p);
+      release(&p->lock);
+      return 0;
+    }
+    p->tfva = THREADFRAME(p - proc);
+  } else {
+    p->leader = p;
+    p->tfva = TRAPFRAME;
+
+    // Allocate the page user programs read their pid from.
+    if((p->usyscall = (struct usyscall *)kalloc()) == 0){
+      freeproc(p);
+      release(&p->lock);
+      return 0;
+    }
+    memset(p->usyscall, 0, PGSIZE);
+    p->usyscall->pid = p->pid;
+
+    // An empty user page table.
+    p->pagetable = proc_pagetable(p);
+    if(p->pagetable == 0){
+      freeproc(p);
+      release(&p->lock);
+      return 0;
+    }
+  }
+
+  // and a kernel page table that maps it too.
+  p->kpagetable = kvmcreate(p->pagetable);
+  if(p->kpagetable == 0){
     freeproc(p);
     release(&p->lock);
     return 0;
   }
+  // the TLBs may hold the previous process's entries
+  // under this slot's ASIDs.
+  p->tlbstale = ~0L;
 
   // Set up new context to start executing at forkret,
   // which returns to user space.
@@ -137,9 +185,31 @@ found:
 static void
 freeproc(struct proc *p)
 {
+  if(p->leader != p){
+    // a thread (or nothing yet): its trapframe's mapping is
+    // all it has of the shared page table. only p's ASIDs
+    // ever used it, and allocproc() has those flushed.
+    if(p->tfva)
+      *walk(p->pagetable, p->tfva, 0) = 0;
+    p->pagetable = 0;
+  }
+  p->tfva = 0;
+  p->leader = 0;
+  p->nthreads = 0;
+  p->vmbusy = 0;
+  p->ending = 0;
+  p->kfn = 0;
+  p->karg = 0;
   if(p->trapframe)
     kfree((void*)p->trapframe);
   p->trapframe = 0;
+  if(p->usyscall)
+    kfree((void*)p->usyscall);
+  p->usyscall = 0;
+  xregsfree(p);
+  if(p->kpagetable)
+    kvmfree(p->kpagetable);
+  p->kpagetable = 0;
   if(p->pagetable)
     proc_freepagetable(p->pagetable, p->sz);
   p->pagetable = 0;
@@ -150,6 +220,7 @@ freeproc(struct proc *p)
   p->chan = 0;
   p->killed = 0;
   p->xstate = 0;
+  p->tracemask = 0;
   p->state = UNUSED;
 }
 
@@ -165,12 +236,19 @@ proc_pagetable(struct proc *p)
   if(pagetable == 0)
     return 0;
 
+  // the process's kernel page table shares the level-1
+  // page for low user memory (kvmcreate()), so make it now.
+  if(walk(pagetable, 0, 1) == 0){
+    uvmfree(pagetable, 0);
+    return 0;
+  }
+
   // map the trampoline code (for system call return)
   // at the highest user virtual address.
   // only the supervisor uses it, on the way
   // to/from user space, so not PTE_U.
   if(mappages(pagetable, TRAMPOLINE, PGSIZE,
-              (uint64)trampoline, PTE_R | PTE_X) < 0){
+              (uint64)trampoline, PTE_R | PTE_X | PTE_G) < 0){
     uvmfree(pagetable, 0);
     return 0;
   }
@@ -183,6 +261,24 @@ proc_pagetable(struct proc *p)
     return 0;
   }
 
+  // map the read-only pages that getpid() and uptime()
+  // in ulib.c read instead of making system calls.
+  if(mappages(pagetable, USYSCALL, PGSIZE,
+              (uint64)(p->usyscall), PTE_R | PTE_U) < 0){
+    uvmunmap(pagetable, TRAMPOLINE, 1, 0);
+    uvmunmap(pagetable, TRAPFRAME, 1, 0);
+    uvmfree(pagetable, 0);
+    return 0;
+  }
+  if(mappages(pagetable, USHARED, PGSIZE,
+              (uint64)ushared, PTE_R | PTE_U) < 0){
+    uvmunmap(pagetable, TRAMPOLINE, 1, 0);
+    uvmunmap(pagetable, TRAPFRAME, 1, 0);
+    uvmunmap(pagetable, USYSCALL, 1, 0);
+    uvmfree(pagetable, 0);
+    return 0;
+  }
+
   return pagetable;
 }
 
@@ -193,6 +289,8 @@ proc_freepagetable(pagetable_t pagetable, uint64 sz)
 {
   uvmunmap(pagetable, TRAMPOLINE, 1, 0);
   uvmunmap(pagetable, TRAPFRAME, 1, 0);
+  uvmunmap(pagetable, USYSCALL, 1, 0);
+  uvmunmap(pagetable, USHARED, 1, 0);
   uvmfree(pagetable, sz);
 }
 
@@ -214,7 +312,7 @@ userinit(void)
 {
   struct proc *p;
 
-  p = allocproc();
+  p = allocproc(0);
   initproc = p;
   
   // allocate one user page and copy init's instructions
@@ -236,24 +334,62 @@ userinit(void)
 
 // Grow or shrink user memory by n bytes.
 // Return 0 on success, -1 on failure. 用于进程减少或增长其内存
+// Caller must hold vmlock().
 int
 growproc(int n)
 {
   uint sz;
-  struct proc *p = myproc();
+  struct proc *p = myproc(), *g = p->leader;
 
-  sz = p->sz;
+  sz = g->sz;
   if(n > 0){
+    // the heap mustn't run into mmap() regions.
+    if(sz + n > vmalow(p))
+      return -1;
     if((sz = uvmalloc(p->pagetable, sz, sz + n)) == 0) {
       return -1;
     }
+    // RISC-V wants an sfence.vma even after a PTE goes
+    // from invalid to valid.
+    tlbflushrange(p, PGROUNDUP(g->sz), (PGROUNDUP(sz) - PGROUNDUP(g->sz)) / PGSIZE);
   } else if(n < 0){
-    sz = uvmdealloc(p->pagetable, sz, sz + n);
+    if((sz = uvmdealloc(p->pagetable, sz, sz + n)) == g->sz)
+      return -1;
   }
-  p->sz = sz;
+  g->sz = sz;
   return 0;
 }
 
+// The threads of p's process change its memory one at a
+// time: growproc(), mmap(), munmap(), page faults in mmap()
+// regions, fork() and clone() hold this. Like a sleep-lock,
+// but it lives in the leader, which has none.
+void
+vmlock(struct proc *p)
+{
+  struct proc *g = p->leader;
+
+  acquire(&g->lock);
+  while(g->vmbusy)
+    sleep(&g->vmbusy, &g->lock);
+  g->vmbusy = 1;
+  release(&g->lock);
+}
+
+void
+vmunlock(struct proc *p)
+{
+  struct proc *g = p->leader;
+
+  acquire(&g->lock);
+  g->vmbusy = 0;
+  release(&g->lock);
+  // only threads of g can be sleeping on it; most
+  // processes have none.
+  if(g->nthreads > 0)
+    wakeup(&g->vmbusy);
+}
+
 // Create a new process, copying the parent.
 // Sets up child kernel stack to return as if from fork() system call.
 int
@@ -261,20 +397,34 @@ fork(void)
 {
   int i, pid;
   struct proc *np;
-  struct proc *p = myproc();
+  struct proc *p = myproc(), *g = p->leader;
+
+  // a thread copies its process's memory, which the other
+  // threads mustn't change meanwhile.
+  vmlock(p);
 
   // Allocate process.
-  if((np = allocproc()) == 0){
+  if((np = allocproc(0)) == 0){
+    vmunlock(p);
     return -1;
   }
 
   // Copy user memory from parent to child.
-  if(uvmcopy(p->pagetable, np->pagetable, p->sz) < 0){
-    freeproc(np);
-    release(&np->lock);
-    return -1;
+  if(uvmcopy(p->pagetable, np->pagetable, g->sz) < 0){
+    goto bad;
+  }
+  np->sz = g->sz;
+
+  // copy FP and vector registers, if p has used them.
+  if(xregsfork(p, np) < 0){
+    goto bad;
+  }
+
+  // and mmap() regions; this must be the last thing that
+  // can fail, since freeproc() doesn't undo it.
+  if(vmafork(p, np) < 0){
+    goto bad;
   }
-  np->sz = p->sz;
 
   np->parent = p;
 
@@ -285,20 +435,233 @@ fork(void)
   np->trapframe->a0 = 0;
 
   // increment reference counts on open file descriptors.
+  acquire(&g->lock);
   for(i = 0; i < NOFILE; i++)
-    if(p->ofile[i])
-      np->ofile[i] = filedup(p->ofile[i]);
-  np->cwd = idup(p->cwd);
+    if(g->ofile[i])
+      np->ofile[i] = filedup(g->ofile[i]);
+  np->cwd = idup(g->cwd);
+  release(&g->lock);
 
   safestrcpy(np->name, p->name, sizeof(p->name));
 
+  np->tracemask = p->tracemask;
+
   pid = np->pid;
 
   np->state = RUNNABLE;
 
   release(&np->lock);
+  vmunlock(p);
+
+  kickidle(1);
 
   return pid;
+
+ bad:
+  freeproc(np);
+  release(&np->lock);
+  vmunlock(p);
+  return -1;
+}
+
+// A new thread of the current process: a proc of its own,
+// sharing the process's page table, memory, open files and
+// cwd. Returns it with np->lock held, or 0.
+static struct proc*
+newthread(void)
+{
+  struct proc *np;
+  struct proc *p = myproc(), *g = p->leader;
+
+  // counted before allocproc(), whose np->lock comes after
+  // g->lock; and not while killthreads() is emptying g.
+  acquire(&g->lock);
+  if(g->ending || g->killed){
+    release(&g->lock);
+    return 0;
+  }
+  g->nthreads++;
+  release(&g->lock);
+
+  if((np = allocproc(g)) == 0){
+    acquire(&g->lock);
+    g->nthreads--;
+    wakeup1(g);
+    release(&g->lock);
+    return 0;
+  }
+
+  // killthreads() may have started since, and missed np,
+  // which wasn't g's yet.
+  __sync_synchronize();
+  if(g->ending)
+    np->killed = 1;
+
+  np->parent = g;
+  safestrcpy(np->name, p->name, sizeof(p->name));
+  np->tracemask = p->tracemask;
+  return np;
+}
+
+// Create a thread of the current process that runs fn(arg)
+// on the stack whose top is sp. Returns its id (a pid), or -1.
+int
+clone(uint64 fn, uint64 arg, uint64 sp)
+{
+  struct proc *np;
+  struct proc *p = myproc();
+  int tid;
+
+  if((np = newthread()) == 0)
+    return -1;
+  *(np->trapframe) = *(p->trapframe);
+  np->trapframe->epc = fn;
+  np->trapframe->a0 = arg;
+  np->trapframe->sp = sp;
+  // returning from fn faults; thread_create() makes it
+  // call exit() instead.
+  np->trapframe->ra = 0;
+
+  tid = np->pid;
+  np->state = RUNNABLE;
+  release(&np->lock);
+
+  kickidle(1);
+
+  return tid;
+}
+
+// Create a thread of the current process that runs fn(arg)
+// in the kernel and never returns to user space; fn ends it
+// with exit(), which it must do once it is killed. Returns
+// its id, or -1.
+int
+kthread(void (*fn)(void*), void *arg)
+{
+  struct proc *np;
+  int tid;
+
+  if((np = newthread()) == 0)
+    return -1;
+  np->kfn = fn;
+  np->karg = arg;
+  np->context.ra = (uint64)kthreadret;
+
+  tid = np->pid;
+  np->state = RUNNABLE;
+  release(&np->lock);
+
+  kickidle(1);
+
+  return tid;
+}
+
+// Wait for thread tid of the current process to exit, and
+// free it. Any thread can join any other, but only once.
+// Returns tid, or -1 if there is no such thread or the
+// caller was killed.
+int
+join(int tid, uint64 addr)
+{
+  struct proc *t;
+  struct proc *p = myproc(), *g = p->leader;
+  int found, xstate;
+
+  acquire(&g->lock);
+  for(;;){
+    found = 0;
+    for(t = proc; t < &proc[NPROC]; t++){
+      // only g's threads change t->leader while g->lock is
+      // held, so this check is stable.
+      if(t == p || t == g || t->leader != g || t->pid != tid)
+        continue;
+      acquire(&t->lock);
+      found = 1;
+      if(t->state == ZOMBIE){
+        xstate = t->xstate;
+        freeproc(t);
+        release(&t->lock);
+        release(&g->lock);
+        // after the locks, since it may fault in an mmap()
+        // page.
+        if(addr != 0 && copyout(p->pagetable, addr, (char *)&xstate, sizeof(xstate)) < 0)
+          return -1;
+        return tid;
+      }
+      release(&t->lock);
+    }
+
+    if(!found || p->killed){
+      release(&g->lock);
+      return -1;
+    }
+
+    // exit() wakes the threads sleeping on g.
+    sleep(g, &g->lock);
+  }
+}
+
+// Wake the threads of g sleeping on g: in join() and
+// killthreads(). Caller must hold g->lock.
+static void
+wakethreads(struct proc *g)
+{
+  struct proc *t;
+
+  wakeup1(g);
+  for(t = proc; t < &proc[NPROC]; t++){
+    if(t == g || t->leader != g || t == myproc())
+      continue;
+    acquire(&t->lock);
+    if(t->state == SLEEPING && t->chan == g)
+      t->state = RUNNABLE;
+    release(&t->lock);
+  }
+}
+
+// exit() or exec() in g, a process's first thread, is
+// about to free or replace what its threads share: kill
+// them, wait for them to exit, and free them, including
+// those that exited and were never join()ed.
+void
+killthreads(struct proc *g)
+{
+  struct proc *t;
+  int running;
+
+  acquire(&g->lock);
+  running = g->nthreads;
+  if(running)
+    g->ending = 1;
+  release(&g->lock);
+
+  for(t = proc; running && t < &proc[NPROC]; t++){
+    if(t == g || t->leader != g)
+      continue;
+    acquire(&t->lock);
+    if(t->leader == g){
+      t->killed = 1;
+      if(t->state == SLEEPING)
+        t->state = RUNNABLE;
+    }
+    release(&t->lock);
+  }
+  if(running)
+    kickidle(NCPU);
+
+  acquire(&g->lock);
+  while(g->nthreads > 0)
+    sleep(g, &g->lock);
+  for(t = proc; t < &proc[NPROC]; t++){
+    if(t == g || t->leader != g)
+      continue;
+    acquire(&t->lock);
+    if(t->state == ZOMBIE)
+      freeproc(t);
+    release(&t->lock);
+  }
+  g->ending = 0;
+  release(&g->lock);
 }
 
 // Pass p's abandoned children to init.
@@ -338,19 +701,39 @@ exit(int status)
   if(p == initproc)
     panic("init exiting");
 
-  // Close all open files. 关闭所有文件
-  for(int fd = 0; fd < NOFILE; fd++){
-    if(p->ofile[fd]){
-      struct file *f = p->ofile[fd];
-      fileclose(f);
-      p->ofile[fd] = 0;
-    }
+  // traced here rather than in syscall(), so that
+  // processes that are killed get a record too.
+  if((p->tracemask >> SYS_exit) & 1){
+    uint64 args[6] = { status };
+    uint64 t = readmtime();
+    tracesys(SYS_exit, args, status, t, t);
   }
 
-  begin_op();
-  iput(p->cwd);
-  end_op();
-  p->cwd = 0;
+  // a thread leaves the memory, files and cwd to the rest
+  // of its process; the process's first thread ends the
+  // others before it frees them.
+  if(p->leader == p){
+    killthreads(p);
+    uringfree(p);
+
+    // unmap mmap() regions, writing back shared ones,
+    // while their files are still open.
+    vmaexit(p);
+
+    // Close all open files. 关闭所有文件
+    for(int fd = 0; fd < NOFILE; fd++){
+      if(p->ofile[fd]){
+        struct file *f = p->ofile[fd];
+        fileclose(f);
+        p->ofile[fd] = 0;
+      }
+    }
+
+    begin_op();
+    iput(p->cwd);
+    end_op();
+    p->cwd = 0;
+  }
 
   // we might re-parent a child to init. we can't be precise about
   // waking up init, since we can't acquire its lock once we've
@@ -375,6 +758,13 @@ exit(int status)
   // the parent-then-child rule says we have to lock it first.
   acquire(&original_parent->lock);
 
+  // a thread's parent is its leader, where join() and
+  // killthreads() sleep.
+  if(p->leader != p){
+    p->leader->nthreads--;
+    wakethreads(p->leader);
+  }
+
   acquire(&p->lock); // 为了进入sched()获取的
 
   // Give any children to init.
@@ -399,7 +789,7 @@ int
 wait(uint64 addr)
 {
   struct proc *np;
-  int havekids, pid;
+  int havekids, pid, xstate;
   struct proc *p = myproc();
 
   // hold p->lock for the whole time to avoid lost
@@ -413,7 +803,8 @@ wait(uint64 addr)
       // this code uses np->parent without holding np->lock.
       // acquiring the lock first would cause a deadlock,
       // since np might be an ancestor, and we already hold p->lock.
-      if(np->parent == p){
+      // threads are join()ed instead.
+      if(np->parent == p && np->leader == np){
         // np->parent can't change between the check and the acquire()
         // because only the parent changes it, and we're the parent.
         acquire(&np->lock);
@@ -421,15 +812,15 @@ wait(uint64 addr)
         if(np->state == ZOMBIE){
           // Found one.
           pid = np->pid;
-          if(addr != 0 && copyout(p->pagetable, addr, (char *)&np->xstate,
-                                  sizeof(np->xstate)) < 0) {
-            release(&np->lock);
-            release(&p->lock);
-            return -1;
-          }
+          xstate = np->xstate;
           freeproc(np);
           release(&np->lock);
           release(&p->lock);
+          // copyout() may fault in an mmap() page, which
+          // takes vmlock(), so not with p->lock held.
+          if(addr != 0 && copyout(p->pagetable, addr, (char *)&xstate,
+                                  sizeof(xstate)) < 0)
+            return -1;
           return pid;
         }
         release(&np->lock);
@@ -464,6 +855,13 @@ scheduler(void)
   for(;;){
     // Avoid deadlock by ensuring that devices can interrupt.
     intr_on();
+
+    // Say we're idle before looking for work, not after,
+    // so that a wakeup() that races with the scan below
+    // sends an IPI that keeps us out of wfi, rather than
+    // leaving its process waiting for our next timer tick.
+    c->idle = 1;
+    __sync_synchronize();
     
     int found = 0;
     for(p = proc; p < &proc[NPROC]; p++) {
@@ -472,9 +870,15 @@ scheduler(void)
         // Switch to chosen process.  It is the process's job
         // to release its lock and then reacquire it
         // before jumping back to us.
+        c->idle = 0;
         p->state = RUNNING;
         c->proc = p;
+
+        // run on p's kernel page table, which can
+        // reach its user memory.
+        kvmswitch(p);
         swtch(&c->context, &p->context);
+        kvmswitch(0);
 
         // Process is done running for now.
         // It should have changed its p->state before coming back.
@@ -513,6 +917,9 @@ sched(void)
   if(intr_get())
     panic("sched interruptible");
 
+  // save FP/vector registers now only if they changed.
+  xregssave(p);
+
   intena = mycpu()->intena;
   swtch(&p->context, &mycpu()->context);
   mycpu()->intena = intena;
@@ -550,6 +957,18 @@ forkret(void)
   usertrapret();
 }
 
+// A kthread()'s first scheduling swtch()es here.
+static void
+kthreadret(void)
+{
+  struct proc *p = myproc();
+
+  // Still holding p->lock from scheduler.
+  release(&p->lock);
+  p->kfn(p->karg);
+  exit(0);
+}
+
 // Atomically release lock and sleep on chan.
 // Reacquires lock when awakened.
 void
@@ -588,16 +1007,51 @@ sleep(void *chan, struct spinlock *lk)
 // Must be called without any p->lock.
 void
 wakeup(void *chan)
+{
+  wakeupn(chan, NPROC);
+}
+
+// Wake up at most max processes sleeping on chan, and
+// return how many. Must be called without any p->lock.
+int
+wakeupn(void *chan, int max)
 {
   struct proc *p;
+  int n = 0;
 
-  for(p = proc; p < &proc[NPROC]; p++) {
+  for(p = proc; p < &proc[NPROC] && n < max; p++) {
     acquire(&p->lock); // 先获取进程锁才可以wakeup,确保不会lost wakeup
     if(p->state == SLEEPING && p->chan == chan) {
       p->state = RUNNABLE;
+      n++;
     }
     release(&p->lock);
   }
+  if(n > 0)
+    kickidle(n);
+  return n;
+}
+
+// Send an IPI to up to n other harts that are idle in
+// scheduler(), so that newly RUNNABLE processes start
+// now rather than at those harts' next timer interrupt.
+// Call after release()ing the processes' locks; its fence
+// orders the state change before our reads of c->idle.
+static void
+kickidle(int n)
+{
+  struct cpu *c, *me;
+
+  push_off();
+  me = mycpu();
+  for(c = cpus; c < &cpus[NCPU] && n > 0; c++){
+    // claim the hart, so two wakeups don't both kick it.
+    if(c != me && c->idle && __sync_lock_test_and_set(&c->idle, 0)){
+      ipi(c - cpus);
+      n--;
+    }
+  }
+  pop_off();
 }
 
 // Wake up p if it is sleeping in wait(); used by exit().
@@ -627,6 +1081,9 @@ kill(int pid)
       if(p->state == SLEEPING){
         // Wake process from sleep().
         p->state = RUNNABLE;
+        release(&p->lock);
+        kickidle(1);
+        return 0;
       }
       release(&p->lock);
       return 0;
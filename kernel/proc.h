@@ -24,6 +24,8 @@ struct cpu {
   struct context context;     // swtch() here to enter scheduler().
   int noff;                   // Depth of push_off() nesting.
   int intena;                 // Were interrupts enabled before push_off()?
+  int idle;                   // Looking for work in scheduler(); kick with ipi().
+  struct proc *xowner;        // Process whose FP/vector state the registers hold.
 };
 
 extern struct cpu cpus[NCPU];
@@ -82,6 +84,16 @@ struct trapframe {
 
 enum procstate { UNUSED, SLEEPING, RUNNABLE, RUNNING, ZOMBIE };
 
+// a region of user memory made by mmap() (vma.c).
+struct vma {
+  uint64 addr;                 // Start, page-aligned
+  uint64 len;                  // Bytes, a multiple of PGSIZE; 0 if slot is free
+  int prot;                    // PROT_READ &c
+  int flags;                   // MAP_SHARED or MAP_PRIVATE, maybe MAP_ANONYMOUS
+  struct file *f;              // Mapped file, or 0 for zeroed memory
+  uint64 off;                  // Offset in f of addr
+};
+
 // Per-process state
 struct proc {
   struct spinlock lock;
@@ -98,9 +110,31 @@ struct proc {
   uint64 kstack;               // Virtual address of kernel stack 内核栈区
   uint64 sz;                   // Size of process memory (bytes)
   pagetable_t pagetable;       // User page table 进程页表，以RISC-V硬件所期望的格式保存进程的页表
+  pagetable_t kpagetable;      // Kernel page table, also maps user memory at UKBASE
+  int asid;                    // ASID of kpagetable, or 0 if no ASIDs
+  int uasid;                   // ASID of pagetable
+  uint64 tlbstale;             // Harts that must flush asid/uasid before running us
   struct trapframe *trapframe; // data page for trampoline.S
+  uint64 tfva;                 // Where pagetable maps trapframe: TRAPFRAME, or THREADFRAME() for a thread
+  struct usyscall *usyscall;   // read-only page mapped at USYSCALL
+  struct xregs *xregs;         // FP/vector registers, once used (xregs.c)
+  int xcpu;                    // Hart whose registers last got xregs
   struct context context;      // swtch() here to run process
   struct file *ofile[NOFILE];  // Open files
   struct inode *cwd;           // Current directory
+  struct vma vmas[NVMA];       // mmap() regions
   char name[16];               // Process name (debugging)
+  uint64 tracemask;            // System calls to trace (1 << SYS_x)
+  int nofault;                 // copyin()/copyout() mustn't fault in mmap() pages (file.c)
+
+  // threads (clone()) share their process's pagetable, and
+  // use the leader's sz, vmas[], ofile[] and cwd above
+  // instead of their own.
+  struct proc *leader;         // The process's first thread; p itself if not a thread
+  int nthreads;                // Leader: threads that haven't exited; leader->lock
+  int vmbusy;                  // Leader: vmlock() held; leader->lock
+  int ending;                  // Leader: killthreads() running; leader->lock
+  struct uring *uring;         // Leader: uring_setup()'s queues, or 0 (uring.c)
+  void (*kfn)(void*);          // A kthread(): runs kfn(karg) in the kernel
+  void *karg;
 };
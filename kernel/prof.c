@@ -0,0 +1,159 @@
+//
+// Sampling profiler, driven by timer interrupts.
+// While enabled, each hart records the interrupted pc
+// and process in its own ring every PROFINTERVAL, and
+// reads from the PROF device drain the rings.
+//
+// write "1" to the device to clear the rings and start,
+// write "0" to stop. reads block while profiling is on
+// and there are no samples, and return 0 once it is off
+// and every sample has been read.
+//
+
+#include "types.h"
+#include "param.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "defs.h"
+#include "proc.h"
+#include "prof.h"
+
+#define NPROFSAMPLE 1024              // samples per hart
+#define PROFINTERVAL (MTIME_FREQ/1000) // mtime between samples: 1 ms
+
+struct profring {
+  struct spinlock lock;
+  struct profsample sample[NPROFSAMPLE];
+  uint r;  // Read index
+  uint w;  // Write index
+};
+
+struct {
+  struct spinlock lock; // protects on, and readers' sleep()
+  int on;
+  struct profring ring[NCPU];
+} prof;
+
+// take a sample on this hart. called from devintr()
+// on every timer interrupt, with interrupts off.
+void
+profintr(int tick)
+{
+  struct profring *r;
+  struct profsample *s;
+  struct proc *p;
+
+  if(!prof.on)
+    return;
+
+  r = &prof.ring[cpuid()];
+  acquire(&r->lock);
+  if(r->w - r->r < NPROFSAMPLE){
+    s = &r->sample[r->w++ % NPROFSAMPLE];
+    s->pc = r_sepc();
+    s->user = (r_sstatus() & SSTATUS_SPP) == 0;
+    s->cpu = cpuid();
+    p = mycpu()->proc;
+    if(p){
+      s->pid = p->pid;
+      safestrcpy(s->name, p->name, sizeof(s->name));
+    } else {
+      s->pid = 0;
+      s->name[0] = 0;
+    }
+  }
+  release(&r->lock);
+
+  // the periodic tick is too coarse to be useful on its
+  // own; ask for a one-shot interrupt for the next sample.
+  timerarm(readmtime() + PROFINTERVAL);
+
+  // wake readers now and then, rather than every sample.
+  if(tick){
+    acquire(&prof.lock);
+    wakeup(&prof);
+    release(&prof.lock);
+  }
+}
+
+// copy whole samples from the rings to dst.
+static int
+profcopy(int user_dst, uint64 dst, int n)
+{
+  struct profring *r;
+  int tot = 0;
+
+  for(r = prof.ring; r < &prof.ring[NCPU]; r++){
+    acquire(&r->lock);
+    while(r->r != r->w && n - tot >= sizeof(struct profsample)){
+      if(either_copyout(user_dst, dst + tot, &r->sample[r->r % NPROFSAMPLE],
+                        sizeof(struct profsample)) == -1){
+        release(&r->lock);
+        return tot;
+      }
+      r->r++;
+      tot += sizeof(struct profsample);
+    }
+    release(&r->lock);
+  }
+  return tot;
+}
+
+int
+profread(int user_dst, uint64 dst, int n)
+{
+  int tot;
+
+  acquire(&prof.lock);
+  while((tot = profcopy(user_dst, dst, n)) == 0 && prof.on){
+    if(myproc()->killed){
+      release(&prof.lock);
+      return -1;
+    }
+    sleep(&prof, &prof.lock);
+  }
+  release(&prof.lock);
+  return tot;
+}
+
+int
+profwrite(int user_src, uint64 src, int n)
+{
+  struct profring *r;
+  char c;
+
+  if(n < 1 || either_copyin(&c, user_src, src, 1) == -1)
+    return -1;
+
+  acquire(&prof.lock);
+  if(c == '1' && !prof.on){
+    for(r = prof.ring; r < &prof.ring[NCPU]; r++){
+      acquire(&r->lock);
+      r->r = r->w = 0;
+      release(&r->lock);
+    }
+    prof.on = 1;
+  } else if(c == '0'){
+    prof.on = 0;
+    wakeup(&prof);
+  }
+  release(&prof.lock);
+  return n;
+}
+
+void
+profinit(void)
+{
+  struct profring *r;
+
+  initlock(&prof.lock, "prof");
+  for(r = prof.ring; r < &prof.ring[NCPU]; r++)
+    initlock(&r->lock, "profring");
+
+  devsw[PROF].read = profread;
+  devsw[PROF].write = profwrite;
+}
@@ -0,0 +1,11 @@
+// One sample from the timer-driven profiler, read from
+// the PROF device. Both the kernel and user programs use
+// this header file.
+struct profsample {
+  uint64 pc;     // sepc when the timer interrupt arrived
+  int pid;       // 0 if the hart was idle in scheduler()
+  char user;     // is pc a user address?
+  char cpu;      // hart that took the sample
+  char pad[2];
+  char name[16]; // process name, to find user/<name>.sym
+};
@@ -40,6 +40,11 @@ w_mepc(uint64 x)
 
 // Supervisor Status Register, sstatus
 
+#define SSTATUS_FS (3L << 13)  // FP registers: 0 Off, 1 Initial, 2 Clean, 3 Dirty
+#define SSTATUS_FS_CLEAN (2L << 13)
+#define SSTATUS_VS (3L << 9)   // Vector registers, likewise
+#define SSTATUS_VS_CLEAN (2L << 9)
+#define SSTATUS_SUM (1L << 18) // Supervisor may access User pages
 #define SSTATUS_SPP (1L << 8)  // Previous mode, 1=Supervisor, 0=User
 #define SSTATUS_SPIE (1L << 5) // Supervisor Previous Interrupt Enable
 #define SSTATUS_UPIE (1L << 4) // User Previous Interrupt Enable没用到
@@ -184,7 +189,11 @@ w_mtvec(uint64 x)
 // use riscv's sv39 page table scheme.
 #define SATP_SV39 (8L << 60)
 
-#define MAKE_SATP(pagetable) (SATP_SV39 | (((uint64)pagetable) >> 12))
+// satp also holds an address-space ID (ASID), which tags the
+// TLB entries made through the page table, so that switching
+// between page tables with different ASIDs needs no flush.
+#define SATP_ASID(asid) ((uint64)(asid) << 44)
+#define MAKE_SATP(pagetable, asid) (SATP_SV39 | SATP_ASID(asid) | (((uint64)pagetable) >> 12))
 
 // supervisor address translation and protection;
 // holds the address of the page table.
@@ -248,6 +257,42 @@ r_mcounteren()
   return x;
 }
 
+// Machine ISA: one bit per extension letter.
+#define MISA_D (1L << ('D' - 'A'))
+#define MISA_V (1L << ('V' - 'A'))
+static inline uint64
+r_misa()
+{
+  uint64 x;
+  asm volatile("csrr %0, misa" : "=r" (x) );
+  return x;
+}
+
+// bytes in a vector register; needs sstatus.VS on.
+static inline uint64
+r_vlenb()
+{
+  uint64 x;
+  asm volatile("csrr %0, 0xc22" : "=r" (x) );
+  return x;
+}
+
+// Supervisor Counter-Enable
+#define SCOUNTEREN_CY (1L << 0)
+static inline void
+w_scounteren(uint64 x)
+{
+  asm volatile("csrw scounteren, %0" : : "r" (x));
+}
+
+static inline uint64
+r_scounteren()
+{
+  uint64 x;
+  asm volatile("csrr %0, scounteren" : "=r" (x) );
+  return x;
+}
+
 // machine-mode cycle counter
 static inline uint64
 r_time()
@@ -257,6 +302,17 @@ r_time()
   return x;
 }
 
+// this hart's clock cycle counter. usable in
+// supervisor mode once start() sets mcounteren.CY.
+#define MCOUNTEREN_CY (1L << 0)
+static inline uint64
+r_cycle()
+{
+  uint64 x;
+  asm volatile("csrr %0, cycle" : "=r" (x) );
+  return x;
+}
+
 // enable device interrupts
 static inline void
 intr_on()
@@ -319,10 +375,26 @@ sfence_vma()
   asm volatile("sfence.vma zero, zero");
 }
 
+// flush the TLB entries tagged with asid, except global ones.
+static inline void
+sfence_vma_asid(uint64 asid)
+{
+  asm volatile("sfence.vma zero, %0" : : "r" (asid));
+}
+
+// flush the TLB entries for virtual address va tagged with asid.
+static inline void
+sfence_vma_page(uint64 va, uint64 asid)
+{
+  asm volatile("sfence.vma %0, %1" : : "r" (va), "r" (asid));
+}
+
 
 #define PGSIZE 4096 // bytes per page
 #define PGSHIFT 12  // bits of offset within a page
 
+#define SUPERPGSIZE (1L << 21) // a level-1 leaf maps 2 MB
+
 #define PGROUNDUP(sz)  (((sz)+PGSIZE-1) & ~(PGSIZE-1))
 #define PGROUNDDOWN(a) (((a)) & ~(PGSIZE-1))
 
@@ -331,6 +403,9 @@ sfence_vma()
 #define PTE_W (1L << 2)
 #define PTE_X (1L << 3)
 #define PTE_U (1L << 4) // 1 -> user can access
+#define PTE_G (1L << 5) // global: the same in every address space
+#define PTE_A (1L << 6) // accessed
+#define PTE_D (1L << 7) // dirty: written since mapped
 
 // shift a physical address to the right place for a PTE.
 #define PA2PTE(pa) ((((uint64)pa) >> 12) << 10)
@@ -339,6 +414,9 @@ sfence_vma()
 
 #define PTE_FLAGS(pte) ((pte) & 0x3FF)
 
+// a leaf maps memory; otherwise the PTE points to the next level.
+#define PTE_LEAF(pte) ((pte) & (PTE_R|PTE_W|PTE_X))
+
 // extract the three 9-bit page table indices from a virtual address.
 #define PXMASK          0x1FF // 9 bits
 #define PXSHIFT(level)  (PGSHIFT+(9*(level)))
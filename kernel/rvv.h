@@ -0,0 +1,56 @@
+//
+// Encodings of the RISC-V vector (RVV 1.0) instructions that
+// rvv.S and user/rvv.S use, as .word directives, so that they
+// assemble with toolchains that don't know the V extension.
+// Registers are numbers: x10 is a0, v8 is 8.
+//
+
+// vtype for 8-bit elements, groups of 8 registers (LMUL=8),
+// tail and mask agnostic.
+#define VTYPE_E8M8 0xc3
+
+// vsetvli rd, rs1, vtypei
+#define VSETVLI(rd, rs1, vtypei) \
+  .word (((vtypei) << 20) | ((rs1) << 15) | (7 << 12) | ((rd) << 7) | 0x57)
+// vsetvl rd, rs1, rs2
+#define VSETVL(rd, rs1, rs2) \
+  .word (0x80000000 | ((rs2) << 20) | ((rs1) << 15) | (7 << 12) | ((rd) << 7) | 0x57)
+
+// vle8.v vd, (rs1); vle8ff.v vd, (rs1); vse8.v vs3, (rs1)
+#define VLE8(vd, rs1)   .word ((1 << 25) | ((rs1) << 15) | ((vd) << 7) | 0x07)
+#define VLE8FF(vd, rs1) .word ((1 << 25) | (0x10 << 20) | ((rs1) << 15) | ((vd) << 7) | 0x07)
+#define VSE8(vs3, rs1)  .word ((1 << 25) | ((rs1) << 15) | ((vs3) << 7) | 0x27)
+
+// vl8re8.v vd, (rs1); vs8r.v vs3, (rs1): eight whole registers.
+#define VL8RE8(vd, rs1) \
+  .word ((7 << 29) | (1 << 25) | (8 << 20) | ((rs1) << 15) | ((vd) << 7) | 0x07)
+#define VS8R(vs3, rs1) \
+  .word ((7 << 29) | (1 << 25) | (8 << 20) | ((rs1) << 15) | ((vs3) << 7) | 0x27)
+
+// vmv.v.x vd, rs1
+#define VMV_V_X(vd, rs1) \
+  .word ((0x17 << 26) | (1 << 25) | ((rs1) << 15) | (4 << 12) | ((vd) << 7) | 0x57)
+// vmsne.vv vd, vs2, vs1
+#define VMSNE_VV(vd, vs2, vs1) \
+  .word ((0x19 << 26) | (1 << 25) | ((vs2) << 20) | ((vs1) << 15) | ((vd) << 7) | 0x57)
+// vmseq.vi vd, vs2, imm
+#define VMSEQ_VI(vd, vs2, imm) \
+  .word ((0x18 << 26) | (1 << 25) | ((vs2) << 20) | (((imm) & 0x1f) << 15) | (3 << 12) | ((vd) << 7) | 0x57)
+// vfirst.m rd, vs2
+#define VFIRST_M(rd, vs2) \
+  .word ((0x10 << 26) | (1 << 25) | ((vs2) << 20) | (0x11 << 15) | (2 << 12) | ((rd) << 7) | 0x57)
+
+// CSR numbers.
+#define CSR_VSTART 0x008
+#define CSR_VCSR   0x00f
+#define CSR_VL     0xc20
+#define CSR_VTYPE  0xc21
+#define CSR_VLENB  0xc22
+
+#define A0 10
+#define A1 11
+#define A2 12
+#define A3 13
+#define T0 5
+#define T1 6
+#define T2 7
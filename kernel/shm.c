@@ -0,0 +1,118 @@
+//
+// Shared memory objects: memfd(size) makes one, as a file,
+// and every mmap(MAP_SHARED) of that file, in any process,
+// maps the same pages. mmap(MAP_SHARED|MAP_ANONYMOUS) makes
+// one for the region alone, which fork() then shares.
+//
+// Pages are allocated when first faulted in. Each page table
+// that maps a page holds a reference to it (kref()), which
+// uvmunmap() drops with kfree(); the object holds one more,
+// so the pages last until the last mapping is gone and the
+// last file referring to the object is closed.
+//
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "shm.h"
+#include "defs.h"
+
+struct {
+  struct spinlock lock;
+  struct shm shm[NSHM];
+} shmtab;
+
+void
+shminit(void)
+{
+  initlock(&shmtab.lock, "shm");
+}
+
+// A shared memory object of size bytes, or 0.
+struct shm*
+shmalloc(uint64 size)
+{
+  struct shm *s;
+  char **pages;
+
+  if(size == 0 || size > SHMMAX)
+    return 0;
+  if((pages = kalloc()) == 0)
+    return 0;
+  memset(pages, 0, PGSIZE);
+
+  acquire(&shmtab.lock);
+  for(s = shmtab.shm; s < shmtab.shm + NSHM; s++){
+    if(s->ref == 0){
+      s->ref = 1;
+      s->npages = PGROUNDUP(size) / PGSIZE;
+      s->pages = pages;
+      release(&shmtab.lock);
+      return s;
+    }
+  }
+  release(&shmtab.lock);
+  kfree(pages);
+  return 0;
+}
+
+// Drop a reference to s, and its pages with the last one;
+// the ones still mapped stay until they are unmapped.
+void
+shmput(struct shm *s)
+{
+  char **pages;
+  uint i, n;
+
+  acquire(&shmtab.lock);
+  if(s->ref < 1)
+    panic("shmput");
+  if(--s->ref > 0){
+    release(&shmtab.lock);
+    return;
+  }
+  pages = s->pages;
+  n = s->npages;
+  s->pages = 0;
+  s->npages = 0;
+  release(&shmtab.lock);
+
+  for(i = 0; i < n; i++)
+    if(pages[i])
+      kfree(pages[i]);
+  kfree(pages);
+}
+
+// Page pgno of s, zeroed the first time, with a reference
+// for the caller to map it with. Returns 0 if pgno is past
+// the end, or out of memory.
+char*
+shmpage(struct shm *s, uint pgno)
+{
+  char *mem, *spare = 0;
+
+  if(pgno >= s->npages)
+    return 0;
+  acquire(&shmtab.lock);
+  while((mem = s->pages[pgno]) == 0){
+    if(spare){
+      s->pages[pgno] = spare;
+      spare = 0;
+      continue;
+    }
+    // kalloc() may reclaim page cache pages, so not with
+    // shmtab.lock held; someone else may beat us to it.
+    release(&shmtab.lock);
+    if((spare = kalloc()) == 0)
+      return 0;
+    memset(spare, 0, PGSIZE);
+    acquire(&shmtab.lock);
+  }
+  kref(mem);
+  release(&shmtab.lock);
+  if(spare)
+    kfree(spare);
+  return mem;
+}
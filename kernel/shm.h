@@ -0,0 +1,8 @@
+// a shared memory object (shm.c).
+struct shm {
+  int ref;        // files referring to it; protected by shmtab.lock
+  uint npages;
+  char **pages;   // a page of pointers to its pages, 0 if not yet used
+};
+
+#define SHMMAX (PGSIZE / sizeof(char*) * PGSIZE)  // 2 MB
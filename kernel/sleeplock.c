@@ -8,6 +8,7 @@
 #include "spinlock.h"
 #include "proc.h"
 #include "sleeplock.h"
+#include "lockstat.h"
 
 void
 initsleeplock(struct sleeplock *lk, char *name)
@@ -16,17 +17,28 @@ initsleeplock(struct sleeplock *lk, char *name)
   lk->name = name;
   lk->locked = 0;
   lk->pid = 0;
+  lk->stat = lockstatfor(name, 1);
 }
 
 void
 acquiresleep(struct sleeplock *lk)
 {
+  // mtime rather than the cycle counter, since
+  // sleep() may move us to another hart.
+  uint64 nsleep = 0, t0 = readmtime();
+
   acquire(&lk->lk);
   while (lk->locked) {
+    nsleep++;
     sleep(lk, &lk->lk);
   }
   lk->locked = 1;
   lk->pid = myproc()->pid;
+  if(lk->stat){
+    lk->tacquire = readmtime();
+    lockstatacquire(lk->stat, nsleep, lk->tacquire - t0,
+                    (uint64)__builtin_return_address(0));
+  }
   release(&lk->lk);
 }
 
@@ -34,6 +46,8 @@ void
 releasesleep(struct sleeplock *lk)
 {
   acquire(&lk->lk);
+  if(lk->stat)
+    lockstatrelease(lk->stat, readmtime() - lk->tacquire);
   lk->locked = 0;
   lk->pid = 0;
   wakeup(lk);
@@ -6,5 +6,9 @@ struct sleeplock {
   // For debugging:
   char *name;        // Name of lock.
   int pid;           // Process holding lock
+
+  // For statistics:
+  struct lockstat *stat; // Shared with sleep locks of the same name
+  uint64 tacquire;       // CLINT_MTIME when acquired
 };
 
@@ -0,0 +1,456 @@
+//
+// Unix domain stream sockets: named, two-way pipes between
+// processes on this machine.
+//
+// bind() gives a socket a name, a T_SOCK inode that it holds
+// on to, and listen() lets other sockets connect() to it by
+// that name. connect() makes a connection at once and puts
+// the other end on the listening socket's backlog, for
+// accept() to hand out; the connecting side can write before
+// it is accepted.
+//
+// A connection is a page for each direction, as pipe.c would
+// be with bigger buffers. A read returns 0 once the other end
+// is closed and what it wrote has been read; a write then
+// fails. Data is copied to and from user memory without the
+// connection's spinlock, which only guards the counters: the
+// part of a buffer being copied belongs to the one reader or
+// writer of that direction, which a sleep-lock picks.
+//
+// A socket has one waitq for poll()s for its whole life, so
+// that an epoll set that added it before it was connected or
+// accepted is woken for its data as well.
+//
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "sleeplock.h"
+#include "stat.h"
+#include "fs.h"
+#include "file.h"
+#include "poll.h"
+#include "defs.h"
+
+#define SOCKBUF     PGSIZE  // bytes buffered each way
+#define SOCKBACKLOG 8       // listen() backlog, at most
+
+struct sconn {
+  struct spinlock lock;
+  char *buf[2];           // buf[i] holds data for end i
+  uint nread[2];          // bytes end i has read
+  uint nwrite[2];         // bytes written to end i
+  int open[2];            // end i is still open
+  struct waitq *wq[2];    // end i's socket's, while open
+  struct sleeplock rlk[2];  // one reader of buf[i] at a time
+  struct sleeplock wlk[2];  // one writer to buf[i] at a time
+};
+
+struct sock {
+  int used;
+  struct inode *ip;      // bind()'s name, or 0
+  int listening;
+  int maxbacklog;
+  int nbacklog;
+  struct sock *backlog[SOCKBACKLOG];  // connected, not yet accepted
+  struct waitq wq;       // poll()s, listening or connected
+  struct sconn *conn;    // 0 until connected
+  int end;               // which end of conn it is
+};
+
+// sockets, and all but the connections' buffers.
+struct {
+  struct spinlock lock;
+  struct sock sock[NSOCK];
+} socktab;
+
+void
+sockinit(void)
+{
+  initlock(&socktab.lock, "sock");
+}
+
+// a free socket, or 0. socktab.lock held.
+static struct sock*
+sockget(void)
+{
+  struct sock *s;
+
+  for(s = socktab.sock; s < socktab.sock + NSOCK; s++){
+    if(!s->used){
+      memset(s, 0, sizeof(*s));
+      s->used = 1;
+      return s;
+    }
+  }
+  return 0;
+}
+
+// a new connection, or 0.
+static struct sconn*
+sconnalloc(void)
+{
+  struct sconn *c;
+
+  if((c = kalloc()) == 0)
+    return 0;
+  memset(c, 0, sizeof(*c));
+  if((c->buf[0] = kalloc()) == 0 || (c->buf[1] = kalloc()) == 0){
+    if(c->buf[0])
+      kfree(c->buf[0]);
+    kfree(c);
+    return 0;
+  }
+  initlock(&c->lock, "sconn");
+  initsleeplock(&c->rlk[0], "sconnread");
+  initsleeplock(&c->rlk[1], "sconnread");
+  initsleeplock(&c->wlk[0], "sconnwrite");
+  initsleeplock(&c->wlk[1], "sconnwrite");
+  c->open[0] = c->open[1] = 1;
+  return c;
+}
+
+// c may have become ready for either end. c->lock held.
+static void
+sconnwake(struct sconn *c)
+{
+  if(c->wq[0])
+    pollwakeup(c->wq[0]);
+  if(c->wq[1])
+    pollwakeup(c->wq[1]);
+}
+
+// close end e of c, and free c with the second end.
+static void
+sconnclose(struct sconn *c, int e)
+{
+  acquire(&c->lock);
+  c->open[e] = 0;
+  c->wq[e] = 0;
+  wakeup(&c->nread[1-e]);
+  wakeup(&c->nwrite[1-e]);
+  sconnwake(c);
+  if(c->open[1-e]){
+    release(&c->lock);
+    return;
+  }
+  release(&c->lock);
+  kfree(c->buf[0]);
+  kfree(c->buf[1]);
+  kfree(c);
+}
+
+// a new socket, as a file.
+struct file*
+sockalloc(void)
+{
+  struct file *f;
+  struct sock *s;
+
+  if((f = filealloc()) == 0)
+    return 0;
+  acquire(&socktab.lock);
+  s = sockget();
+  release(&socktab.lock);
+  if(s == 0){
+    fileclose(f);
+    return 0;
+  }
+  f->type = FD_SOCK;
+  f->readable = 1;
+  f->writable = 1;
+  f->sock = s;
+  return f;
+}
+
+// s's file is closed.
+void
+sockclose(struct sock *s)
+{
+  struct sock *ns;
+  struct inode *ip;
+
+  acquire(&socktab.lock);
+  // connections no one accepted.
+  while(s->nbacklog > 0){
+    ns = s->backlog[--s->nbacklog];
+    sconnclose(ns->conn, ns->end);
+    ns->used = 0;
+  }
+  s->listening = 0;
+  wakeup(s);
+  ip = s->ip;
+  s->ip = 0;
+  if(s->conn)
+    sconnclose(s->conn, s->end);
+  s->conn = 0;
+  s->used = 0;
+  release(&socktab.lock);
+
+  if(ip){
+    begin_op();
+    iput(ip);
+    end_op();
+  }
+}
+
+// name s path, a new T_SOCK inode.
+int
+sockbind(struct sock *s, char *path)
+{
+  struct inode *ip;
+
+  if(s->ip || s->conn)
+    return -1;
+  begin_op();
+  if((ip = create(path, T_SOCK, 0, 0)) == 0){
+    end_op();
+    return -1;
+  }
+  iunlock(ip);
+  end_op();
+
+  acquire(&socktab.lock);
+  if(s->ip || s->conn){
+    // another thread got there first.
+    release(&socktab.lock);
+    begin_op();
+    iput(ip);
+    end_op();
+    return -1;
+  }
+  s->ip = ip;
+  release(&socktab.lock);
+  return 0;
+}
+
+// let up to backlog connections to s wait for accept().
+int
+socklisten(struct sock *s, int backlog)
+{
+  int r = -1;
+
+  acquire(&socktab.lock);
+  if(s->ip && s->conn == 0){
+    if(backlog < 1)
+      backlog = 1;
+    if(backlog > SOCKBACKLOG)
+      backlog = SOCKBACKLOG;
+    s->listening = 1;
+    s->maxbacklog = backlog;
+    r = 0;
+  }
+  release(&socktab.lock);
+  return r;
+}
+
+// connect s to the listening socket named path.
+int
+sockconnect(struct sock *s, char *path)
+{
+  struct inode *ip;
+  struct sock *l, *ns;
+  struct sconn *c;
+  int r = -1;
+
+  if((c = sconnalloc()) == 0)
+    return -1;
+  begin_op();
+  if((ip = namei(path)) == 0){
+    end_op();
+    goto bad;
+  }
+
+  acquire(&socktab.lock);
+  // a listening socket holds its inode, so it is ip.
+  for(l = socktab.sock; l < socktab.sock + NSOCK; l++)
+    if(l->used && l->listening && l->ip == ip)
+      break;
+  if(l < socktab.sock + NSOCK && s->conn == 0 && !s->listening &&
+     l->nbacklog < l->maxbacklog && (ns = sockget()) != 0){
+    s->conn = ns->conn = c;
+    s->end = 0;
+    ns->end = 1;
+    c->wq[0] = &s->wq;
+    c->wq[1] = &ns->wq;
+    l->backlog[l->nbacklog++] = ns;
+    wakeup(l);
+    pollwakeup(&l->wq);
+    // s can be written to now.
+    pollwakeup(&s->wq);
+    r = 0;
+  }
+  release(&socktab.lock);
+
+  iput(ip);
+  end_op();
+  if(r == 0)
+    return 0;
+ bad:
+  kfree(c->buf[0]);
+  kfree(c->buf[1]);
+  kfree(c);
+  return -1;
+}
+
+// wait for a connection to the listening socket s, and return
+// the new socket, as a file, or 0.
+struct file*
+sockaccept(struct sock *s, int nonblock)
+{
+  struct proc *p = myproc();
+  struct file *f;
+  struct sock *ns;
+
+  if((f = filealloc()) == 0)
+    return 0;
+  acquire(&socktab.lock);
+  while(s->listening && s->nbacklog == 0 && !nonblock && !p->killed)
+    sleep(s, &socktab.lock);
+  if(!s->listening || s->nbacklog == 0 || p->killed){
+    release(&socktab.lock);
+    fileclose(f);
+    return 0;
+  }
+  // oldest first.
+  ns = s->backlog[0];
+  memmove(s->backlog, s->backlog + 1, --s->nbacklog * sizeof(s->backlog[0]));
+  release(&socktab.lock);
+
+  f->type = FD_SOCK;
+  f->readable = 1;
+  f->writable = 1;
+  f->sock = ns;
+  return f;
+}
+
+// with nonblock, return -1 rather than wait for the other end.
+int
+sockread(struct sock *s, uint64 addr, int n, int nonblock)
+{
+  struct proc *pr = myproc();
+  struct sconn *c = s->conn;
+  int e = s->end, i, m, r;
+  uint off;
+
+  if(c == 0)
+    return -1;
+  acquiresleep(&c->rlk[e]);
+  acquire(&c->lock);
+  while(c->nread[e] == c->nwrite[e] && c->open[1-e]){
+    if(pr->killed || nonblock){
+      release(&c->lock);
+      releasesleep(&c->rlk[e]);
+      return -1;
+    }
+    sleep(&c->nread[e], &c->lock);
+  }
+  // a piece at a time, up to the end of the buffer. the
+  // writer doesn't touch what we haven't counted as read.
+  for(i = 0; i < n && c->nread[e] != c->nwrite[e]; i += m){
+    off = c->nread[e] % SOCKBUF;
+    m = c->nwrite[e] - c->nread[e];
+    if(m > SOCKBUF - off)
+      m = SOCKBUF - off;
+    if(m > n - i)
+      m = n - i;
+    release(&c->lock);
+    r = copyout(pr->pagetable, addr + i, c->buf[e] + off, m);
+    acquire(&c->lock);
+    if(r == -1)
+      break;
+    c->nread[e] += m;
+  }
+  wakeup(&c->nwrite[e]);
+  sconnwake(c);
+  release(&c->lock);
+  releasesleep(&c->rlk[e]);
+  return i;
+}
+
+// with nonblock, write what fits, and return -1 if nothing
+// does.
+int
+sockwrite(struct sock *s, uint64 addr, int n, int nonblock)
+{
+  struct proc *pr = myproc();
+  struct sconn *c = s->conn;
+  int o = 1 - s->end, i, m, r;
+  uint off;
+
+  if(c == 0)
+    return -1;
+  acquiresleep(&c->wlk[o]);
+  acquire(&c->lock);
+  for(i = 0; i < n; i += m){
+    if(c->open[o] == 0 || pr->killed){
+      i = -1;
+      break;
+    }
+    if(c->nwrite[o] == c->nread[o] + SOCKBUF){
+      wakeup(&c->nread[o]);
+      sconnwake(c);
+      if(nonblock){
+        if(i == 0)
+          i = -1;
+        break;
+      }
+      sleep(&c->nwrite[o], &c->lock);
+      m = 0;
+      continue;
+    }
+    // the reader doesn't look past what we count as written.
+    off = c->nwrite[o] % SOCKBUF;
+    m = c->nread[o] + SOCKBUF - c->nwrite[o];
+    if(m > SOCKBUF - off)
+      m = SOCKBUF - off;
+    if(m > n - i)
+      m = n - i;
+    release(&c->lock);
+    r = copyin(pr->pagetable, c->buf[o] + off, addr + i, m);
+    acquire(&c->lock);
+    if(r == -1)
+      break;
+    c->nwrite[o] += m;
+    wakeup(&c->nread[o]);
+    sconnwake(c);
+  }
+  release(&c->lock);
+  releasesleep(&c->wlk[o]);
+  return i;
+}
+
+// which of events are ready on s, and have pt, if any, wait
+// for s.
+int
+sockpoll(struct sock *s, int events, struct poller *pt)
+{
+  struct sconn *c;
+  int r = 0, e;
+
+  acquire(&socktab.lock);
+  if(s->listening || (c = s->conn) == 0){
+    if(s->nbacklog > 0)
+      r |= POLLIN;
+    pollwait(&s->wq, pt);
+    release(&socktab.lock);
+    return r & events;
+  }
+  release(&socktab.lock);
+
+  // a connected socket stays connected.
+  e = s->end;
+  acquire(&c->lock);
+  if(c->nread[e] != c->nwrite[e])
+    r |= POLLIN;
+  if(c->open[1-e] == 0)
+    r |= POLLHUP;
+  else if(c->nwrite[1-e] != c->nread[1-e] + SOCKBUF)
+    r |= POLLOUT;
+  pollwait(&s->wq, pt);
+  release(&c->lock);
+  return r & (events | POLLERR | POLLHUP);
+}
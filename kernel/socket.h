@@ -0,0 +1,5 @@
+// socket() domains and types (sock.c).
+// Both the kernel and user programs use this header file.
+
+#define AF_UNIX     1   // named by a T_SOCK inode
+#define SOCK_STREAM 1   // a connected byte stream each way
@@ -7,6 +7,106 @@
 #include "riscv.h"
 #include "proc.h"
 #include "defs.h"
+#include "lockstat.h"
+
+// Statistics for each distinct lock name.
+// Its own lock has no statistics (stat == 0).
+struct {
+  struct spinlock lock;
+  struct lockstat stat[NLOCKSTAT];
+  uint sitebusy[NLOCKSTAT]; // Someone is updating stat[i].site*
+  int n;
+} lockstats = { .lock = { .name = "lockstats" } };
+
+// The counters of lockstats.stat[i], kept for each hart in
+// lockcounts[hart][i], so that harts taking locks of the same
+// name don't fight over one cache line. Only that hart writes
+// them, with interrupts off; lockstatcopy() adds them up.
+struct lockcount {
+  uint64 nacquire;
+  uint64 ncontended;
+  uint64 nspin;
+  uint64 waitcycles;
+  uint64 holdcycles;
+};
+static struct lockcount lockcounts[NCPU][NLOCKSTAT];
+
+// Find or make the statistics entry for spinlocks
+// (sleep == 0) or sleep locks (sleep == 1) called name.
+// Returns 0 if the table is full.
+struct lockstat*
+lockstatfor(char *name, int sleep)
+{
+  struct lockstat *st;
+
+  acquire(&lockstats.lock);
+  for(st = lockstats.stat; st < lockstats.stat + lockstats.n; st++){
+    if(st->sleep == sleep && strncmp(st->name, name, LOCKNAME-1) == 0)
+      goto found;
+  }
+  if(lockstats.n == NLOCKSTAT){
+    release(&lockstats.lock);
+    return 0;
+  }
+  st = &lockstats.stat[lockstats.n++];
+  safestrcpy(st->name, name, LOCKNAME);
+  st->sleep = sleep;
+found:
+  st->nlocks++;
+  release(&lockstats.lock);
+  return st;
+}
+
+// Count the call site pc of a contended acquisition, keeping
+// the LOCKSITES busiest. When a new site evicts the least busy
+// one it inherits that count, so counts are upper bounds.
+static void
+lockstatsite(struct lockstat *st, uint64 pc)
+{
+  uint *busy = &lockstats.sitebusy[st - lockstats.stat];
+  int i, min = 0;
+
+  // Locks of the same name may be contended on several CPUs
+  // at once. Rather than wait, drop the sample.
+  if(__sync_lock_test_and_set(busy, 1) != 0)
+    return;
+  for(i = 0; i < LOCKSITES; i++){
+    if(st->sitepc[i] == pc){
+      min = i;
+      break;
+    }
+    if(st->sitecount[i] < st->sitecount[min])
+      min = i;
+  }
+  st->sitepc[min] = pc;
+  st->sitecount[min]++;
+  __sync_lock_release(busy);
+}
+
+// Record an acquisition of a lock with statistics st,
+// called from pc, after spinning (or sleeping) spins
+// times and waiting for wait cycles. Interrupts are off.
+void
+lockstatacquire(struct lockstat *st, uint64 spins, uint64 wait, uint64 pc)
+{
+  struct lockcount *c = &lockcounts[cpuid()][st - lockstats.stat];
+
+  c->nacquire++;
+  if(spins == 0)
+    return;
+  c->ncontended++;
+  c->nspin += spins;
+  c->waitcycles += wait;
+  lockstatsite(st, pc);
+}
+
+// Record that a lock with statistics st was held for
+// hold cycles. Interrupts are off.
+void
+lockstatrelease(struct lockstat *st, uint64 hold)
+{
+  lockcounts[cpuid()][st - lockstats.stat].holdcycles += hold;
+}
 
 void
 initlock(struct spinlock *lk, char *name)
@@ -14,6 +114,24 @@ initlock(struct spinlock *lk, char *name)
   lk->name = name;
   lk->locked = 0;
   lk->cpu = 0;
+  lk->ticket = 0;
+  lk->next = 0;
+  lk->serving = 0;
+  lk->stat = lockstatfor(name, 0);
+}
+
+// Like initlock(), but makes a ticket lock, which
+// hands the lock out in the order that CPUs asked for it.
+// Waiting CPUs only read lk->serving, rather than all
+// hammering lk->locked with atomic swaps, so this is
+// the better choice for heavily contended locks.
+void
+initticketlock(struct spinlock *lk, char *name)
+{
+  initlock(lk, name);
+  lk->ticket = 1;
+  if(lk->stat)
+    lk->stat->ticket = 1;
 }
 
 // Acquire the lock.
@@ -24,16 +142,30 @@ acquire(struct spinlock *lk)
   // 关闭中断避免死锁,比如这样一段代码，开始先获取了锁，然后通过键盘输入产生了中断，然后键盘要从uart的缓冲区读取数据也要获取锁
   // 这样的结果就是，中断代码在等待锁，而获取了锁的代码在等待键盘中断结束，从而产生了死锁
   // 还可以使获取了锁的代码尽快运行完，因为不会有中断和时间中断
+  uint64 spins = 0, t0;
+
   push_off(); // disable interrupts to avoid deadlock. 
   if(holding(lk))
     panic("acquire");
 
-  // On RISC-V, sync_lock_test_and_set turns into an atomic swap:
-  //   a5 = 1
-  //   s1 = &lk->locked
-  //   amoswap.w.aq a5, a5, (s1)
-  while(__sync_lock_test_and_set(&lk->locked, 1) != 0)
-    ;
+  t0 = r_cycle();
+
+  if(lk->ticket){
+    // Take a ticket, then wait for it to be served.
+    // On RISC-V, sync_fetch_and_add turns into an atomic add:
+    //   amoadd.w a5, a5, (s1)
+    uint t = __sync_fetch_and_add(&lk->next, 1);
+    while(*(volatile uint *)&lk->serving != t)
+      spins++;
+    lk->locked = 1;
+  } else {
+    // On RISC-V, sync_lock_test_and_set turns into an atomic swap:
+    //   a5 = 1
+    //   s1 = &lk->locked
+    //   amoswap.w.aq a5, a5, (s1)
+    while(__sync_lock_test_and_set(&lk->locked, 1) != 0)
+      spins++;
+  }
 
   // Tell the C compiler and the processor to not move loads or stores
   // past this point, to ensure that the critical section's memory
@@ -43,6 +175,12 @@ acquire(struct spinlock *lk)
 
   // Record info about lock acquisition for holding() and debugging.
   lk->cpu = mycpu();
+
+  if(lk->stat){
+    lk->tacquire = r_cycle();
+    lockstatacquire(lk->stat, spins, lk->tacquire - t0,
+                    (uint64)__builtin_return_address(0));
+  }
 }
 
 // Release the lock.
@@ -52,7 +190,12 @@ release(struct spinlock *lk)
   if(!holding(lk))
     panic("release");
 
+  if(lk->stat)
+    lockstatrelease(lk->stat, r_cycle() - lk->tacquire);
+
   lk->cpu = 0;
+  if(lk->ticket)
+    lk->locked = 0;
 
   // Tell the C compiler and the CPU to not move loads or stores
   // past this point, to ensure that all the stores in the critical
@@ -69,11 +212,64 @@ release(struct spinlock *lk)
   // On RISC-V, sync_lock_release turns into an atomic swap:
   //   s1 = &lk->locked
   //   amoswap.w zero, zero, (s1)
-  __sync_lock_release(&lk->locked); // 设置lk->locked = 0
+  // A ticket lock is released by serving the next ticket.
+  if(lk->ticket)
+    __sync_fetch_and_add(&lk->serving, 1);
+  else
+    __sync_lock_release(&lk->locked); // 设置lk->locked = 0
 
   pop_off(); // 启用中断
 }
 
+// Copy up to n lock statistics entries to user address addr.
+// Returns the number copied, or -1.
+int
+lockstatcopy(uint64 addr, int n)
+{
+  struct proc *p = myproc();
+  struct lockstat st;
+  struct lockcount *c;
+  int i, h;
+
+  for(i = 0; i < n; i++){
+    acquire(&lockstats.lock);
+    if(i >= lockstats.n){
+      release(&lockstats.lock);
+      break;
+    }
+    st = lockstats.stat[i];
+    for(h = 0; h < NCPU; h++){
+      c = &lockcounts[h][i];
+      st.nacquire += c->nacquire;
+      st.ncontended += c->ncontended;
+      st.nspin += c->nspin;
+      st.waitcycles += c->waitcycles;
+      st.holdcycles += c->holdcycles;
+    }
+    release(&lockstats.lock);
+    // not holding the lock: copyout() may fault pages in.
+    if(copyout(p->pagetable, addr + i*sizeof(st), (char *)&st, sizeof(st)) < 0)
+      return -1;
+  }
+  return i;
+}
+
+// Zero the lock statistics, keeping the names.
+void
+lockstatreset(void)
+{
+  struct lockstat *st;
+
+  acquire(&lockstats.lock);
+  // racing with other harts' updates; close enough.
+  memset(lockcounts, 0, sizeof(lockcounts));
+  for(st = lockstats.stat; st < lockstats.stat + lockstats.n; st++){
+    memset(st->sitepc, 0, sizeof(st->sitepc));
+    memset(st->sitecount, 0, sizeof(st->sitecount));
+  }
+  release(&lockstats.lock);
+}
+
 // Check whether this cpu is holding the lock.
 // Interrupts must be off. 检查该CPU是否获取过该锁，此时中断必须是关闭的
 int
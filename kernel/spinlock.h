@@ -2,8 +2,17 @@
 struct spinlock {
   uint locked;       // Is the lock held?
 
+  // For ticket locks (see initticketlock()):
+  int ticket;        // Is this a ticket lock?
+  uint next;         // Next ticket to hand out
+  uint serving;      // Ticket that may hold the lock
+
   // For debugging:
   char *name;        // Name of lock.
   struct cpu *cpu;   // The cpu holding the lock.
+
+  // For statistics:
+  struct lockstat *stat; // Shared with locks of the same name
+  uint64 tacquire;       // Cycle counter when acquired
 };
 
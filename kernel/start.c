@@ -38,6 +38,14 @@ start()
   w_mideleg(0xffff);
   w_sie(r_sie() | SIE_SEIE | SIE_STIE | SIE_SSIE);
 
+  // let supervisor mode read the cycle counter, for lock statistics.
+  w_mcounteren(r_mcounteren() | MCOUNTEREN_CY);
+  // and user mode, for benchmarks such as membench.
+  w_scounteren(r_scounteren() | SCOUNTEREN_CY);
+
+  // supervisor mode can't read misa; xregsinit() wants it.
+  misa = r_misa();
+
   // ask for clock interrupts. 对时钟芯片进行编程以产生计时器中断
   timerinit();
 
@@ -61,15 +69,26 @@ timerinit()
 
   // ask the CLINT for a timer interrupt.
   int interval = 1000000; // cycles; about 1/10th second in qemu.
-  *(uint64*)CLINT_MTIMECMP(id) = *(uint64*)CLINT_MTIME + interval;
+  uint64 next = *(uint64*)CLINT_MTIME + interval;
+  *(uint64*)CLINT_MTIMECMP(id) = next;
 
   // prepare information in scratch[] for timervec.
-  // scratch[0..3] : space for timervec to save registers.
-  // scratch[4] : address of CLINT MTIMECMP register.
-  // scratch[5] : desired interval (in cycles) between timer interrupts.
+  // scratch[0..4] : space for timervec to save registers.
+  // scratch[5] : address of CLINT MTIMECMP register.
+  // scratch[6] : desired interval (in cycles) between timer interrupts.
+  // scratch[7] : mtime of the next periodic timer interrupt.
+  // scratch[8] : mtime of a one-shot timer interrupt, 0 if none.
+  // scratch[9] : TIMER_TICK/TIMER_ONESHOT bits, for devintr().
+  // scratch[10] : address of CLINT MTIME register.
+  // scratch[11] : address of CLINT MSIP register, for IPIs.
   uint64 *scratch = &mscratch0[32 * id];
-  scratch[4] = CLINT_MTIMECMP(id);
-  scratch[5] = interval;
+  scratch[5] = CLINT_MTIMECMP(id);
+  scratch[6] = interval;
+  scratch[7] = next;
+  scratch[8] = 0;
+  scratch[9] = 0;
+  scratch[10] = CLINT_MTIME;
+  scratch[11] = CLINT_MSIP(id);
   w_mscratch((uint64)scratch);
 
   // set the machine-mode trap handler.
@@ -78,6 +97,40 @@ timerinit()
   // enable machine-mode interrupts.
   w_mstatus(r_mstatus() | MSTATUS_MIE);
 
-  // enable machine-mode timer interrupts.
-  w_mie(r_mie() | MIE_MTIE);
+  // enable machine-mode timer interrupts, and software
+  // interrupts for IPIs. timervec handles both.
+  w_mie(r_mie() | MIE_MTIE | MIE_MSIE);
+}
+
+// ask timervec for a one-shot timer interrupt on this hart
+// once mtime reaches when, unless an earlier one is already
+// pending. called in supervisor mode with interrupts off.
+// timervec may run between any two of these instructions;
+// the worst outcome is a spurious machine-mode interrupt,
+// after which timervec reprograms MTIMECMP from scratch[].
+void
+timerarm(uint64 when)
+{
+  int id = cpuid();
+  volatile uint64 *scratch = &mscratch0[32 * id];
+  volatile uint64 *mtimecmp = (uint64*)CLINT_MTIMECMP(id);
+
+  if(scratch[8] != 0 && scratch[8] <= when)
+    return;
+  scratch[8] = when;
+  if(when < *mtimecmp)
+    *mtimecmp = when;
+}
+
+// return and clear the TIMER_* bits that timervec has
+// recorded for this hart since the last call.
+// called in supervisor mode with interrupts off.
+int
+timerpending(void)
+{
+  uint64 *scratch = &mscratch0[32 * cpuid()];
+
+  // an atomic swap, so that a timervec running just
+  // before or after can't have its bits lost.
+  return __sync_lock_test_and_set(&scratch[9], 0);
 }
@@ -1,6 +1,7 @@
 #define T_DIR     1   // Directory
 #define T_FILE    2   // File
 #define T_DEVICE  3   // Device
+#define T_SOCK    4   // Unix domain socket name
 
 struct stat {
   int dev;     // File system's disk device
@@ -1,13 +1,56 @@
 #include "types.h"
+#include "param.h"
+#include "riscv.h"
+#include "defs.h"
 // 字符串和字节数组库
+
+// RISC-V traps (or is very slow) on misaligned loads and
+// stores, so these move 8 bytes at a time only once dst
+// (and src) are 8-byte aligned, and fall back to bytes when
+// src and dst can't both be aligned. Page-sized work such as
+// kalloc()/kfree() junk fills, uvmcopy() and bread()/bwrite()
+// is always aligned.
+
+#define WORD     sizeof(uint64)
+#define ALIGNED(p) (((uint64)(p) & (WORD-1)) == 0)
+
+// with the vector extension (xregs.c), bigger jobs use the
+// vector versions in rvv.S; saving a process's vector
+// registers first makes them too costly for small ones.
+#define VECMIN   512
+
 void*
 memset(void *dst, int c, uint n)
 {
   char *cdst = (char *) dst;
-  int i;
-  for(i = 0; i < n; i++){
-    cdst[i] = c;
+  uint64 w, *wdst;
+
+  if(n >= VECMIN && kvectorbegin()){
+    vmemset(dst, c, n);
+    kvectorend();
+    return dst;
+  }
+
+  while(n > 0 && !ALIGNED(cdst)){
+    *cdst++ = c;
+    n--;
+  }
+
+  w = (uchar)c;
+  w |= w << 8;
+  w |= w << 16;
+  w |= w << 32;
+  wdst = (uint64 *) cdst;
+  for(; n >= 8*WORD; n -= 8*WORD, wdst += 8){
+    wdst[0] = w; wdst[1] = w; wdst[2] = w; wdst[3] = w;
+    wdst[4] = w; wdst[5] = w; wdst[6] = w; wdst[7] = w;
   }
+  for(; n >= WORD; n -= WORD)
+    *wdst++ = w;
+
+  cdst = (char *) wdst;
+  while(n-- > 0)
+    *cdst++ = c;
   return dst;
 }
 
@@ -16,8 +59,25 @@ memcmp(const void *v1, const void *v2, uint n)
 {
   const uchar *s1, *s2;
 
+  if(n >= VECMIN && kvectorbegin()){
+    n = vmemcmp(v1, v2, n);
+    kvectorend();
+    return n;
+  }
+
   s1 = v1;
   s2 = v2;
+  if((((uint64)s1 ^ (uint64)s2) & (WORD-1)) == 0){
+    while(n > 0 && !ALIGNED(s1)){
+      if(*s1 != *s2)
+        return *s1 - *s2;
+      s1++, s2++, n--;
+    }
+    // skip equal words; the bytes below find the difference.
+    for(; n >= WORD; n -= WORD, s1 += WORD, s2 += WORD)
+      if(*(uint64 *)s1 != *(uint64 *)s2)
+        break;
+  }
   while(n-- > 0){
     if(*s1 != *s2)
       return *s1 - *s2;
@@ -32,17 +92,64 @@ memmove(void *dst, const void *src, uint n)
 {
   const char *s;
   char *d;
+  const uint64 *ws;
+  uint64 *wd, a, b, c, e;
+  int words;
 
   s = src;
   d = dst;
+  words = (((uint64)s ^ (uint64)d) & (WORD-1)) == 0;
+  if(n >= VECMIN && !(s < d && s + n > d) && kvectorbegin()){
+    vmemcpy(dst, src, n);
+    kvectorend();
+    return dst;
+  }
+
   if(s < d && s + n > d){
+    // overlapping with dst above src: copy backwards.
+    // the word loop loads each group before storing it,
+    // and stays below the bytes it has yet to read.
     s += n;
     d += n;
+    if(words){
+      while(n > 0 && !ALIGNED(d)){
+        *--d = *--s;
+        n--;
+      }
+      ws = (const uint64 *) s;
+      wd = (uint64 *) d;
+      for(; n >= 4*WORD; n -= 4*WORD){
+        ws -= 4, wd -= 4;
+        a = ws[3]; b = ws[2]; c = ws[1]; e = ws[0];
+        wd[3] = a; wd[2] = b; wd[1] = c; wd[0] = e;
+      }
+      for(; n >= WORD; n -= WORD)
+        *--wd = *--ws;
+      s = (const char *) ws;
+      d = (char *) wd;
+    }
     while(n-- > 0)
       *--d = *--s;
-  } else
+  } else {
+    if(words){
+      while(n > 0 && !ALIGNED(d)){
+        *d++ = *s++;
+        n--;
+      }
+      ws = (const uint64 *) s;
+      wd = (uint64 *) d;
+      for(; n >= 4*WORD; n -= 4*WORD, ws += 4, wd += 4){
+        a = ws[0]; b = ws[1]; c = ws[2]; e = ws[3];
+        wd[0] = a; wd[1] = b; wd[2] = c; wd[3] = e;
+      }
+      for(; n >= WORD; n -= WORD)
+        *wd++ = *ws++;
+      s = (const char *) ws;
+      d = (char *) wd;
+    }
     while(n-- > 0)
       *d++ = *s++;
+  }
 
   return dst;
 }
@@ -5,6 +5,7 @@
 #include "spinlock.h"
 #include "proc.h"
 #include "syscall.h"
+#include "syslat.h"
 #include "defs.h"
 
 // Fetch the uint64 at addr from the current process.
@@ -12,7 +13,7 @@ int
 fetchaddr(uint64 addr, uint64 *ip)
 {
   struct proc *p = myproc();
-  if(addr >= p->sz || addr+sizeof(uint64) > p->sz)
+  if(addr >= p->leader->sz || addr+sizeof(uint64) > p->leader->sz)
     return -1;
   if(copyin(p->pagetable, (char *)ip, addr, sizeof(*ip)) != 0)
     return -1;
@@ -104,6 +105,33 @@ extern uint64 sys_unlink(void);
 extern uint64 sys_wait(void);
 extern uint64 sys_write(void);
 extern uint64 sys_uptime(void);
+extern uint64 sys_clock_gettime(void);
+extern uint64 sys_nanosleep(void);
+extern uint64 sys_getlockstat(void);
+extern uint64 sys_resetlockstat(void);
+extern uint64 sys_trace(void);
+extern uint64 sys_traceread(void);
+extern uint64 sys_getsyslat(void);
+extern uint64 sys_resetsyslat(void);
+extern uint64 sys_mmap(void);
+extern uint64 sys_munmap(void);
+extern uint64 sys_clone(void);
+extern uint64 sys_join(void);
+extern uint64 sys_futex_wait(void);
+extern uint64 sys_futex_wake(void);
+extern uint64 sys_memfd(void);
+extern uint64 sys_uring_setup(void);
+extern uint64 sys_uring_enter(void);
+extern uint64 sys_pipe2(void);
+extern uint64 sys_poll(void);
+extern uint64 sys_epoll_create(void);
+extern uint64 sys_epoll_ctl(void);
+extern uint64 sys_epoll_wait(void);
+extern uint64 sys_socket(void);
+extern uint64 sys_bind(void);
+extern uint64 sys_listen(void);
+extern uint64 sys_accept(void);
+extern uint64 sys_connect(void);
 
 static uint64 (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
@@ -127,17 +155,113 @@ static uint64 (*syscalls[])(void) = {
 [SYS_link]    sys_link,
 [SYS_mkdir]   sys_mkdir,
 [SYS_close]   sys_close,
+[SYS_clock_gettime] sys_clock_gettime,
+[SYS_nanosleep] sys_nanosleep,
+[SYS_getlockstat] sys_getlockstat,
+[SYS_resetlockstat] sys_resetlockstat,
+[SYS_trace]   sys_trace,
+[SYS_traceread] sys_traceread,
+[SYS_getsyslat] sys_getsyslat,
+[SYS_resetsyslat] sys_resetsyslat,
+[SYS_mmap]    sys_mmap,
+[SYS_munmap]  sys_munmap,
+[SYS_clone]   sys_clone,
+[SYS_join]    sys_join,
+[SYS_futex_wait] sys_futex_wait,
+[SYS_futex_wake] sys_futex_wake,
+[SYS_memfd]   sys_memfd,
+[SYS_uring_setup] sys_uring_setup,
+[SYS_uring_enter] sys_uring_enter,
+[SYS_pipe2]   sys_pipe2,
+[SYS_poll]    sys_poll,
+[SYS_epoll_create] sys_epoll_create,
+[SYS_epoll_ctl] sys_epoll_ctl,
+[SYS_epoll_wait] sys_epoll_wait,
+[SYS_socket]  sys_socket,
+[SYS_bind]    sys_bind,
+[SYS_listen]  sys_listen,
+[SYS_accept]  sys_accept,
+[SYS_connect] sys_connect,
 };
 
+// Per-hart latency histograms. Only a hart itself, with
+// interrupts off, updates its own; readers merge them all
+// without locking, so a snapshot may be slightly torn.
+struct syslat syslats[NCPU][NSYSLAT];
+
+static void
+syslatrecord(int num, uint64 t)
+{
+  struct syslat *s;
+  int b;
+
+  if(num >= NSYSLAT)
+    return;
+  for(b = 0; b < NLATBUCKET-1 && (t >> (b+1)) != 0; b++)
+    ;
+  push_off();
+  s = &syslats[cpuid()][num];
+  s->count++;
+  s->total += t;
+  if(t > s->max)
+    s->max = t;
+  s->bucket[b]++;
+  pop_off();
+}
+
+// Copy the histograms of the first n system call numbers,
+// merged over all harts, to user address addr.
+int
+syslatcopy(uint64 addr, int n)
+{
+  struct proc *p = myproc();
+  struct syslat m, *s;
+  int num, i, b;
+
+  if(n > NSYSLAT)
+    n = NSYSLAT;
+  for(num = 0; num < n; num++){
+    memset(&m, 0, sizeof(m));
+    for(i = 0; i < NCPU; i++){
+      s = &syslats[i][num];
+      m.count += s->count;
+      m.total += s->total;
+      if(s->max > m.max)
+        m.max = s->max;
+      for(b = 0; b < NLATBUCKET; b++)
+        m.bucket[b] += s->bucket[b];
+    }
+    if(copyout(p->pagetable, addr + num*sizeof(m), (char *)&m, sizeof(m)) < 0)
+      return -1;
+  }
+  return n;
+}
+
+void
+syslatreset(void)
+{
+  memset(syslats, 0, sizeof(syslats));
+}
+
 void
 syscall(void)
 {
-  int num;
+  int num, traced;
   struct proc *p = myproc();
+  uint64 args[6], t0, t1;
 
   num = p->trapframe->a7;
   if(num > 0 && num < NELEM(syscalls) && syscalls[num]) {
+    // exit() doesn't return; it records itself.
+    traced = (p->tracemask >> num) & 1 && num != SYS_exit;
+    if(traced)
+      memmove(args, &p->trapframe->a0, sizeof(args)); // a0..a5
+    t0 = readmtime();
     p->trapframe->a0 = syscalls[num]();
+    t1 = readmtime();
+    syslatrecord(num, t1 - t0);
+    if(traced)
+      tracesys(num, args, p->trapframe->a0, t0, t1);
   } else {
     printf("%d %s: unknown sys call %d\n",
             p->pid, p->name, num);
@@ -20,3 +20,30 @@
 #define SYS_link   19
 #define SYS_mkdir  20
 #define SYS_close  21
+#define SYS_clock_gettime 22
+#define SYS_nanosleep 23
+#define SYS_getlockstat 24
+#define SYS_resetlockstat 25
+#define SYS_trace  26
+#define SYS_traceread 27
+#define SYS_getsyslat 28
+#define SYS_resetsyslat 29
+#define SYS_mmap   30
+#define SYS_munmap 31
+#define SYS_clone  32
+#define SYS_join   33
+#define SYS_futex_wait 34
+#define SYS_futex_wake 35
+#define SYS_memfd  36
+#define SYS_uring_setup 37
+#define SYS_uring_enter 38
+#define SYS_pipe2  39
+#define SYS_poll   40
+#define SYS_epoll_create 41
+#define SYS_epoll_ctl 42
+#define SYS_epoll_wait 43
+#define SYS_socket 44
+#define SYS_bind   45
+#define SYS_listen 46
+#define SYS_accept 47
+#define SYS_connect 48
@@ -15,9 +15,12 @@
 #include "sleeplock.h"
 #include "file.h"
 #include "fcntl.h"
+#include "socket.h"
 
 // Fetch the nth word-sized system call argument as a file descriptor
-// and return both the descriptor and the corresponding struct file.
+// and return both the descriptor and the corresponding struct file,
+// with a reference of its own, since another thread may close the
+// descriptor meanwhile. The caller fileclose()s it when done.
 static int
 argfd(int n, int *pfd, struct file **pf)
 {
@@ -26,29 +29,32 @@ argfd(int n, int *pfd, struct file **pf)
 
   if(argint(n, &fd) < 0)
     return -1;
-  if(fd < 0 || fd >= NOFILE || (f=myproc()->ofile[fd]) == 0)
+  if((f = fdfile(fd)) == 0)
     return -1;
   if(pfd)
     *pfd = fd;
-  if(pf)
-    *pf = f;
+  *pf = f;
   return 0;
 }
 
 // Allocate a file descriptor for the given file.
 // Takes over file reference from caller on success.
+// The threads of a process share its leader's ofile[].
 static int
 fdalloc(struct file *f)
 {
   int fd;
-  struct proc *p = myproc();
+  struct proc *g = myproc()->leader;
 
+  acquire(&g->lock);
   for(fd = 0; fd < NOFILE; fd++){
-    if(p->ofile[fd] == 0){
-      p->ofile[fd] = f;
+    if(g->ofile[fd] == 0){
+      g->ofile[fd] = f;
+      release(&g->lock);
       return fd;
     }
   }
+  release(&g->lock);
   return -1;
 }
 
@@ -60,9 +66,11 @@ sys_dup(void)
 
   if(argfd(0, 0, &f) < 0)
     return -1;
-  if((fd=fdalloc(f)) < 0)
+  // argfd()'s reference becomes the new descriptor's.
+  if((fd=fdalloc(f)) < 0){
+    fileclose(f);
     return -1;
-  filedup(f);
+  }
   return fd;
 }
 
@@ -70,25 +78,28 @@ uint64
 sys_read(void)
 {
   struct file *f;
-  int n;
+  int n, r;
   uint64 p;
 
-  if(argfd(0, 0, &f) < 0 || argint(2, &n) < 0 || argaddr(1, &p) < 0)
+  if(argint(2, &n) < 0 || argaddr(1, &p) < 0 || argfd(0, 0, &f) < 0)
     return -1;
-  return fileread(f, p, n);
+  r = fileread(f, p, n);
+  fileclose(f);
+  return r;
 }
 
 uint64
 sys_write(void)
 {
   struct file *f;
-  int n;
+  int n, r;
   uint64 p;
 
-  if(argfd(0, 0, &f) < 0 || argint(2, &n) < 0 || argaddr(1, &p) < 0)
+  if(argint(2, &n) < 0 || argaddr(1, &p) < 0 || argfd(0, 0, &f) < 0)
     return -1;
-
-  return filewrite(f, p, n);
+  r = filewrite(f, p, n);
+  fileclose(f);
+  return r;
 }
 
 uint64
@@ -97,9 +108,21 @@ sys_close(void)
   int fd;
   struct file *f;
 
+  struct proc *g = myproc()->leader;
+
   if(argfd(0, &fd, &f) < 0)
     return -1;
-  myproc()->ofile[fd] = 0;
+  // another thread may be closing it too.
+  acquire(&g->lock);
+  if(g->ofile[fd] != f){
+    release(&g->lock);
+    fileclose(f);
+    return -1;
+  }
+  g->ofile[fd] = 0;
+  release(&g->lock);
+  // the descriptor's reference, and argfd()'s.
+  fileclose(f);
   fileclose(f);
   return 0;
 }
@@ -109,10 +132,13 @@ sys_fstat(void)
 {
   struct file *f;
   uint64 st; // user pointer to struct stat
+  int r;
 
-  if(argfd(0, 0, &f) < 0 || argaddr(1, &st) < 0)
+  if(argaddr(1, &st) < 0 || argfd(0, 0, &f) < 0)
     return -1;
-  return filestat(f, st);
+  r = filestat(f, st);
+  fileclose(f);
+  return r;
 }
 
 // Create the path new as a link to the same inode as old.
@@ -240,7 +266,7 @@ bad:
 // 为新inode创建一个新名称。
 // 从调用nameiparent开始，以获取父目录的inode。然后调用dirlookup检查名称是否已经存在
 //如果名称确实存在，create的行为取决于它用于哪个系统调用, 返回已加锁的inode
-static struct inode*
+struct inode*
 create(char *path, short type, short major, short minor)
 {
   struct inode *ip, *dp;
@@ -285,17 +311,14 @@ create(char *path, short type, short major, short minor)
   return ip;
 }
 
-uint64
-sys_open(void)
+// open() path with omode, for the current process.
+// Returns the file descriptor, or -1.
+int
+fileopen(char *path, int omode)
 {
-  char path[MAXPATH];
-  int fd, omode;
+  int fd;
   struct file *f;
   struct inode *ip;
-  int n;
-
-  if((n = argstr(0, path, MAXPATH)) < 0 || argint(1, &omode) < 0)
-    return -1;
 
   begin_op();
 
@@ -311,7 +334,8 @@ sys_open(void)
       return -1;
     }
     ilock(ip);
-    if(ip->type == T_DIR && omode != O_RDONLY){
+    // a socket is connect()ed to; open() is for stat().
+    if((ip->type == T_DIR || ip->type == T_SOCK) && omode != O_RDONLY){
       iunlockput(ip);
       end_op();
       return -1;
@@ -342,6 +366,7 @@ sys_open(void)
   f->ip = ip;
   f->readable = !(omode & O_WRONLY);
   f->writable = (omode & O_WRONLY) || (omode & O_RDWR);
+  f->nonblock = (omode & O_NONBLOCK) != 0;
 
   if((omode & O_TRUNC) && ip->type == T_FILE){
     itrunc(ip);
@@ -353,6 +378,17 @@ sys_open(void)
   return fd;
 }
 
+uint64
+sys_open(void)
+{
+  char path[MAXPATH];
+  int omode;
+
+  if(argstr(0, path, MAXPATH) < 0 || argint(1, &omode) < 0)
+    return -1;
+  return fileopen(path, omode);
+}
+
 uint64
 sys_mkdir(void)
 {
@@ -393,8 +429,8 @@ uint64
 sys_chdir(void)
 {
   char path[MAXPATH];
-  struct inode *ip;
-  struct proc *p = myproc();
+  struct inode *ip, *old;
+  struct proc *g = myproc()->leader;
   
   begin_op();
   if(argstr(0, path, MAXPATH) < 0 || (ip = namei(path)) == 0){
@@ -408,9 +444,13 @@ sys_chdir(void)
     return -1;
   }
   iunlock(ip);
-  iput(p->cwd);
+  // namex() reads the cwd under g->lock.
+  acquire(&g->lock);
+  old = g->cwd;
+  g->cwd = ip;
+  release(&g->lock);
+  iput(old);
   end_op();
-  p->cwd = ip;
   return 0;
 }
 
@@ -456,33 +496,274 @@ sys_exec(void)
   return -1;
 }
 
-uint64
-sys_pipe(void)
+// make a pipe, with flags (O_NONBLOCK) on both ends, and
+// put its read and write fds at user address fdarray.
+static int
+makepipe(uint64 fdarray, int flags)
 {
-  uint64 fdarray; // user pointer to array of two integers
   struct file *rf, *wf;
   int fd0, fd1;
   struct proc *p = myproc();
 
-  if(argaddr(0, &fdarray) < 0)
-    return -1;
   if(pipealloc(&rf, &wf) < 0)
     return -1;
+  rf->nonblock = wf->nonblock = (flags & O_NONBLOCK) != 0;
   fd0 = -1;
   if((fd0 = fdalloc(rf)) < 0 || (fd1 = fdalloc(wf)) < 0){
     if(fd0 >= 0)
-      p->ofile[fd0] = 0;
+      p->leader->ofile[fd0] = 0;
     fileclose(rf);
     fileclose(wf);
     return -1;
   }
   if(copyout(p->pagetable, fdarray, (char*)&fd0, sizeof(fd0)) < 0 ||
      copyout(p->pagetable, fdarray+sizeof(fd0), (char *)&fd1, sizeof(fd1)) < 0){
-    p->ofile[fd0] = 0;
-    p->ofile[fd1] = 0;
+    p->leader->ofile[fd0] = 0;
+    p->leader->ofile[fd1] = 0;
     fileclose(rf);
     fileclose(wf);
     return -1;
   }
   return 0;
 }
+
+uint64
+sys_pipe(void)
+{
+  uint64 fdarray; // user pointer to array of two integers
+
+  if(argaddr(0, &fdarray) < 0)
+    return -1;
+  return makepipe(fdarray, 0);
+}
+
+uint64
+sys_pipe2(void)
+{
+  uint64 fdarray;
+  int flags;
+
+  if(argaddr(0, &fdarray) < 0 || argint(1, &flags) < 0)
+    return -1;
+  return makepipe(fdarray, flags);
+}
+
+uint64
+sys_poll(void)
+{
+  uint64 fds;
+  int nfds, timeout;
+
+  if(argaddr(0, &fds) < 0 || argint(1, &nfds) < 0 || argint(2, &timeout) < 0)
+    return -1;
+  return poll(fds, nfds, timeout);
+}
+
+uint64
+sys_epoll_create(void)
+{
+  struct file *f;
+  int fd;
+
+  if((f = epollalloc()) == 0)
+    return -1;
+  if((fd = fdalloc(f)) < 0){
+    fileclose(f);
+    return -1;
+  }
+  return fd;
+}
+
+uint64
+sys_epoll_ctl(void)
+{
+  struct file *f;
+  uint64 ev;
+  int epfd, op, fd, r;
+
+  if(argint(0, &epfd) < 0 || argint(1, &op) < 0 || argint(2, &fd) < 0 || argaddr(3, &ev) < 0)
+    return -1;
+  // a reference of our own: another thread may close epfd.
+  if((f = fdfile(epfd)) == 0)
+    return -1;
+  r = f->type == FD_EPOLL ? epollctl(f->ep, op, fd, ev) : -1;
+  fileclose(f);
+  return r;
+}
+
+uint64
+sys_epoll_wait(void)
+{
+  struct file *f;
+  uint64 evs;
+  int epfd, max, timeout, r;
+
+  if(argint(0, &epfd) < 0 || argaddr(1, &evs) < 0 || argint(2, &max) < 0 || argint(3, &timeout) < 0)
+    return -1;
+  if((f = fdfile(epfd)) == 0)
+    return -1;
+  r = f->type == FD_EPOLL ? epollwait(f->ep, evs, max, timeout) : -1;
+  fileclose(f);
+  return r;
+}
+
+uint64
+sys_socket(void)
+{
+  struct file *f;
+  int domain, type, fd;
+
+  if(argint(0, &domain) < 0 || argint(1, &type) < 0)
+    return -1;
+  if(domain != AF_UNIX || type != SOCK_STREAM)
+    return -1;
+  if((f = sockalloc()) == 0)
+    return -1;
+  if((fd = fdalloc(f)) < 0){
+    fileclose(f);
+    return -1;
+  }
+  return fd;
+}
+
+uint64
+sys_bind(void)
+{
+  char path[MAXPATH];
+  struct file *f;
+  int r;
+
+  if(argstr(1, path, MAXPATH) < 0 || argfd(0, 0, &f) < 0)
+    return -1;
+  r = f->type == FD_SOCK ? sockbind(f->sock, path) : -1;
+  fileclose(f);
+  return r;
+}
+
+uint64
+sys_listen(void)
+{
+  struct file *f;
+  int backlog, r;
+
+  if(argint(1, &backlog) < 0 || argfd(0, 0, &f) < 0)
+    return -1;
+  r = f->type == FD_SOCK ? socklisten(f->sock, backlog) : -1;
+  fileclose(f);
+  return r;
+}
+
+uint64
+sys_accept(void)
+{
+  struct file *f, *nf;
+  int fd;
+
+  if(argfd(0, 0, &f) < 0)
+    return -1;
+  nf = f->type == FD_SOCK ? sockaccept(f->sock, f->nonblock) : 0;
+  fileclose(f);
+  if(nf == 0)
+    return -1;
+  if((fd = fdalloc(nf)) < 0){
+    fileclose(nf);
+    return -1;
+  }
+  return fd;
+}
+
+uint64
+sys_connect(void)
+{
+  char path[MAXPATH];
+  struct file *f;
+  int r;
+
+  if(argstr(1, path, MAXPATH) < 0 || argfd(0, 0, &f) < 0)
+    return -1;
+  r = f->type == FD_SOCK ? sockconnect(f->sock, path) : -1;
+  fileclose(f);
+  return r;
+}
+
+// a file of size bytes of shared memory (shm.c), to be
+// mmap()ed with MAP_SHARED; read() and write() fail on it.
+uint64
+sys_memfd(void)
+{
+  uint64 size;
+  struct file *f;
+  int fd;
+
+  if(argaddr(0, &size) < 0)
+    return -1;
+  if((f = filealloc()) == 0)
+    return -1;
+  if((f->shm = shmalloc(size)) == 0){
+    fileclose(f);
+    return -1;
+  }
+  f->type = FD_SHM;
+  f->readable = 1;
+  f->writable = 1;
+  if((fd = fdalloc(f)) < 0){
+    fileclose(f);
+    return -1;
+  }
+  return fd;
+}
+
+uint64
+sys_uring_setup(void)
+{
+  int n;
+
+  if(argint(0, &n) < 0)
+    return -1;
+  return uringsetup(n);
+}
+
+uint64
+sys_uring_enter(void)
+{
+  int nsubmit, minwait;
+
+  if(argint(0, &nsubmit) < 0 || argint(1, &minwait) < 0)
+    return -1;
+  return uringenter(nsubmit, minwait);
+}
+
+uint64
+sys_mmap(void)
+{
+  uint64 addr, len, off, r;
+  int prot, flags;
+  struct file *f = 0;
+
+  if(argaddr(0, &addr) < 0 || argaddr(1, &len) < 0 || argint(2, &prot) < 0 ||
+     argint(3, &flags) < 0 || argaddr(5, &off) < 0)
+    return -1;
+  if((flags & MAP_ANONYMOUS) == 0 && argfd(4, 0, &f) < 0)
+    return -1;
+  vmlock(myproc());
+  r = mmap(addr, len, prot, flags, f, off);
+  vmunlock(myproc());
+  // mmap() took a reference of its own for the region.
+  if(f)
+    fileclose(f);
+  return r;
+}
+
+uint64
+sys_munmap(void)
+{
+  uint64 addr, len;
+  int r;
+
+  if(argaddr(0, &addr) < 0 || argaddr(1, &len) < 0)
+    return -1;
+  vmlock(myproc());
+  r = munmap(addr, len);
+  vmunlock(myproc());
+  return r;
+}
@@ -0,0 +1,15 @@
+// Latency of one system call, merged over all harts,
+// read with getsyslat().
+// Both the kernel and user programs use this header file.
+#define NSYSLAT    64  // system call numbers kept
+#define NLATBUCKET 32  // log2 latency buckets
+
+// Times are in CLINT_MTIME units (MTIME_FREQ per second)
+// rather than cycles, since a call that sleeps may return
+// on a different hart than it started on.
+struct syslat {
+  uint64 count;   // Calls that returned
+  uint64 total;   // Sum of their times
+  uint64 max;     // Slowest one
+  uint64 bucket[NLATBUCKET]; // Calls taking [2^i, 2^(i+1)); 0 goes in [0]
+};
@@ -6,6 +6,7 @@
 #include "memlayout.h"
 #include "spinlock.h"
 #include "proc.h"
+#include "time.h"
 // 进程相关的系统调用
 uint64
 sys_exit(void)
@@ -29,6 +30,49 @@ sys_fork(void)
   return fork();
 }
 
+uint64
+sys_clone(void)
+{
+  uint64 fn, arg, sp;
+
+  if(argaddr(0, &fn) < 0 || argaddr(1, &arg) < 0 || argaddr(2, &sp) < 0)
+    return -1;
+  return clone(fn, arg, sp);
+}
+
+uint64
+sys_join(void)
+{
+  int tid;
+  uint64 p;
+
+  if(argint(0, &tid) < 0 || argaddr(1, &p) < 0)
+    return -1;
+  return join(tid, p);
+}
+
+uint64
+sys_futex_wait(void)
+{
+  uint64 addr;
+  int val;
+
+  if(argaddr(0, &addr) < 0 || argint(1, &val) < 0)
+    return -1;
+  return futexwait(addr, val);
+}
+
+uint64
+sys_futex_wake(void)
+{
+  uint64 addr;
+  int n;
+
+  if(argaddr(0, &addr) < 0 || argint(1, &n) < 0)
+    return -1;
+  return futexwake(addr, n);
+}
+
 uint64
 sys_wait(void)
 {
@@ -43,12 +87,15 @@ sys_sbrk(void)
 {
   int addr;
   int n;
+  struct proc *p = myproc();
 
   if(argint(0, &n) < 0)
     return -1;
-  addr = myproc()->sz;
+  vmlock(p);
+  addr = p->leader->sz;
   if(growproc(n) < 0)
-    return -1;
+    addr = -1;
+  vmunlock(p);
   return addr;
 }
 
@@ -95,3 +142,122 @@ sys_uptime(void)
   release(&tickslock);
   return xticks;
 }
+
+// store the time since boot, in nanoseconds
+// of CLINT_MTIME resolution, in *ts.
+uint64
+sys_clock_gettime(void)
+{
+  uint64 addr, now;
+  struct timespec ts;
+
+  if(argaddr(0, &addr) < 0)
+    return -1;
+  now = readmtime();
+  ts.sec = now / MTIME_FREQ;
+  ts.nsec = (now % MTIME_FREQ) * (1000000000 / MTIME_FREQ);
+  if(copyout(myproc()->pagetable, addr, (char *)&ts, sizeof(ts)) < 0)
+    return -1;
+  return 0;
+}
+
+// sleep for at least *ts, using a one-shot timer
+// interrupt rather than waiting for clock ticks.
+uint64
+sys_nanosleep(void)
+{
+  uint64 addr, deadline;
+  struct timespec ts;
+
+  if(argaddr(0, &addr) < 0)
+    return -1;
+  if(copyin(myproc()->pagetable, (char *)&ts, addr, sizeof(ts)) < 0)
+    return -1;
+  if(ts.nsec >= 1000000000)
+    return -1;
+
+  // round up, so as never to sleep too little.
+  deadline = readmtime() + ts.sec * MTIME_FREQ +
+    (ts.nsec * MTIME_FREQ + 1000000000 - 1) / 1000000000;
+
+  acquire(&hrtimelock);
+  while(readmtime() < deadline){
+    if(myproc()->killed){
+      release(&hrtimelock);
+      return -1;
+    }
+    // holding hrtimelock keeps interrupts off, so the
+    // one-shot is armed on the hart that will see it.
+    timerarm(deadline);
+    sleep(&hrtimelock, &hrtimelock);
+  }
+  release(&hrtimelock);
+  return 0;
+}
+
+// copy statistics about the kernel's locks
+// to an array of n struct lockstat.
+uint64
+sys_getlockstat(void)
+{
+  uint64 addr;
+  int n;
+
+  if(argaddr(0, &addr) < 0 || argint(1, &n) < 0)
+    return -1;
+  return lockstatcopy(addr, n);
+}
+
+// zero the statistics about the kernel's locks.
+uint64
+sys_resetlockstat(void)
+{
+  lockstatreset();
+  return 0;
+}
+
+// trace the system calls in mask (1 << SYS_x) made
+// by this process and the children it forks from now on.
+uint64
+sys_trace(void)
+{
+  uint64 mask;
+
+  if(argaddr(0, &mask) < 0)
+    return -1;
+  myproc()->tracemask = mask;
+  return 0;
+}
+
+// copy up to n records of traced system calls
+// to an array of struct tracerec.
+uint64
+sys_traceread(void)
+{
+  uint64 addr;
+  int n;
+
+  if(argaddr(0, &addr) < 0 || argint(1, &n) < 0)
+    return -1;
+  return traceread(addr, n);
+}
+
+// copy per-system-call latency histograms
+// to an array of n struct syslat.
+uint64
+sys_getsyslat(void)
+{
+  uint64 addr;
+  int n;
+
+  if(argaddr(0, &addr) < 0 || argint(1, &n) < 0)
+    return -1;
+  return syslatcopy(addr, n);
+}
+
+uint64
+sys_resetsyslat(void)
+{
+  syslatreset();
+  return 0;
+}
@@ -0,0 +1,6 @@
+// High-resolution time, for clock_gettime() and nanosleep().
+// Both the kernel and user programs use this header file.
+struct timespec {
+  uint64 sec;   // seconds
+  uint64 nsec;  // nanoseconds, 0..999999999
+};
@@ -0,0 +1,133 @@
+//
+// System call tracing.
+// syscall() appends a record for each system call whose bit
+// is set in the calling process's p->tracemask to a ring
+// owned by the hart it returns on. Writers never wait: the
+// ring just overwrites its oldest records, and a reader that
+// falls behind gets a TRACE_LOST record instead.
+//
+// Each ring has a single writer, its hart, with interrupts
+// off, so it needs no lock. A reader copies a record and
+// then checks that its seq is unchanged, the way a seqlock
+// reader does, so a record overwritten mid-copy is noticed.
+//
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "fcntl.h"
+#include "defs.h"
+#include "trace.h"
+
+#define NTRACE 256  // records per hart
+
+struct tracering {
+  struct tracerec rec[NTRACE];
+  uint64 head;  // Records ever written; only this hart writes it
+};
+
+struct tracering traces[NCPU];
+
+// Reading side: one reader at a time.
+struct {
+  struct spinlock lock;
+  uint64 pos[NCPU];  // Next record to read from each ring
+  uint64 lost[NCPU]; // Records lost, not yet reported
+} tracer;
+
+void
+traceinit(void)
+{
+  initlock(&tracer.lock, "tracer");
+}
+
+// Append a record for system call num to this hart's ring.
+void
+tracesys(int num, uint64 *args, uint64 ret, uint64 tenter, uint64 texit)
+{
+  struct tracering *r;
+  struct tracerec *e;
+  uint64 h;
+
+  push_off();
+  r = &traces[cpuid()];
+  h = r->head;
+  e = &r->rec[h % NTRACE];
+
+  // Invalidate the slot before changing it, so that a
+  // reader copying the old record sees the change.
+  e->seq = 0;
+  __sync_synchronize();
+  memmove(e->args, args, sizeof(e->args));
+  e->ret = ret;
+  e->tenter = tenter;
+  e->texit = texit;
+  e->pid = myproc()->pid;
+  e->num = num;
+  e->cpu = cpuid();
+  __sync_synchronize();
+  e->seq = h + 1;
+  r->head = h + 1;
+  pop_off();
+}
+
+// Copy up to n unread records to user address addr.
+// Returns the number copied, 0 if there are none yet.
+int
+traceread(uint64 addr, int n)
+{
+  struct proc *p = myproc();
+  struct tracering *r;
+  struct tracerec e, *slot;
+  uint64 head, pos;
+  int i, got = 0;
+
+  // copyout() can't fault pages in with tracer.lock held.
+  if(n > 0 && vmatouch(p->pagetable, addr, (uint64)n * sizeof(e), PROT_WRITE) < 0)
+    return -1;
+  acquire(&tracer.lock);
+  for(i = 0; i < NCPU && got < n; i++){
+    r = &traces[i];
+    while(got < n){
+      head = *(volatile uint64 *)&r->head;
+      __sync_synchronize();
+
+      // Skip what the writer has lapped, and say so.
+      if(head - tracer.pos[i] > NTRACE){
+        tracer.lost[i] += head - tracer.pos[i] - NTRACE;
+        tracer.pos[i] = head - NTRACE;
+      }
+
+      if(tracer.lost[i]){
+        memset(&e, 0, sizeof(e));
+        e.num = TRACE_LOST;
+        e.ret = tracer.lost[i];
+        e.cpu = i;
+        tracer.lost[i] = 0;
+      } else if(tracer.pos[i] == head){
+        break;
+      } else {
+        pos = tracer.pos[i]++;
+        slot = &r->rec[pos % NTRACE];
+        memmove(&e, slot, sizeof(e));
+        __sync_synchronize();
+        if(e.seq != pos + 1 || *(volatile uint64 *)&slot->seq != pos + 1){
+          // overwritten while we were copying it.
+          tracer.lost[i]++;
+          continue;
+        }
+      }
+
+      if(copyout(p->pagetable, addr + got*sizeof(e), (char *)&e, sizeof(e)) < 0){
+        release(&tracer.lock);
+        return -1;
+      }
+      got++;
+    }
+  }
+  release(&tracer.lock);
+  return got;
+}
@@ -0,0 +1,17 @@
+// One traced system call, read with traceread().
+// Both the kernel and user programs use this header file.
+struct tracerec {
+  uint64 seq;     // Position in its hart's ring, plus one
+  uint64 args[6]; // a0..a5 on entry
+  uint64 ret;     // Return value; for TRACE_LOST, records lost
+  uint64 tenter;  // CLINT_MTIME on entry
+  uint64 texit;   // CLINT_MTIME on return (== tenter for exit)
+  int pid;
+  short num;      // System call number, or TRACE_LOST
+  char cpu;       // Hart the call returned on
+  char pad;
+};
+
+// traceread() reports records that were overwritten
+// before they could be read as one with this num.
+#define TRACE_LOST 0
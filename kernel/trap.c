@@ -5,10 +5,17 @@
 #include "spinlock.h"
 #include "proc.h"
 #include "defs.h"
+#include "vdso.h"
 // 对陷入指令和中断进行处理并返回的C代码
 struct spinlock tickslock;
 uint ticks;
 
+// mapped read-only at USHARED in every process.
+struct ushared *ushared;
+
+// nanosleep() sleeps on this, woken by one-shot timer interrupts.
+struct spinlock hrtimelock;
+
 extern char trampoline[], uservec[], userret[];
 
 // in kernelvec.S, calls kerneltrap().
@@ -19,7 +26,13 @@ extern int devintr();
 void
 trapinit(void)
 {
-  initlock(&tickslock, "time");
+  initticketlock(&tickslock, "time");
+  initlock(&hrtimelock, "hrtime");
+
+  if((ushared = (struct ushared *)kalloc()) == 0)
+    panic("trapinit: ushared");
+  memset(ushared, 0, PGSIZE);
+  ushared->mtimefreq = MTIME_FREQ;
 }
 
 // set up to take exceptions and traps while in the kernel.
@@ -27,6 +40,21 @@ void
 trapinithart(void)
 {
   w_stvec((uint64)kernelvec);
+  // count the harts for user programs (task.c).
+  __sync_fetch_and_add(&ushared->ncpu, 1);
+}
+
+// a page fault in user space, perhaps the first touch of an
+// mmap() page. faulting that in may read a file, so turn
+// interrupts on first, as for a system call. returns 1 if
+// the instruction can be retried.
+static int
+pagefault(struct proc *p, uint64 scause, uint64 stval)
+{
+  if(scause != 12 && scause != 13 && scause != 15)
+    return 0;
+  intr_on();
+  return vmatrap(p, scause, stval);
 }
 
 //
@@ -49,8 +77,10 @@ usertrap(void)
   
   // save user program counter. 保存用户程序的pc到epc中
   p->trapframe->epc = r_sepc();
+  // interrupts, once on, change these.
+  uint64 scause = r_scause(), stval = r_stval();
   
-  if(r_scause() == 8){
+  if(scause == 8){
     // system call
 
     if(p->killed)
@@ -67,9 +97,13 @@ usertrap(void)
     syscall();
   } else if((which_dev = devintr()) != 0){  // 1=uart,disk  2=timer
     // ok
+  } else if(scause == 2 && xregstrap(p)){
+    // first FP or vector instruction; retry it.
+  } else if(pagefault(p, scause, stval)){
+    // first touch of an mmap() page; retry it.
   } else {
-    printf("usertrap(): unexpected scause %p pid=%d\n", r_scause(), p->pid);
-    printf("            sepc=%p stval=%p\n", r_sepc(), r_stval());
+    printf("usertrap(): unexpected scause %p pid=%d\n", scause, p->pid);
+    printf("            sepc=%p stval=%p\n", p->trapframe->epc, stval);
     p->killed = 1;
   }
 
@@ -113,19 +147,21 @@ usertrapret(void)
   unsigned long x = r_sstatus();
   x &= ~SSTATUS_SPP; // clear SPP to 0 for user mode
   x |= SSTATUS_SPIE; // enable interrupts in user mode
+  x = xregsreturn(p, x); // FP and vector registers
   w_sstatus(x);
 
   // set S Exception Program Counter to the saved user pc.
   w_sepc(p->trapframe->epc);
 
   // tell trampoline.S the user page table to switch to.
-  uint64 satp = MAKE_SATP(p->pagetable);
+  uint64 satp = MAKE_SATP(p->pagetable, p->uasid);
 
   // jump to trampoline.S at the top of memory, which 
   // switches to the user page table, restores user registers,
   // and switches to user mode with sret.
+  // a thread's trapframe is mapped at THREADFRAME() instead.
   uint64 fn = TRAMPOLINE + (userret - trampoline);
-  ((void (*)(uint64,uint64))fn)(TRAPFRAME, satp);
+  ((void (*)(uint64,uint64))fn)(p->tfva, satp);
 }
 
 // interrupts and exceptions from kernel code go here via kernelvec,
@@ -143,7 +179,9 @@ kerneltrap()
   if(intr_get() != 0)
     panic("kerneltrap: interrupts enabled");
 
-  if((which_dev = devintr()) == 0){
+  if(ucopytrap(scause, &sepc)){
+    // bad user address in copyin() or copyout(); it returns -1.
+  } else if((which_dev = devintr()) == 0){
     printf("scause %p\n", scause);
     printf("sepc=%p stval=%p\n", r_sepc(), r_stval());
     panic("kerneltrap");
@@ -164,14 +202,43 @@ clockintr()
 {
   acquire(&tickslock);
   ticks++;
+  ushared->ticks = ticks;
   wakeup(&ticks); // 确保sleep系统调用可以唤醒
   release(&tickslock);
 }
 
+// a one-shot timer armed by nanosleep() or poll() went off.
+// every sleeper re-checks its own deadline, and
+// those still waiting arm another one-shot.
+void
+hrtimerintr()
+{
+  acquire(&hrtimelock);
+  wakeup(&hrtimelock);
+  release(&hrtimelock);
+  polltimer();
+}
+
+// CLINT_MTIME cycles since boot, MTIME_FREQ per second.
+uint64
+readmtime(void)
+{
+  return *(volatile uint64*)CLINT_MTIME;
+}
+
+// send an inter-processor interrupt to hart.
+// it arrives as a machine software interrupt at
+// timervec, which forwards it as TIMER_IPI.
+void
+ipi(int hart)
+{
+  *(volatile uint32*)CLINT_MSIP(hart) = 1;
+}
+
 // check if it's an external interrupt or software interrupt,
 // and handle it.
-// returns 2 if timer interrupt,
-// 1 if other device,
+// returns 2 if clock tick,
+// 1 if other device, one-shot timer, or IPI,
 // 0 if not recognized.
 int
 devintr()
@@ -204,15 +271,35 @@ devintr()
     // software interrupt from a machine-mode timer interrupt,
     // forwarded by timervec in kernelvec.S.
 
-    if(cpuid() == 0){
-      clockintr();
-    }
-    
     // acknowledge the software interrupt by clearing
-    // the SSIP bit in sip.
+    // the SSIP bit in sip. do it before asking timervec
+    // why, so that a timer interrupt arriving in between
+    // raises SSIP again rather than being lost.
     w_sip(r_sip() & ~2);
 
-    return 2;
+    int why = timerpending();
+
+    if((why & TIMER_TICK) && cpuid() == 0){
+      clockintr();
+    }
+    if(why & TIMER_ONESHOT){
+      hrtimerintr();
+    }
+    if(why & (TIMER_TICK|TIMER_ONESHOT)){
+      profintr(why & TIMER_TICK);
+    }
+
+    // only the periodic tick preempts the running process;
+    // one-shots (nanosleep, the profiler) can come much more
+    // often, and processes they wake get an idle hart from
+    // wakeup()'s IPI. TIMER_IPI gets an idle hart out of wfi
+    // in scheduler(), or asks for a TLB flush because another
+    // thread of the running process changed its page table.
+    if(why & TIMER_IPI)
+      tlbcheck();
+    if(why & TIMER_TICK)
+      return 2;
+    return 1;
   } else {
     return 0;
   }
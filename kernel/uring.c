@@ -0,0 +1,237 @@
+//
+// Submission and completion queues: a program puts read(),
+// write(), open() and fsync requests in a page it shares with
+// the kernel (uring.h) and hands over a batch of them with one
+// uring_enter() system call, which can also wait for some to
+// complete. Kernel threads of the process (kthread()) carry
+// them out, a few at once, so that many can be in flight and
+// a trap is paid per batch rather than per request.
+//
+// The kernel threads are threads of the process, so they see
+// its memory, open files and cwd as a system call would.
+// uring_enter() copies the submissions it takes into the
+// kernel's struct uring, where the threads find them; the
+// program can't change them once taken. It takes no more than
+// the completion queue can hold with the ones already in
+// flight, so the threads never find the queue full.
+//
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+#include "fcntl.h"
+#include "shm.h"
+#include "uring.h"
+#include "defs.h"
+
+struct uring {
+  struct spinlock lock;
+  struct uringpage *rp;             // the shared page, which we hold a reference to
+  uint sqhead;                      // next submission to take
+  uint cqtail;                      // next completion to fill
+  struct usqe pending[URINGSIZE];   // taken, for the threads to start
+  uint phead;                       // next to start
+  uint ptail;                       // next free slot; threads sleep on it
+  int inflight;                     // taken and not yet completed
+};
+
+// completions the program hasn't taken yet.
+static int
+cqused(struct uring *u)
+{
+  uint n = u->cqtail - __atomic_load_n(&u->rp->cqhead, __ATOMIC_ACQUIRE);
+
+  // the program may have written anything there.
+  return n > URINGSIZE ? URINGSIZE : n;
+}
+
+// carry out e, as its system call would, and return what
+// the system call would.
+static int
+uringdo(struct usqe *e)
+{
+  char path[MAXPATH];
+  struct file *f;
+  int r;
+
+  if(e->op == UR_NOP)
+    return 0;
+  if(e->op == UR_OPEN){
+    if(fetchstr(e->addr, path, MAXPATH) < 0)
+      return -1;
+    return fileopen(path, e->len);
+  }
+  if((int)e->len < 0 || (e->off != UR_CUROFF && e->off > 0xffffffff))
+    return -1;
+  if((f = fdfile(e->fd)) == 0)
+    return -1;
+  if(e->op == UR_READ){
+    if(e->off == UR_CUROFF)
+      r = fileread(f, e->addr, e->len);
+    else
+      r = filepread(f, e->addr, e->len, e->off);
+  } else if(e->op == UR_WRITE){
+    if(e->off == UR_CUROFF)
+      r = filewrite(f, e->addr, e->len);
+    else
+      r = filepwrite(f, e->addr, e->len, e->off);
+  } else if(e->op == UR_FSYNC){
+    // write() commits its log transactions before it
+    // returns, so what was written is on disk already.
+    r = 0;
+  } else {
+    r = -1;
+  }
+  fileclose(f);
+  return r;
+}
+
+// a kernel thread of the process: carry out submissions
+// until killed.
+static void
+uringworker(void *arg)
+{
+  struct uring *u = arg;
+  struct proc *p = myproc();
+  struct usqe e;
+  struct ucqe *c;
+  int r;
+
+  acquire(&u->lock);
+  for(;;){
+    while(u->phead == u->ptail && !p->killed)
+      sleep(&u->ptail, &u->lock);
+    if(p->killed)
+      break;
+    e = u->pending[u->phead++ % URINGSIZE];
+    release(&u->lock);
+
+    r = uringdo(&e);
+
+    acquire(&u->lock);
+    c = &u->rp->cq[u->cqtail % URINGSIZE];
+    c->data = e.data;
+    c->res = r;
+    u->cqtail++;
+    __atomic_store_n(&u->rp->cqtail, u->cqtail, __ATOMIC_RELEASE);
+    u->inflight--;
+    wakeup(&u->cqtail);
+  }
+  release(&u->lock);
+}
+
+// Give the current process the queues, in a page mapped
+// into its memory, and nworkers kernel threads to carry out
+// its submissions. Returns the page's address, or -1.
+uint64
+uringsetup(int nworkers)
+{
+  struct proc *p = myproc(), *g = p->leader;
+  struct uring *u;
+  struct file *f;
+  uint64 va = -1;
+  int i;
+
+  if(nworkers < 1 || nworkers > URINGWORKERS)
+    return -1;
+  // vmlock() keeps other threads from setting up queues too.
+  vmlock(p);
+  if(g->uring || (u = kalloc()) == 0){
+    vmunlock(p);
+    return -1;
+  }
+  memset(u, 0, sizeof(*u));
+  initlock(&u->lock, "uring");
+
+  // the page is shared memory (shm.c). our reference to it
+  // keeps it around if the program munmap()s it.
+  if((f = filealloc()) == 0)
+    goto bad;
+  if((f->shm = shmalloc(PGSIZE)) == 0){
+    fileclose(f);
+    goto bad;
+  }
+  f->type = FD_SHM;
+  f->readable = 1;
+  f->writable = 1;
+  if((u->rp = (struct uringpage*)shmpage(f->shm, 0)) != 0)
+    va = mmap(0, PGSIZE, PROT_READ|PROT_WRITE, MAP_SHARED, f, 0);
+  // the region holds the file now.
+  fileclose(f);
+  if(va == -1)
+    goto bad;
+
+  for(i = 0; i < nworkers; i++)
+    if(kthread(uringworker, u) < 0)
+      break;
+  if(i == 0){
+    munmap(va, PGSIZE);
+    goto bad;
+  }
+  // uring_enter() doesn't take vmlock().
+  __sync_synchronize();
+  g->uring = u;
+  vmunlock(p);
+  return va;
+
+ bad:
+  vmunlock(p);
+  if(u->rp)
+    kfree(u->rp);
+  kfree(u);
+  return -1;
+}
+
+// Take up to nsubmit submissions, and then wait until there
+// are at least minwait completions for the program to take,
+// or nothing is in flight. Returns the number taken, or -1.
+int
+uringenter(int nsubmit, int minwait)
+{
+  struct proc *p = myproc();
+  struct uring *u = p->leader->uring;
+  struct uringpage *rp;
+  uint tail;
+  int n = 0;
+
+  if(u == 0)
+    return -1;
+  rp = u->rp;
+
+  acquire(&u->lock);
+  tail = __atomic_load_n(&rp->sqtail, __ATOMIC_ACQUIRE);
+  while(n < nsubmit && u->sqhead != tail && u->inflight + cqused(u) < URINGSIZE){
+    u->pending[u->ptail++ % URINGSIZE] = rp->sq[u->sqhead++ % URINGSIZE];
+    u->inflight++;
+    n++;
+  }
+  __atomic_store_n(&rp->sqhead, u->sqhead, __ATOMIC_RELEASE);
+  if(n > 0)
+    wakeupn(&u->ptail, n);
+
+  while(cqused(u) < minwait && u->inflight > 0 && !p->killed)
+    sleep(&u->cqtail, &u->lock);
+  release(&u->lock);
+  return n;
+}
+
+// exit() or exec(), once killthreads() has ended the kernel
+// threads: free g's queues. The page goes with the last
+// mapping of it.
+void
+uringfree(struct proc *g)
+{
+  struct uring *u = g->uring;
+
+  if(u == 0)
+    return;
+  g->uring = 0;
+  kfree(u->rp);
+  kfree(u);
+}
@@ -0,0 +1,48 @@
+// Submission and completion queues (uring.c), in a page that
+// uring_setup() maps into the process.
+// Both the kernel and user programs use this header file.
+
+#define URINGSIZE    64   // entries in each queue, a power of two
+#define URINGWORKERS 4    // kernel threads per process, at most
+
+// operations
+#define UR_NOP    0
+#define UR_READ   1       // read(fd, addr, len), at off
+#define UR_WRITE  2       // write(fd, addr, len), at off
+#define UR_FSYNC  3       // fd's writes are on disk
+#define UR_OPEN   4       // open(addr, len)
+
+#define UR_CUROFF ((uint64)-1)  // off: the file's offset, as read()
+
+// a submission.
+struct usqe {
+  int op;
+  int fd;
+  uint64 addr;
+  uint64 off;
+  uint len;
+  uint pad;
+  uint64 data;    // anything, handed back in the completion
+};
+
+// a completion.
+struct ucqe {
+  uint64 data;    // the submission's
+  int res;        // what the system call would have returned
+  uint pad;
+};
+
+// The program fills sq[sqtail % URINGSIZE] and advances
+// sqtail; uring_enter() takes entries up to sqtail and
+// advances sqhead. The kernel fills cq[cqtail % URINGSIZE]
+// and advances cqtail; the program takes completions and
+// advances cqhead. Submissions don't complete in order.
+struct uringpage {
+  uint sqhead;    // written by the kernel
+  uint sqtail;    // written by the program
+  uint cqhead;    // written by the program
+  uint cqtail;    // written by the kernel
+  uint pad[12];
+  struct usqe sq[URINGSIZE];
+  struct ucqe cq[URINGSIZE];
+};
@@ -0,0 +1,21 @@
+// Pages the kernel maps read-only into every process,
+// so that user programs can read these values with plain
+// loads instead of system calls.
+// Both the kernel and user programs use this header file.
+
+// At USYSCALL; one page per process.
+struct usyscall {
+  int pid;             // Same as getpid()
+};
+
+// At USHARED; a single page shared by all processes,
+// updated by the kernel.
+struct ushared {
+  uint ticks;          // Same as uptime()
+  uint hwcap;          // HWCAP_ bits
+  uint64 mtimefreq;    // CLINT_MTIME ticks per second
+  uint ncpu;           // Harts running
+};
+
+#define HWCAP_FP 1     // F and D registers
+#define HWCAP_V  2     // Vector extension
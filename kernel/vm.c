@@ -3,18 +3,28 @@
 #include "memlayout.h"
 #include "elf.h"
 #include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
 #include "defs.h"
 #include "fs.h"
+#include "fcntl.h"
 // 管理页表和地址空间
 /*
  * the kernel's page table.
  */
 pagetable_t kernel_pagetable;
 
+// number of ASIDs the harts implement; see kvminithart().
+static uint64 nasid;
+
 extern char etext[];  // kernel.ld sets this to end of kernel code.
 
 extern char trampoline[]; // trampoline.S
 
+extern struct proc proc[NPROC]; // tlbshootdown() looks for threads
+
+static pte_t *walklevel(pagetable_t, uint64, int, int*);
+
 /*
  * create a direct-map page table for the kernel.
  */
@@ -36,15 +46,54 @@ kvminit()
   // PLIC
   kvmmap(PLIC, PLIC, 0x400000, PTE_R | PTE_W);
 
+  // the rest is global, so its TLB entries serve every
+  // process's kernel page table. no user page table maps
+  // these addresses (user memory can't reach KERNBASE), or
+  // maps them differently (the trampoline).
+
   // map kernel text executable and read-only.
-  kvmmap(KERNBASE, KERNBASE, (uint64)etext-KERNBASE, PTE_R | PTE_X);
+  kvmmap(KERNBASE, KERNBASE, (uint64)etext-KERNBASE, PTE_R | PTE_X | PTE_G);
 
   // map kernel data and the physical RAM we'll make use of.
-  kvmmap((uint64)etext, (uint64)etext, PHYSTOP-(uint64)etext, PTE_R | PTE_W);
+  kvmmap((uint64)etext, (uint64)etext, PHYSTOP-(uint64)etext, PTE_R | PTE_W | PTE_G);
 
   // map the trampoline for trap entry/exit to
   // the highest virtual address in the kernel.
-  kvmmap(TRAMPOLINE, (uint64)trampoline, PGSIZE, PTE_R | PTE_X);
+  kvmmap(TRAMPOLINE, (uint64)trampoline, PGSIZE, PTE_R | PTE_X | PTE_G);
+}
+
+// Create a process's kernel page table: the kernel's own
+// mappings, plus the user memory that user page table upt
+// maps below UKSIZE, at UKBASE. The page-table pages are
+// shared, so only the root page is new, and changes to the
+// user page table show up in both. proc_pagetable() makes
+// sure upt has a level-1 page to share.
+pagetable_t
+kvmcreate(pagetable_t upt)
+{
+  pagetable_t kpt;
+
+  if((kpt = (pagetable_t) kalloc()) == 0)
+    return 0;
+  memmove(kpt, kernel_pagetable, PGSIZE);
+  kpt[PX(2, UKBASE)] = upt[0];
+  return kpt;
+}
+
+// exec() gave kernel page table kpt's process
+// a new user page table upt. the caller flushes
+// the TLB with tlbflushall().
+void
+kvmsetuser(pagetable_t kpt, pagetable_t upt)
+{
+  kpt[PX(2, UKBASE)] = upt[0];
+}
+
+// free a page table made by kvmcreate().
+void
+kvmfree(pagetable_t kpt)
+{
+  kfree((void*)kpt);
 }
 
 // Switch h/w page table register to the kernel's page table,
@@ -52,8 +101,175 @@ kvminit()
 void
 kvminithart()
 {
-  w_satp(MAKE_SATP(kernel_pagetable)); //这里地址转换（页表）就会被启用了，之前还没有虚拟地址，运行这条指令之前，使用物理地址，还没有页表和映射
+  uint64 bits;
+
+  // find out how many ASIDs there are: the ASID bits of satp
+  // that the hart implements keep the ones written to them.
+  w_satp(MAKE_SATP(kernel_pagetable, 0xffff));
+  bits = (r_satp() >> 44) & 0xffff;
+  w_satp(MAKE_SATP(kernel_pagetable, 0)); //这里地址转换（页表）就会被启用了，之前还没有虚拟地址，运行这条指令之前，使用物理地址，还没有页表和映射
   sfence_vma(); // 用于刷新当前CPU的TLB
+  nasid = bits + 1;
+}
+
+// the ASID for the kernel page table of the process in
+// proc[] slot i; its user page table gets the next one.
+// kernel_pagetable has ASID 0. returns 0 if the harts
+// don't have enough ASIDs, in which case every switch of
+// page table flushes the whole TLB, as before.
+int
+kvmasid(int i)
+{
+  if(nasid <= 2*NPROC)
+    return 0;
+  return 1 + 2*i;
+}
+
+// Switch this hart to process p's kernel page table, or with
+// p == 0 back to kernel_pagetable. The caller has interrupts
+// off. Flushes p's TLB entries if they went stale while p
+// ran on another hart.
+void
+kvmswitch(struct proc *p)
+{
+  uint64 bit = 1L << cpuid();
+
+  if(p == 0){
+    w_satp(MAKE_SATP(kernel_pagetable, 0));
+    if(nasid <= 2*NPROC)
+      sfence_vma();
+    return;
+  }
+
+  w_satp(MAKE_SATP(p->kpagetable, p->asid));
+  if(p->asid == 0){
+    sfence_vma();
+  } else {
+    // clear the bit before flushing, so that a flush asked
+    // for while we do it isn't lost.
+    if(__sync_fetch_and_and(&p->tlbstale, ~bit) & bit){
+      sfence_vma_asid(p->asid);
+      sfence_vma_asid(p->uasid);
+    }
+  }
+}
+
+// flush this hart's TLB entries for p's ASIDs if another
+// hart asked it to, with an IPI, while it runs p; see
+// tlbshootdown(). Called with interrupts off.
+void
+tlbcheck(void)
+{
+  struct proc *p = mycpu()->proc;
+  uint64 bit = 1L << cpuid();
+
+  if(p == 0 || p->kpagetable == 0)
+    return;
+  if(__sync_fetch_and_and(&p->tlbstale, ~bit) & bit){
+    if(p->asid == 0){
+      sfence_vma();
+    } else {
+      sfence_vma_asid(p->asid);
+      sfence_vma_asid(p->uasid);
+    }
+  }
+}
+
+// flush this hart's TLB entries for t's ASIDs: all of them,
+// or only those for [va, va+npages*PGSIZE) if npages > 0.
+static void
+tlbflushlocal(struct proc *t, uint64 va, uint64 npages)
+{
+  uint64 a;
+
+  if(t->asid == 0){
+    sfence_vma();
+  } else if(npages == 0){
+    sfence_vma_asid(t->asid);
+    sfence_vma_asid(t->uasid);
+  } else {
+    for(a = va; a < va + npages*PGSIZE; a += PGSIZE){
+      sfence_vma_page(a, t->uasid);
+      if(a < UKSIZE)
+        sfence_vma_page(UKBASE + a, t->asid);
+    }
+  }
+}
+
+// The threads of a process (clone()) share its user page
+// table but each has its own ASIDs, so a change to it must
+// reach the TLB entries of all of them: flush this hart's,
+// make every other hart flush before it next runs one of
+// them, and send an IPI to the harts running one now. Wait
+// for those to flush, so that the caller can free the pages
+// it unmapped, unless this hart holds a spinlock: one of
+// them might be spinning on it with interrupts off.
+static void
+tlbshootdown(struct proc *p, uint64 va, uint64 npages)
+{
+  struct proc *g = p->leader, *t;
+  struct cpu *c;
+  uint64 bit;
+  int wait, again;
+
+  push_off();
+  bit = 1L << cpuid();
+  wait = mycpu()->noff == 1;
+  if(g->nthreads == 0){
+    // no other threads, the common case.
+    tlbflushlocal(p, va, npages);
+    __atomic_store_n(&p->tlbstale, ~bit, __ATOMIC_SEQ_CST);
+    pop_off();
+    return;
+  }
+
+  for(t = proc; t < &proc[NPROC]; t++){
+    if(t->leader != g || t->kpagetable == 0)
+      continue;
+    tlbflushlocal(t, va, npages);
+    __atomic_store_n(&t->tlbstale, ~bit, __ATOMIC_SEQ_CST);
+  }
+  for(c = cpus; c < &cpus[NCPU]; c++){
+    t = c->proc;
+    if(c != mycpu() && t && t->leader == g)
+      ipi(c - cpus);
+  }
+  while(wait){
+    again = 0;
+    for(c = cpus; c < &cpus[NCPU]; c++){
+      t = c->proc;
+      if(c != mycpu() && t && t->leader == g &&
+         (__atomic_load_n(&t->tlbstale, __ATOMIC_SEQ_CST) & (1L << (c - cpus))))
+        again = 1;
+    }
+    if(!again)
+      break;
+    // another hart may be waiting for us in the same way.
+    tlbcheck();
+  }
+  pop_off();
+}
+
+// Process p, running on this hart, changed its page table.
+// Flush the TLB entries for p's ASIDs, here and, for its
+// threads, on the other harts (tlbshootdown()).
+void
+tlbflushall(struct proc *p)
+{
+  tlbshootdown(p, 0, 0);
+}
+
+// Like tlbflushall(), but harts only flush the entries
+// for user pages [va, va+npages*PGSIZE), as the user page
+// table and, below UKSIZE, at UKBASE in the kernel's.
+void
+tlbflushrange(struct proc *p, uint64 va, uint64 npages)
+{
+  if(npages == 0)
+    return;
+  if(p->asid == 0 || npages > TLBFLUSHMAX)
+    npages = 0;
+  tlbshootdown(p, va, npages);
 }
 
 // Return the address of the PTE in page table pagetable
@@ -68,18 +284,36 @@ kvminithart()
 //   21..29 -- 9 bits of level-1 index.
 //   12..20 -- 9 bits of level-0 index.
 //    0..11 -- 12 bits of byte offset within the page.
+//
+// If va is in a superpage, returns the level-1 leaf PTE
+// that maps the whole superpage.
 // 为虚拟地址找到PTE,如果没有再初始化PTE以保存相关的物理页号、所需权限（PTE_W、PTE_X和/或PTE_R）以及用于标记PTE有效的PTE_V
 // 依赖于直接映射到内核虚拟地址空间中的物理内存 
 pte_t *
 walk(pagetable_t pagetable, uint64 va, int alloc)
+{
+  int level = 0;
+
+  return walklevel(pagetable, va, alloc, &level);
+}
+
+// walk() down to the PTE for va at level *level: 0 for a
+// page, 1 for a superpage. If it meets a leaf on the way,
+// returns that PTE instead and sets *level to its level.
+static pte_t *
+walklevel(pagetable_t pagetable, uint64 va, int alloc, int *level)
 {
   if(va >= MAXVA)
     panic("walk");
   // 高9位是在根页表中找到对应的pte, 找到后就切换到level1页表继续根据中9位来查找level0的页表
   // 这个过程中，页表在不断变化，但是va是不变的，也就是... 9 9 9 12 一直是不变的
-  for(int level = 2; level > 0; level--) {
-    pte_t *pte = &pagetable[PX(level, va)]; // 指向下一个地址
+  for(int l = 2; l > *level; l--) {
+    pte_t *pte = &pagetable[PX(l, va)]; // 指向下一个地址
     if(*pte & PTE_V) {
+      if(PTE_LEAF(*pte)){
+        *level = l;
+        return pte;
+      }
       pagetable = (pagetable_t)PTE2PA(*pte); // 切换到下一级页表
     } else {
       if(!alloc || (pagetable = (pde_t*)kalloc()) == 0)
@@ -88,7 +322,44 @@ walk(pagetable_t pagetable, uint64 va, int alloc)
       *pte = PA2PTE(pagetable) | PTE_V;
     }
   }
-  return &pagetable[PX(0, va)]; //返回level0页表中对应va低9位的pte的物理地址
+  return &pagetable[PX(*level, va)]; //返回level0页表中对应va低9位的pte的物理地址
+}
+
+// Replace superpage leaf *pte with a level-0 page-table page
+// mapping the same memory with the same permissions, one
+// page at a time, so that part of it can be unmapped.
+// Returns 0, or -1 if out of memory.
+static int
+superdemote(pte_t *pte)
+{
+  pagetable_t pt;
+  uint64 pa = PTE2PA(*pte);
+  int i, flags = PTE_FLAGS(*pte);
+
+  if((pt = (pagetable_t)kalloc()) == 0)
+    return -1;
+  for(i = 0; i < 512; i++)
+    pt[i] = PA2PTE(pa + i*PGSIZE) | flags;
+  *pte = PA2PTE(pt) | PTE_V;
+  return 0;
+}
+
+// If va falls inside a superpage, rather than at its start,
+// split that superpage into pages, so that a range that starts
+// or ends at va can be unmapped. It maps the same memory as
+// before, so no TLB flush is needed.
+// Returns 0, or -1 if out of memory.
+int
+uvmsplit(pagetable_t pagetable, uint64 va)
+{
+  pte_t *pte;
+  int level = 0;
+
+  if(va % SUPERPGSIZE == 0 || va >= MAXVA)
+    return 0;
+  if((pte = walklevel(pagetable, va, 0, &level)) == 0 || level != 1)
+    return 0;
+  return superdemote(pte);
 }
 
 // Look up a virtual address, return the physical address,
@@ -99,11 +370,12 @@ walkaddr(pagetable_t pagetable, uint64 va)
 {
   pte_t *pte;
   uint64 pa;
+  int level = 0;
 
   if(va >= MAXVA)
     return 0;
 
-  pte = walk(pagetable, va, 0);
+  pte = walklevel(pagetable, va, 0, &level);
   if(pte == 0)
     return 0;
   if((*pte & PTE_V) == 0)
@@ -111,6 +383,8 @@ walkaddr(pagetable_t pagetable, uint64 va)
   if((*pte & PTE_U) == 0)
     return 0;
   pa = PTE2PA(*pte);
+  if(level == 1)
+    pa += PGROUNDDOWN(va % SUPERPGSIZE); // the page within the superpage
   return pa;
 }
 
@@ -135,13 +409,16 @@ kvmpa(uint64 va)
   uint64 off = va % PGSIZE;
   pte_t *pte;
   uint64 pa;
+  int level = 0;
   
-  pte = walk(kernel_pagetable, va, 0);
+  pte = walklevel(kernel_pagetable, va, 0, &level);
   if(pte == 0)
     panic("kvmpa");
   if((*pte & PTE_V) == 0)
     panic("kvmpa");
   pa = PTE2PA(*pte);
+  if(level == 1)
+    off = va % SUPERPGSIZE;
   return pa+off;
 }
 
@@ -149,6 +426,8 @@ kvmpa(uint64 va)
 // physical addresses starting at pa. va and size might not
 // be page-aligned. Returns 0 on success, -1 if walk() couldn't
 // allocate a needed page-table page.
+// Uses a superpage for each 2 MB that va and pa are both
+// aligned to, if nothing in it is mapped yet.
 //为新映射装载PTE,将范围虚拟地址到同等范围物理地址的映射装载到一个页表中。它以页面大小为间隔，为范围内的每个虚拟地址单独执行此操作
 int
 mappages(pagetable_t pagetable, uint64 va, uint64 size, uint64 pa, int perm)
@@ -159,6 +438,20 @@ mappages(pagetable_t pagetable, uint64 va, uint64 size, uint64 pa, int perm)
   a = PGROUNDDOWN(va);
   last = PGROUNDDOWN(va + size - 1);
   for(;;){
+    if(a % SUPERPGSIZE == 0 && pa % SUPERPGSIZE == 0 &&
+       last - a >= SUPERPGSIZE - PGSIZE){
+      int level = 1;
+      if((pte = walklevel(pagetable, a, 1, &level)) == 0)
+        return -1;
+      if(*pte == 0){
+        *pte = PA2PTE(pa) | perm | PTE_V;
+        if(last - a == SUPERPGSIZE - PGSIZE)
+          break;
+        a += SUPERPGSIZE;
+        pa += SUPERPGSIZE;
+        continue;
+      }
+    }
     if((pte = walk(pagetable, a, 1)) == 0)
       return -1;
     if(*pte & PTE_V)
@@ -172,31 +465,85 @@ mappages(pagetable_t pagetable, uint64 va, uint64 size, uint64 pa, int perm)
   return 0;
 }
 
+#define UNMAPBATCH 32
+
+// free the pages uvmunmap() collected.
+static void
+unmapfree(uint64 *batch, int n)
+{
+  int i;
+
+  for(i = 0; i < n; i++){
+    if(batch[i] & 1)
+      superfree((void*)(batch[i] & ~1L));
+    else
+      kfree((void*)batch[i]);
+  }
+}
+
 // Remove npages of mappings starting from va. va must be
 // page-aligned. The mappings must exist.
 // Optionally free the physical memory. 解除va的映射，使用walk来查找对应的PTE，do_free是1的话使用kfree来释放PTE引用的物理内存。
 void
 uvmunmap(pagetable_t pagetable, uint64 va, uint64 npages, int do_free)
 {
-  uint64 a;
+  uint64 a, end, from;
   pte_t *pte;
+  struct proc *p = myproc();
+  int level, n = 0;
+  // pages to free once no TLB has them, with bit 0 set
+  // for a superpage.
+  uint64 batch[UNMAPBATCH];
+
+  // the TLBs may still hold the running process's old
+  // mappings, on this hart and, for a process with
+  // threads, on others too: flush them before the pages
+  // are freed. other page tables are not in use (exec()
+  // and allocproc() take care of their ASIDs).
+  int flush = p != 0 && pagetable == p->pagetable;
 
   if((va % PGSIZE) != 0)
     panic("uvmunmap: not aligned");
 
-  for(a = va; a < va + npages*PGSIZE; a += PGSIZE){
-    if((pte = walk(pagetable, a, 0)) == 0)
+  end = va + npages*PGSIZE;
+  from = va;
+  for(a = va; a < end; a += PGSIZE){
+    level = 0;
+    if((pte = walklevel(pagetable, a, 0, &level)) == 0)
       panic("uvmunmap: walk");
     if((*pte & PTE_V) == 0)
       panic("uvmunmap: not mapped");
     if(PTE_FLAGS(*pte) == PTE_V)
       panic("uvmunmap: not a leaf");
-    if(do_free){
-      uint64 pa = PTE2PA(*pte);
-      kfree((void*)pa);
+    if(level == 1){
+      if(a % SUPERPGSIZE == 0 && end - a >= SUPERPGSIZE){
+        // the whole superpage.
+        if(do_free)
+          batch[n++] = PTE2PA(*pte) | 1;
+        *pte = 0;
+        a += SUPERPGSIZE - PGSIZE;
+      } else {
+        // callers uvmsplit() the ends of the range first.
+        panic("uvmunmap: part of a superpage");
+      }
+    }
+    if(level == 0){
+      if(do_free)
+        batch[n++] = PTE2PA(*pte);
+      *pte = 0;
+    }
+    if(n == UNMAPBATCH || (n > 0 && !flush)){
+      if(flush)
+        tlbflushrange(p, from, (a + PGSIZE - from) / PGSIZE);
+      from = a + PGSIZE;
+      unmapfree(batch, n);
+      n = 0;
     }
-    *pte = 0;
   }
+
+  if(flush)
+    tlbflushrange(p, from, (end - from) / PGSIZE);
+  unmapfree(batch, n);
 }
 
 // create an empty user page table.
@@ -234,21 +581,30 @@ uint64
 uvmalloc(pagetable_t pagetable, uint64 oldsz, uint64 newsz)
 {
   char *mem;
-  uint64 a;
+  uint64 a, sz;
 
   if(newsz < oldsz)
     return oldsz;
 
   oldsz = PGROUNDUP(oldsz);
-  for(a = oldsz; a < newsz; a += PGSIZE){
-    mem = kalloc();
+  for(a = oldsz; a < newsz; a += sz){
+    // a superpage for each aligned 2 MB, while there are any.
+    mem = 0;
+    sz = SUPERPGSIZE;
+    if(a % SUPERPGSIZE != 0 || newsz - a < SUPERPGSIZE || (mem = superalloc()) == 0){
+      sz = PGSIZE;
+      mem = kalloc();
+    }
     if(mem == 0){
       uvmdealloc(pagetable, a, oldsz);
       return 0;
     }
-    memset(mem, 0, PGSIZE);
-    if(mappages(pagetable, a, PGSIZE, (uint64)mem, PTE_W|PTE_X|PTE_R|PTE_U) != 0){
-      kfree(mem);
+    memset(mem, 0, sz);
+    if(mappages(pagetable, a, sz, (uint64)mem, PTE_W|PTE_X|PTE_R|PTE_U) != 0){
+      if(sz == SUPERPGSIZE)
+        superfree(mem);
+      else
+        kfree(mem);
       uvmdealloc(pagetable, a, oldsz);
       return 0;
     }
@@ -259,7 +615,8 @@ uvmalloc(pagetable_t pagetable, uint64 oldsz, uint64 newsz)
 // Deallocate user pages to bring the process size from oldsz to
 // newsz.  oldsz and newsz need not be page-aligned, nor does newsz
 // need to be less than oldsz.  oldsz can be larger than the actual
-// process size.  Returns the new process size. 也是解除虚拟内存和物理内存映射，调用uvmunmap
+// process size.  Returns the new process size, or oldsz if out of
+// memory to split a superpage. 也是解除虚拟内存和物理内存映射，调用uvmunmap
 uint64
 uvmdealloc(pagetable_t pagetable, uint64 oldsz, uint64 newsz)
 {
@@ -267,6 +624,9 @@ uvmdealloc(pagetable_t pagetable, uint64 oldsz, uint64 newsz)
     return oldsz;
 
   if(PGROUNDUP(newsz) < PGROUNDUP(oldsz)){
+    if(uvmsplit(pagetable, PGROUNDUP(newsz)) < 0 ||
+       uvmsplit(pagetable, PGROUNDUP(oldsz)) < 0)
+      return oldsz;
     int npages = (PGROUNDUP(oldsz) - PGROUNDUP(newsz)) / PGSIZE;
     uvmunmap(pagetable, PGROUNDUP(newsz), npages, 1);
   }
@@ -314,22 +674,37 @@ int
 uvmcopy(pagetable_t old, pagetable_t new, uint64 sz)
 {
   pte_t *pte;
-  uint64 pa, i;
+  uint64 pa, i, n;
   uint flags;
   char *mem;
+  int level;
 
-  for(i = 0; i < sz; i += PGSIZE){
-    if((pte = walk(old, i, 0)) == 0)
+  for(i = 0; i < sz; i += n){
+    level = 0;
+    if((pte = walklevel(old, i, 0, &level)) == 0)
       panic("uvmcopy: pte should exist");
     if((*pte & PTE_V) == 0)
       panic("uvmcopy: page not present");
     pa = PTE2PA(*pte);
     flags = PTE_FLAGS(*pte);
-    if((mem = kalloc()) == 0)
+    n = PGSIZE;
+    mem = 0;
+    if(level == 1){
+      // a superpage: copy it to one, if there are any
+      // left, or else page by page.
+      if(i % SUPERPGSIZE == 0 && (mem = superalloc()) != 0)
+        n = SUPERPGSIZE;
+      else
+        pa += i % SUPERPGSIZE;
+    }
+    if(mem == 0 && (mem = kalloc()) == 0)
       goto err;
-    memmove(mem, (char*)pa, PGSIZE);
-    if(mappages(new, i, PGSIZE, (uint64)mem, flags) != 0){
-      kfree(mem);
+    memmove(mem, (char*)pa, n);
+    if(mappages(new, i, n, (uint64)mem, flags) != 0){
+      if(n == SUPERPGSIZE)
+        superfree(mem);
+      else
+        kfree(mem);
       goto err;
     }
   }
@@ -342,15 +717,19 @@ uvmcopy(pagetable_t old, pagetable_t new, uint64 sz)
 
 // mark a PTE invalid for user access.
 // used by exec for the user stack guard page.
-void
+// Returns 0, or -1 if out of memory.
+int
 uvmclear(pagetable_t pagetable, uint64 va)
 {
   pte_t *pte;
-  
+
+  if(uvmsplit(pagetable, va) < 0 || uvmsplit(pagetable, va + PGSIZE) < 0)
+    return -1;
   pte = walk(pagetable, va, 0);
   if(pte == 0)
     panic("uvmclear");
   *pte &= ~PTE_U;
+  return 0;
 }
 
 // Copy from kernel to user.
@@ -360,6 +739,11 @@ int
 copyout(pagetable_t pagetable, uint64 dstva, char *src, uint64 len)
 {
   uint64 n, va0, pa0;
+
+  if(vmatouch(pagetable, dstva, len, PROT_WRITE) < 0)
+    return -1;
+  if(ucopyok(pagetable, dstva, len))
+    return copyout_new(dstva, src, len);
   // 把内核中连续的src拷贝到连续的dstva，但是真正可以拷贝的都是物理内存，这些是不连续的，所以需要这么做
   while(len > 0){
     va0 = PGROUNDDOWN(dstva);
@@ -385,6 +769,11 @@ int
 copyin(pagetable_t pagetable, char *dst, uint64 srcva, uint64 len)
 {
   uint64 n, va0, pa0;
+
+  if(vmatouch(pagetable, srcva, len, PROT_READ) < 0)
+    return -1;
+  if(ucopyok(pagetable, srcva, len))
+    return copyin_new(dst, srcva, len);
   // 因为在用户空间中的srcva是虚拟地址，真正的内容也就是物理地址是不连续的，所以想要拷贝进内核的dst的连续地址中，只能一页页的拷贝，虚拟->物理然后memove
   while(len > 0){ 
     va0 = PGROUNDDOWN(srcva);
@@ -411,10 +800,29 @@ int
 copyinstr(pagetable_t pagetable, char *dst, uint64 srcva, uint64 max)
 {
   uint64 n, va0, pa0;
-  int got_null = 0;
+  int r, got_null = 0;
+
+  // fault in a page at a time, just before it's read, so as
+  // not to touch the pages after the 0. failures to fault in
+  // are left to the copy itself.
+  if(ucopyok(pagetable, srcva, 1)){
+    while(max > 0){
+      n = PGROUNDDOWN(srcva) + PGSIZE - srcva;
+      if(n > max)
+        n = max;
+      vmatouch(pagetable, srcva, n, PROT_READ);
+      if((r = copyinstr_new(dst, srcva, n)) <= 0)
+        return r;
+      dst += n;
+      srcva += n;
+      max -= n;
+    }
+    return -1;
+  }
 
   while(got_null == 0 && max > 0){
     va0 = PGROUNDDOWN(srcva);
+    vmatouch(pagetable, va0, PGSIZE, PROT_READ);
     pa0 = walkaddr(pagetable, va0); // 在软件中遍历页表，以确定srcva的物理地址pa0
     if(pa0 == 0)
       return -1;
@@ -0,0 +1,523 @@
+//
+// mmap() and munmap(): regions of user memory backed by a
+// file, or by zeroed memory, described by the process's
+// p->leader->vmas[]. Pages are faulted in when first touched
+// (vmatrap()). MAP_SHARED file mappings map the page cache's
+// pages themselves (pcache.c), so every such mapping and
+// read()/write() see the same bytes; the pages that were
+// written go back to the file at munmap(), exit() and exec().
+// MAP_PRIVATE mappings get copies. MAP_SHARED anonymous
+// mappings, and mappings of memfd() files, map the pages of
+// a shared memory object (shm.c), which fork() shares too.
+//
+// Regions are placed from MMAPTOP down, inside the part of
+// user memory that copyin() and copyout() reach directly.
+//
+// The threads of a process change its regions and page table
+// under vmlock(): mmap() and munmap() are called with it
+// held, and vmafault() takes it, but only after reading the
+// file, since ilock() comes before vmlock().
+//
+// A fault may sleep, so copyin() and copyout() can't fault a
+// page in while their caller holds a spinlock, or an inode's
+// lock, which the fault might need itself. System calls that
+// copy with such a lock held fault the user's buffer in first
+// (vmatouch()); a page unmapped meanwhile makes the copy fail.
+//
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+#include "fcntl.h"
+#include "pcache.h"
+#include "shm.h"
+#include "defs.h"
+
+// does region v map pages of a shared memory object?
+#define SHM(v) ((v)->f && (v)->f->type == FD_SHM)
+
+// does region v map pages of the page cache?
+#define CACHED(v) ((v)->f && ((v)->flags & MAP_SHARED) && !SHM(v))
+
+// the region of p containing va, or 0.
+static struct vma*
+vmafind(struct proc *p, uint64 va)
+{
+  struct vma *v;
+
+  for(v = p->leader->vmas; v < &p->leader->vmas[NVMA]; v++)
+    if(v->len && va >= v->addr && va < v->addr + v->len)
+      return v;
+  return 0;
+}
+
+// the page of the file that page a of region v maps.
+static uint
+vmapgno(struct vma *v, uint64 a)
+{
+  return (v->off + (a - v->addr)) / PGSIZE;
+}
+
+// the lowest address used by a region, which the
+// heap must stay below.
+uint64
+vmalow(struct proc *p)
+{
+  struct vma *v;
+  uint64 low = MMAPTOP;
+
+  for(v = p->leader->vmas; v < &p->leader->vmas[NVMA]; v++)
+    if(v->len && v->addr < low)
+      low = v->addr;
+  return low;
+}
+
+// if page a of shared region v is dirty, write it back to
+// the file, but not past the end of the file.
+static void
+vmawriteback(struct vma *v, uint64 a, pte_t pte)
+{
+  struct inode *ip = v->f->ip;
+  uint off = v->off + (a - v->addr);
+  char *pa = (char*)PTE2PA(pte);
+  // at most what one log transaction can hold, as filewrite().
+  int max = ((MAXOPBLOCKS-1-1-2) / 2) * BSIZE;
+  int i, n;
+
+  if((v->flags & MAP_SHARED) == 0 || (pte & PTE_D) == 0)
+    return;
+
+  for(i = 0; i < PGSIZE; i += n){
+    n = PGSIZE - i;
+    if(n > max)
+      n = max;
+    begin_op();
+    ilock(ip);
+    if(off + i >= ip->size){
+      iunlock(ip);
+      end_op();
+      break;
+    }
+    if(off + i + n > ip->size)
+      n = ip->size - (off + i);
+    writei(ip, 0, (uint64)pa + i, off + i, n);
+    iunlock(ip);
+    end_op();
+  }
+}
+
+// unmap page a of region v, which pte maps, from pagetable.
+// kfree() only drops a reference to a shared memory page.
+static void
+vmaunmappage(pagetable_t pagetable, struct vma *v, uint64 a, pte_t pte)
+{
+  if(CACHED(v)){
+    uvmunmap(pagetable, a, 1, 0);
+    pcunmap(v->f->ip, vmapgno(v, a), (char*)PTE2PA(pte));
+  } else
+    uvmunmap(pagetable, a, 1, 1);
+}
+
+// unmap the pages of [start, end) of region v that have
+// been faulted in, writing back the dirty shared ones.
+static void
+vmaunmap(struct proc *p, struct vma *v, uint64 start, uint64 end)
+{
+  uint64 a;
+  pte_t *pte;
+
+  for(a = start; a < end; a += PGSIZE){
+    if((pte = walk(p->pagetable, a, 0)) == 0 || (*pte & PTE_V) == 0)
+      continue;
+    if(CACHED(v))
+      vmawriteback(v, a, *pte);
+    vmaunmappage(p->pagetable, v, a, *pte);
+  }
+}
+
+// Map len bytes of f from offset off, or zeroed memory if
+// flags has MAP_ANONYMOUS, into the current process; zeroed
+// memory that is MAP_SHARED gets a shared memory object.
+// addr is only a hint, and is ignored.
+// Returns the address, or -1.
+uint64
+mmap(uint64 addr, uint64 len, int prot, int flags, struct file *f, uint64 off)
+{
+  struct proc *p = myproc();
+  struct vma *v, *free = 0;
+  uint64 top;
+
+  if(len == 0 || len > MMAPTOP || off % PGSIZE != 0)
+    return -1;
+  if(((flags & MAP_SHARED) != 0) == ((flags & MAP_PRIVATE) != 0))
+    return -1;
+  if(flags & MAP_ANONYMOUS){
+    f = 0;
+    off = 0;
+  } else {
+    if(f == 0 || (f->type != FD_INODE && f->type != FD_SHM) || !f->readable)
+      return -1;
+    // no copies of shared memory.
+    if(f->type == FD_SHM && (flags & MAP_PRIVATE))
+      return -1;
+    // a shared writable mapping writes to the file.
+    if((flags & MAP_SHARED) && (prot & PROT_WRITE) && !f->writable)
+      return -1;
+  }
+  len = PGROUNDUP(len);
+
+  for(v = p->leader->vmas; v < &p->leader->vmas[NVMA]; v++)
+    if(v->len == 0){
+      free = v;
+      break;
+    }
+  if(free == 0)
+    return -1;
+
+  // the highest gap that fits.
+  top = MMAPTOP;
+ again:
+  for(v = p->leader->vmas; v < &p->leader->vmas[NVMA]; v++){
+    if(v->len && v->addr < top && v->addr + v->len > top - len){
+      top = v->addr;
+      if(top < len)
+        return -1;
+      goto again;
+    }
+  }
+  if(top - len < PGROUNDUP(p->leader->sz))
+    return -1;
+
+  if((flags & (MAP_ANONYMOUS|MAP_SHARED)) == (MAP_ANONYMOUS|MAP_SHARED)){
+    // a file of its own, which the region holds.
+    if((f = filealloc()) == 0)
+      return -1;
+    if((f->shm = shmalloc(len)) == 0){
+      fileclose(f);
+      return -1;
+    }
+    f->type = FD_SHM;
+    f->readable = 1;
+    f->writable = 1;
+  } else if(f)
+    filedup(f);
+
+  v = free;
+  v->addr = top - len;
+  v->len = len;
+  v->prot = prot;
+  v->flags = flags;
+  v->f = f;
+  v->off = off;
+  return v->addr;
+}
+
+// Unmap [addr, addr+len) of the current process's regions.
+// Returns 0, or -1 if addr isn't page-aligned, or a region
+// would have to be split in two and there is no free slot.
+int
+munmap(uint64 addr, uint64 len)
+{
+  struct proc *p = myproc();
+  struct vma *v, *nv;
+  uint64 start, end, vend;
+
+  if(addr % PGSIZE != 0 || len == 0 || addr + len < addr)
+    return -1;
+  end = PGROUNDUP(addr + len);
+
+  for(v = p->leader->vmas; v < &p->leader->vmas[NVMA]; v++){
+    if(v->len == 0)
+      continue;
+    vend = v->addr + v->len;
+    start = addr > v->addr ? addr : v->addr;
+    if(start >= (end < vend ? end : vend))
+      continue;
+
+    if(start > v->addr && end < vend){
+      // a hole in the middle: the top part needs a slot.
+      for(nv = p->leader->vmas; nv < &p->leader->vmas[NVMA]; nv++)
+        if(nv->len == 0)
+          break;
+      if(nv == &p->leader->vmas[NVMA])
+        return -1;
+      vmaunmap(p, v, start, end);
+      *nv = *v;
+      nv->addr = end;
+      nv->len = vend - end;
+      nv->off += end - v->addr;
+      if(nv->f)
+        filedup(nv->f);
+      v->len = start - v->addr;
+    } else if(start > v->addr){
+      // the top part.
+      vmaunmap(p, v, start, vend);
+      v->len = start - v->addr;
+    } else if(end < vend){
+      // the bottom part.
+      vmaunmap(p, v, v->addr, end);
+      v->off += end - v->addr;
+      v->len = vend - end;
+      v->addr = end;
+    } else {
+      // all of it.
+      vmaunmap(p, v, v->addr, vend);
+      if(v->f)
+        fileclose(v->f);
+      v->f = 0;
+      v->len = 0;
+    }
+  }
+  return 0;
+}
+
+// Fault in the page of the current process's region that
+// holds va, for access (PROT_READ, PROT_WRITE or PROT_EXEC).
+// A page of a shared writable file region is mapped
+// read-only until written, so that it is known to be dirty.
+// Returns 0, or -1 if va is in no region, the region
+// doesn't allow access, or out of memory.
+int
+vmafault(struct proc *p, uint64 va, int access)
+{
+  struct vma *v;
+  struct file *f = 0;
+  struct inode *ip;
+  struct page *pg = 0;
+  pte_t *pte;
+  char *mem;
+  uint64 a = PGROUNDDOWN(va), off = 0;
+  int perm, n, cached = 0;
+
+  // not with a spinlock held, or a lock the caller said the
+  // fault might need.
+  if(p->nofault || mycpu()->noff > 0)
+    return -1;
+  vmlock(p);
+  if((v = vmafind(p, va)) == 0 || (v->prot & access) == 0){
+    vmunlock(p);
+    return -1;
+  }
+
+  if((pte = walk(p->pagetable, a, 0)) != 0 && (*pte & PTE_V)){
+    if(access == PROT_WRITE && (*pte & PTE_W) == 0){
+      *pte |= PTE_W | PTE_D;
+      tlbflushrange(p, a, 1);
+    }
+    vmunlock(p);
+    return 0;
+  }
+
+  if(SHM(v)){
+    // past the end of the object is not there.
+    if((mem = shmpage(v->f->shm, vmapgno(v, a))) == 0){
+      vmunlock(p);
+      return -1;
+    }
+  } else if(v->f){
+    f = filedup(v->f);
+    cached = CACHED(v);
+    off = v->off + (a - v->addr);
+    vmunlock(p);
+
+    ip = f->ip;
+    ilock(ip);
+    if(cached){
+      // keeps the reference until unmapped.
+      if((pg = pcget(ip, off / PGSIZE)) != 0)
+        mem = pg->data;
+      else
+        mem = 0;
+    } else if((mem = kalloc()) != 0){
+      // past the end of the file stays zero.
+      memset(mem, 0, PGSIZE);
+      n = readi(ip, 0, (uint64)mem, off, PGSIZE);
+      if(n < 0){
+        kfree(mem);
+        mem = 0;
+      }
+    }
+    iunlock(ip);
+    if(mem == 0){
+      fileclose(f);
+      return -1;
+    }
+
+    // another thread may have unmapped the region, or
+    // faulted the page in, meanwhile.
+    vmlock(p);
+    if((v = vmafind(p, va)) == 0 || v->f != f || v->off + (a - v->addr) != off ||
+       ((pte = walk(p->pagetable, a, 0)) != 0 && (*pte & PTE_V))){
+      vmunlock(p);
+      if(pg)
+        pcput(pg);
+      else
+        kfree(mem);
+      fileclose(f);
+      return v ? 0 : -1;
+    }
+  } else {
+    if((mem = kalloc()) == 0){
+      vmunlock(p);
+      return -1;
+    }
+    memset(mem, 0, PGSIZE);
+  }
+
+  // RISC-V has no write-only pages.
+  perm = PTE_U | PTE_A;
+  if(v->prot & (PROT_READ|PROT_WRITE))
+    perm |= PTE_R;
+  if(v->prot & PROT_EXEC)
+    perm |= PTE_X;
+  if((v->prot & PROT_WRITE) &&
+     ((v->flags & MAP_PRIVATE) || SHM(v) || access == PROT_WRITE))
+    perm |= PTE_W | PTE_D;
+  if(mappages(p->pagetable, a, PGSIZE, (uint64)mem, perm) != 0){
+    vmunlock(p);
+    if(pg)
+      pcput(pg);
+    else
+      kfree(mem);
+    if(f)
+      fileclose(f);
+    return -1;
+  }
+  // RISC-V wants an sfence.vma even for a new mapping.
+  tlbflushrange(p, a, 1);
+  vmunlock(p);
+  if(f)
+    fileclose(f);
+  return 0;
+}
+
+// called by usertrap() for a page fault. returns 1 if the
+// fault was in a region and the page is now there.
+int
+vmatrap(struct proc *p, uint64 scause, uint64 va)
+{
+  int access;
+
+  if(scause == 12)
+    access = PROT_EXEC;
+  else if(scause == 13)
+    access = PROT_READ;
+  else if(scause == 15)
+    access = PROT_WRITE;
+  else
+    return 0;
+  return vmafault(p, va, access) == 0;
+}
+
+// copyin() and copyout() are about to touch [va, va+len) of
+// pagetable, or a system call is about to take a lock and
+// then copy: fault in the pages of it that are in regions of
+// the current process. Returns -1 if one of them can't be.
+int
+vmatouch(pagetable_t pagetable, uint64 va, uint64 len, int access)
+{
+  struct proc *p = myproc();
+  struct vma *v;
+  uint64 a, start, end;
+  pte_t *pte;
+
+  if(p == 0 || pagetable != p->pagetable || len == 0)
+    return 0;
+  // without vmlock(): if another thread changes the regions
+  // meanwhile, vmafault() fails for the pages it unmapped.
+  for(v = p->leader->vmas; v < &p->leader->vmas[NVMA]; v++){
+    if(v->len == 0 || va >= v->addr + v->len || va + len <= v->addr)
+      continue;
+    start = va > v->addr ? PGROUNDDOWN(va) : v->addr;
+    end = va + len < v->addr + v->len ? va + len : v->addr + v->len;
+    for(a = start; a < end; a += PGSIZE){
+      pte = walk(pagetable, a, 0);
+      if(pte && (*pte & PTE_V) && (access != PROT_WRITE || (*pte & PTE_W)))
+        continue;
+      if(vmafault(p, a, access) < 0)
+        return -1;
+    }
+  }
+  return 0;
+}
+
+// Give child np a copy of p's regions. The pages p has
+// faulted in are copied, or shared if they are the page
+// cache's or shared memory; np faults in the rest itself.
+// Returns 0, or -1 if out of memory.
+int
+vmafork(struct proc *p, struct proc *np)
+{
+  struct vma *v;
+  uint64 a;
+  pte_t *pte;
+  char *mem;
+
+  for(v = p->leader->vmas; v < &p->leader->vmas[NVMA]; v++){
+    if(v->len == 0)
+      continue;
+    for(a = v->addr; a < v->addr + v->len; a += PGSIZE){
+      if((pte = walk(p->pagetable, a, 0)) == 0 || (*pte & PTE_V) == 0)
+        continue;
+      if(CACHED(v)){
+        if(mappages(np->pagetable, a, PGSIZE, PTE2PA(*pte), PTE_FLAGS(*pte)) != 0)
+          goto bad;
+        pcdup(v->f->ip, vmapgno(v, a), (char*)PTE2PA(*pte));
+        continue;
+      }
+      if(SHM(v)){
+        if(mappages(np->pagetable, a, PGSIZE, PTE2PA(*pte), PTE_FLAGS(*pte)) != 0)
+          goto bad;
+        kref((char*)PTE2PA(*pte));
+        continue;
+      }
+      if((mem = kalloc()) == 0)
+        goto bad;
+      memmove(mem, (char*)PTE2PA(*pte), PGSIZE);
+      if(mappages(np->pagetable, a, PGSIZE, (uint64)mem, PTE_FLAGS(*pte)) != 0){
+        kfree(mem);
+        goto bad;
+      }
+    }
+  }
+
+  for(v = p->leader->vmas; v < &p->leader->vmas[NVMA]; v++){
+    np->leader->vmas[v - p->leader->vmas] = *v;
+    if(v->len && v->f)
+      filedup(v->f);
+  }
+  return 0;
+
+ bad:
+  for(v = p->leader->vmas; v < &p->leader->vmas[NVMA]; v++){
+    if(v->len == 0)
+      continue;
+    for(a = v->addr; a < v->addr + v->len; a += PGSIZE)
+      if((pte = walk(np->pagetable, a, 0)) != 0 && (*pte & PTE_V))
+        vmaunmappage(np->pagetable, v, a, *pte);
+  }
+  return -1;
+}
+
+// exit() or exec(): unmap all of p's regions.
+void
+vmaexit(struct proc *p)
+{
+  struct vma *v;
+
+  for(v = p->leader->vmas; v < &p->leader->vmas[NVMA]; v++){
+    if(v->len == 0)
+      continue;
+    vmaunmap(p, v, v->addr, v->addr + v->len);
+    if(v->f)
+      fileclose(v->f);
+    v->f = 0;
+    v->len = 0;
+  }
+}
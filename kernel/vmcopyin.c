@@ -0,0 +1,86 @@
+//
+// copyin()/copyout()/copyinstr() fast path.
+// Each process's kernel page table (p->kpagetable, which
+// the scheduler installs while it runs) shares the level-1
+// page-table page that maps the first UKSIZE bytes of its
+// user memory, at UKBASE. So the kernel can copy to and
+// from user memory with plain loads and stores, with
+// sstatus.SUM set, instead of walking the page table for
+// every page. The copies are in ucopy.S; a bad user address
+// faults there and the copy returns -1.
+//
+
+#include "param.h"
+#include "types.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "defs.h"
+
+// in ucopy.S.
+int ucopy(char*, const char*, uint64);
+int ucopystr(char*, const char*, uint64);
+extern char ucopystart[], ucopyend[], ucopyfault[];
+
+// Can the fast path reach [va, va+len) of pagetable?
+int
+ucopyok(pagetable_t pagetable, uint64 va, uint64 len)
+{
+  struct proc *p = myproc();
+
+  return p != 0 && pagetable == p->pagetable &&
+    va < UKSIZE && len <= UKSIZE - va;
+}
+
+int
+copyout_new(uint64 dstva, char *src, uint64 len)
+{
+  int r;
+
+  w_sstatus(r_sstatus() | SSTATUS_SUM);
+  r = ucopy((char *)(UKBASE + dstva), src, len);
+  w_sstatus(r_sstatus() & ~SSTATUS_SUM);
+  return r;
+}
+
+int
+copyin_new(char *dst, uint64 srcva, uint64 len)
+{
+  int r;
+
+  w_sstatus(r_sstatus() | SSTATUS_SUM);
+  r = ucopy(dst, (char *)(UKBASE + srcva), len);
+  w_sstatus(r_sstatus() & ~SSTATUS_SUM);
+  return r;
+}
+
+// returns 0, 1 if there's no 0 in the first max bytes, or
+// -1 if srcva can't be read.
+int
+copyinstr_new(char *dst, uint64 srcva, uint64 max)
+{
+  int r;
+
+  if(srcva >= UKSIZE)
+    return -1;
+  if(max > UKSIZE - srcva)
+    max = UKSIZE - srcva;
+  w_sstatus(r_sstatus() | SSTATUS_SUM);
+  r = ucopystr(dst, (char *)(UKBASE + srcva), max);
+  w_sstatus(r_sstatus() & ~SSTATUS_SUM);
+  return r;
+}
+
+// called by kerneltrap(). if the trap is a fault in ucopy.S,
+// arrange for it to return -1, and return 1.
+int
+ucopytrap(uint64 scause, uint64 *sepc)
+{
+  if(scause != 13 && scause != 15 && scause != 5 && scause != 7)
+    return 0;
+  if(*sepc < (uint64)ucopystart || *sepc >= (uint64)ucopyend)
+    return 0;
+  *sepc = (uint64)ucopyfault;
+  return 1;
+}
@@ -0,0 +1,196 @@
+//
+// Lazy FP and vector register state for user processes.
+//
+// A process starts with sstatus.FS and VS Off, so its first
+// FP or vector instruction traps, and usertrap() gives it a
+// struct xregs (xregstrap()). From then on, its registers
+// are saved only if it is switched out with them dirty
+// (xregssave() from sched()), and restored on the way back
+// to user space only if something else has used this hart's
+// registers since (xregsreturn()). mycpu()->xowner is the
+// process whose state the hart's registers hold, if any.
+//
+// The kernel itself uses vector registers only between
+// kvectorbegin() and kvectorend(), for large copies.
+//
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "defs.h"
+#include "vdso.h"
+
+// Offsets are known to rvv.S. The vector registers
+// (32 * vlenb bytes) follow, in the same page.
+struct xregs {
+  uint64 f[32];
+  uint64 fcsr;
+  uint64 vstart;
+  uint64 vl;
+  uint64 vtype;
+  uint64 vcsr;
+  char v[];
+};
+
+#define VTYPE_VILL (1L << 63)
+
+uint64 misa;  // set by start(), which can read it
+int hwcap;    // HWCAP_FP, HWCAP_V
+int vlenb;    // bytes in a vector register
+
+// in rvv.S.
+void fpsave(struct xregs*);
+void fprestore(struct xregs*);
+void vsave(struct xregs*);
+void vrestore(struct xregs*);
+
+void
+xregsinit(void)
+{
+  if(misa & MISA_D)
+    hwcap |= HWCAP_FP;
+  if(misa & MISA_V){
+    // vlenb can only be read with the vector unit on.
+    w_sstatus(r_sstatus() | SSTATUS_VS);
+    vlenb = r_vlenb();
+    w_sstatus(r_sstatus() & ~SSTATUS_VS);
+    if(sizeof(struct xregs) + 32*vlenb <= PGSIZE){
+      hwcap |= HWCAP_V;
+      printf("xregs: vectors, VLEN %d\n", vlenb*8);
+    } else {
+      printf("xregs: VLEN %d too large, not using vectors\n", vlenb*8);
+    }
+  }
+  ushared->hwcap = hwcap;
+}
+
+// an illegal instruction trap from user space. if p has no
+// register state yet, this is its first FP or vector
+// instruction: give it zeroed state and retry. returns 1 if
+// so, 0 if the instruction really is illegal.
+int
+xregstrap(struct proc *p)
+{
+  if(p->xregs || hwcap == 0)
+    return 0;
+  if((p->xregs = (struct xregs *)kalloc()) == 0)
+    return 0;
+  memset(p->xregs, 0, PGSIZE);
+  p->xregs->vtype = VTYPE_VILL;
+  p->xcpu = -1;
+  return 1;
+}
+
+// if this hart's registers hold p's state, and it has
+// changed since it was last saved, save it.
+// called with interrupts off.
+void
+xregssave(struct proc *p)
+{
+  uint64 s = r_sstatus();
+
+  if(p == 0 || p->xregs == 0 || mycpu()->xowner != p)
+    return;
+  if((s & SSTATUS_FS) == SSTATUS_FS)
+    fpsave(p->xregs);
+  if((s & SSTATUS_VS) == SSTATUS_VS)
+    vsave(p->xregs);
+  w_sstatus(s & ~(SSTATUS_FS | SSTATUS_VS));
+}
+
+// usertrapret() is about to write sstatus value x and return
+// to p in user space. make sure the registers hold p's state
+// and return x with FS and VS set to match.
+// called with interrupts off.
+uint64
+xregsreturn(struct proc *p, uint64 x)
+{
+  struct cpu *c = mycpu();
+  uint64 s, fs, vs;
+
+  x &= ~(SSTATUS_FS | SSTATUS_VS);
+  if(p->xregs == 0)
+    return x;  // Off: the first use traps.
+
+  fs = SSTATUS_FS_CLEAN;
+  vs = SSTATUS_VS_CLEAN;
+  if(c->xowner != p || p->xcpu != cpuid()){
+    w_sstatus(r_sstatus() | SSTATUS_FS | SSTATUS_VS);
+    if(hwcap & HWCAP_FP)
+      fprestore(p->xregs);
+    if(hwcap & HWCAP_V)
+      vrestore(p->xregs);
+    c->xowner = p;
+    p->xcpu = cpuid();
+  } else {
+    // still here since p last ran; keep changes that
+    // haven't been saved marked Dirty.
+    s = r_sstatus();
+    if((s & SSTATUS_FS) == SSTATUS_FS)
+      fs = SSTATUS_FS;
+    if((s & SSTATUS_VS) == SSTATUS_VS)
+      vs = SSTATUS_VS;
+  }
+  if(hwcap & HWCAP_FP)
+    x |= fs;
+  if(hwcap & HWCAP_V)
+    x |= vs;
+  return x;
+}
+
+// give np a copy of p's register state, for fork().
+int
+xregsfork(struct proc *p, struct proc *np)
+{
+  if(p->xregs == 0)
+    return 0;
+  if((np->xregs = (struct xregs *)kalloc()) == 0)
+    return -1;
+  push_off();
+  xregssave(p);
+  pop_off();
+  memmove(np->xregs, p->xregs, PGSIZE);
+  np->xcpu = -1;
+  return 0;
+}
+
+// p is exiting or exec()ing: drop its register state.
+void
+xregsfree(struct proc *p)
+{
+  if(p->xregs)
+    kfree((void*)p->xregs);
+  p->xregs = 0;
+  // a hart whose xowner is still p won't match p->xcpu.
+  p->xcpu = -1;
+}
+
+// let the kernel use the vector registers until kvectorend(),
+// saving the state of whichever process they held first.
+// returns 0 if there are no vector registers.
+int
+kvectorbegin(void)
+{
+  struct cpu *c;
+
+  if((hwcap & HWCAP_V) == 0)
+    return 0;
+  push_off();
+  c = mycpu();
+  if(c->xowner){
+    xregssave(c->xowner);
+    c->xowner = 0;
+  }
+  w_sstatus(r_sstatus() | SSTATUS_VS);
+  return 1;
+}
+
+void
+kvectorend(void)
+{
+  w_sstatus(r_sstatus() & ~SSTATUS_VS);
+  pop_off();
+}
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+
+# Symbolize the samples printed by xv6's user/prof, e.g.
+#
+#   $ make qemu | tee out.txt
+#   $ prof usertests bigfile        (inside xv6)
+#   $ ./profsym.py out.txt          # flat profile
+#   $ ./profsym.py -f out.txt | flamegraph.pl > prof.svg
+#
+# Kernel pcs are looked up in kernel/kernel.sym, and user
+# pcs in user/<process name>.sym, both written by make.
+
+from __future__ import print_function
+
+import bisect, re, sys
+from collections import Counter
+from optparse import OptionParser
+
+SAMPLE = re.compile(r"prof: (\d+) (\d+) ([ku]) (\S+) 0x([0-9a-f]+)")
+
+class Symbols(object):
+    def __init__(self, path):
+        syms = []
+        try:
+            with open(path) as f:
+                for line in f:
+                    parts = line.split()
+                    if len(parts) != 2:
+                        continue
+                    addr, name = int(parts[0], 16), parts[1]
+                    # skip section names and the like.
+                    if name.startswith(".") or name.endswith(".c"):
+                        continue
+                    syms.append((addr, name))
+        except IOError:
+            pass
+        syms.sort()
+        self.addrs = [a for a, _ in syms]
+        self.names = [n for _, n in syms]
+
+    def lookup(self, pc):
+        i = bisect.bisect_right(self.addrs, pc) - 1
+        if i < 0:
+            return "0x%x" % pc
+        return self.names[i]
+
+def main():
+    parser = OptionParser(usage="usage: %prog [-f] [-n N] [file]")
+    parser.add_option("-f", "--folded", action="store_true",
+                      help="print folded stacks for flamegraph.pl")
+    parser.add_option("-n", type="int", default=40,
+                      help="show only the top N entries of the flat profile")
+    parser.add_option("-d", "--dir", default=".",
+                      help="top of the xv6 tree, for kernel/ and user/")
+    opts, args = parser.parse_args()
+
+    inp = open(args[0]) if args else sys.stdin
+    symtabs = {}
+    def syms(path):
+        if path not in symtabs:
+            symtabs[path] = Symbols(path)
+        return symtabs[path]
+
+    flat = Counter()
+    folded = Counter()
+    total = 0
+    for line in inp:
+        m = SAMPLE.search(line)
+        if not m:
+            continue
+        cpu, pid, space, name, pc = m.groups()
+        pc = int(pc, 16)
+        if space == "k":
+            fn = syms(opts.dir + "/kernel/kernel.sym").lookup(pc)
+            where = "[k] " + fn
+        else:
+            fn = syms(opts.dir + "/user/" + name + ".sym").lookup(pc)
+            where = "[u] " + fn
+        proc = name if pid != "0" else "[idle]"
+        flat[(proc, where)] += 1
+        folded[";".join([proc, "kernel" if space == "k" else "user", fn])] += 1
+        total += 1
+
+    if opts.folded:
+        for stack, n in sorted(folded.items()):
+            print(stack, n)
+        return
+
+    if total == 0:
+        print("no samples found", file=sys.stderr)
+        sys.exit(1)
+    print("%d samples" % total)
+    print("%7s %6s  %-16s %s" % ("samples", "%", "process", "function"))
+    for (proc, where), n in flat.most_common(opts.n):
+        print("%7d %5.1f%%  %-16s %s" % (n, 100.0 * n / total, proc, where))
+
+if __name__ == "__main__":
+    main()
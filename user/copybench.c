@@ -0,0 +1,110 @@
+// copybench
+//
+// Measure how fast data moves through system calls that
+// copy to and from user memory (copyin()/copyout()): a pipe
+// between two processes, and writing then re-reading a file
+// that fits in the buffer cache. Prints MB per second.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/fcntl.h"
+#include "user/user.h"
+
+#define CHUNK    4096
+#define PIPEBYTES (8 << 20)
+#define FILEBYTES (64 << 10)
+#define ROUNDS   32
+
+char buf[CHUNK];
+
+// print n bytes in ns nanoseconds as MB/s.
+void
+rate(char *what, uint64 n, uint64 ns)
+{
+  uint64 r = ns ? n * 1000 / ns : 0; // bytes per ns * 1000 = MB/s
+
+  printf("%s: %d MB/s\n", what, (int)r);
+}
+
+void
+pipebench(void)
+{
+  int fds[2], pid, n;
+  uint64 t0, t1, got;
+
+  if(pipe(fds) < 0){
+    fprintf(2, "copybench: pipe failed\n");
+    exit(1);
+  }
+  pid = fork();
+  if(pid < 0){
+    fprintf(2, "copybench: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    close(fds[0]);
+    for(got = 0; got < PIPEBYTES; got += CHUNK){
+      if(write(fds[1], buf, CHUNK) != CHUNK){
+        fprintf(2, "copybench: pipe write failed\n");
+        exit(1);
+      }
+    }
+    exit(0);
+  }
+  close(fds[1]);
+  t0 = nsecs();
+  for(got = 0; (n = read(fds[0], buf, CHUNK)) > 0; got += n)
+    ;
+  t1 = nsecs();
+  close(fds[0]);
+  wait(0);
+  if(got != PIPEBYTES){
+    fprintf(2, "copybench: pipe read %d bytes\n", (int)got);
+    exit(1);
+  }
+  rate("pipe", got, t1 - t0);
+}
+
+void
+filebench(void)
+{
+  int fd, i, n;
+  uint64 t0, t1, tw = 0, tr = 0;
+
+  for(i = 0; i < ROUNDS; i++){
+    fd = open("copybench.tmp", O_CREATE|O_RDWR);
+    if(fd < 0){
+      fprintf(2, "copybench: open failed\n");
+      exit(1);
+    }
+    t0 = nsecs();
+    for(n = 0; n < FILEBYTES; n += CHUNK)
+      if(write(fd, buf, CHUNK) != CHUNK){
+        fprintf(2, "copybench: write failed\n");
+        exit(1);
+      }
+    t1 = nsecs();
+    tw += t1 - t0;
+    close(fd);
+
+    fd = open("copybench.tmp", O_RDONLY);
+    t0 = nsecs();
+    while(read(fd, buf, CHUNK) == CHUNK)
+      ;
+    t1 = nsecs();
+    tr += t1 - t0;
+    close(fd);
+  }
+  unlink("copybench.tmp");
+  rate("file write", (uint64)FILEBYTES * ROUNDS, tw);
+  rate("file read", (uint64)FILEBYTES * ROUNDS, tr);
+}
+
+int
+main(int argc, char *argv[])
+{
+  memset(buf, 'c', sizeof(buf));
+  pipebench();
+  filebench();
+  exit(0);
+}
@@ -0,0 +1,96 @@
+// lockbench [nthreads]
+//
+// nthreads threads (default 4) each take a lock, bump a
+// shared counter and let go, ROUNDS times, with a mutex
+// (ulib.c, on futexes) and then with a lock that just
+// spins. Prints nanoseconds per lock/unlock pair and how
+// many futex system calls the mutex made. With more threads
+// than harts, spinners burn the time slices of the thread
+// holding the lock; mutex waiters sleep instead.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/syscall.h"
+#include "kernel/syslat.h"
+#include "user/user.h"
+
+#define ROUNDS 20000
+#define MAXT 16
+
+struct mutex m;
+int spin;
+volatile int counter;
+struct syslat st[NSYSLAT];
+
+void
+withmutex(void *a)
+{
+  int i;
+
+  for(i = 0; i < ROUNDS; i++){
+    mutex_lock(&m);
+    counter++;
+    mutex_unlock(&m);
+  }
+}
+
+void
+withspin(void *a)
+{
+  int i;
+
+  for(i = 0; i < ROUNDS; i++){
+    while(__sync_lock_test_and_set(&spin, 1) != 0)
+      ;
+    counter++;
+    __sync_lock_release(&spin);
+  }
+}
+
+// run fn in n threads, and return the nanoseconds it took.
+uint64
+run(void (*fn)(void*), int n)
+{
+  int i, tid[MAXT];
+  uint64 t0;
+
+  counter = 0;
+  t0 = nsecs();
+  for(i = 0; i < n; i++){
+    if((tid[i] = thread_create(fn, 0)) < 0){
+      fprintf(2, "lockbench: thread_create failed\n");
+      exit(1);
+    }
+  }
+  for(i = 0; i < n; i++)
+    thread_join(tid[i]);
+  if(counter != n * ROUNDS){
+    fprintf(2, "lockbench: counter %d, want %d\n", counter, n * ROUNDS);
+    exit(1);
+  }
+  return nsecs() - t0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int n = 4;
+  uint64 t;
+
+  if(argc > 1)
+    n = atoi(argv[1]);
+  if(n < 1 || n > MAXT){
+    fprintf(2, "usage: lockbench [1-%d]\n", MAXT);
+    exit(1);
+  }
+
+  resetsyslat();
+  t = run(withmutex, n);
+  getsyslat(st, NSYSLAT);
+  printf("mutex: %d ns per lock, %d futex_wait, %d futex_wake\n",
+         (int)(t / (n * ROUNDS)), (int)st[SYS_futex_wait].count,
+         (int)st[SYS_futex_wake].count);
+  t = run(withspin, n);
+  printf("spin:  %d ns per lock\n", (int)(t / (n * ROUNDS)));
+  exit(0);
+}
@@ -0,0 +1,109 @@
+// lockstat [command [arg ...]]
+//
+// Report which kernel locks are contended. With a command,
+// reset the statistics, run the command, and report on just
+// that run; otherwise report everything since boot.
+// Spinlock times are in cycles; sleep lock times are in us.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/param.h"
+#include "kernel/memlayout.h"
+#include "kernel/lockstat.h"
+#include "user/user.h"
+
+struct lockstat st[NLOCKSTAT];
+
+// print s, padded with spaces on the left to width w.
+void
+col(char *s, int w)
+{
+  for(w -= strlen(s); w > 0; w--)
+    printf(" ");
+  printf("%s", s);
+}
+
+// print v, right-aligned in a column of width w.
+void
+num(uint64 v, int w)
+{
+  char buf[24];
+  int i = sizeof(buf) - 1;
+
+  buf[i] = 0;
+  do {
+    buf[--i] = '0' + v % 10;
+  } while((v /= 10) != 0);
+  col(buf + i, w);
+}
+
+// sleep lock times are in mtime units; show them in us.
+uint64
+us(struct lockstat *s, uint64 t)
+{
+  return s->sleep ? t * 1000000 / MTIME_FREQ : t;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i, j, n, pid;
+  struct lockstat tmp, *s;
+
+  if(argc > 1){
+    resetlockstat();
+    pid = fork();
+    if(pid < 0){
+      fprintf(2, "lockstat: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0){
+      exec(argv[1], argv + 1);
+      fprintf(2, "lockstat: exec %s failed\n", argv[1]);
+      exit(1);
+    }
+    wait(0);
+  }
+
+  if((n = getlockstat(st, NLOCKSTAT)) < 0){
+    fprintf(2, "lockstat: getlockstat failed\n");
+    exit(1);
+  }
+
+  // most contended first; insertion sort is plenty for NLOCKSTAT.
+  for(i = 1; i < n; i++){
+    tmp = st[i];
+    for(j = i; j > 0 && (st[j-1].ncontended < tmp.ncontended ||
+        (st[j-1].ncontended == tmp.ncontended &&
+         st[j-1].nacquire < tmp.nacquire)); j--)
+      st[j] = st[j-1];
+    st[j] = tmp;
+  }
+
+  col("name", 16); col("kind", 7); col("locks", 7);
+  col("acquire", 11); col("contend", 10); col("spin", 12);
+  col("wait", 14); col("hold", 14);
+  printf("\n");
+  for(s = st; s < st + n; s++){
+    if(s->nacquire == 0)
+      continue;
+    col(s->name, 16);
+    col(s->sleep ? "sleep" : s->ticket ? "ticket" : "spin", 7);
+    num(s->nlocks, 7);
+    num(s->nacquire, 11);
+    num(s->ncontended, 10);
+    num(s->nspin, 12);
+    num(us(s, s->waitcycles), 14);
+    num(us(s, s->holdcycles), 14);
+    printf("\n");
+    for(i = 0; i < LOCKSITES; i++){
+      if(s->sitecount[i] == 0)
+        continue;
+      col("", 23);
+      printf("%p", s->sitepc[i]);
+      num(s->sitecount[i], 10);
+      printf("\n");
+    }
+  }
+  exit(0);
+}
@@ -0,0 +1,86 @@
+// mallocbench
+//
+// Time malloc() and free(): a loop allocating and freeing one
+// block, then keeping NLIVE blocks of mixed sizes live and
+// replacing a random one at a time, then freeing everything
+// and checking how much of the heap went back to the kernel.
+// Prints nanoseconds per malloc()/free() pair.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+#define NLIVE  2000
+#define ROUNDS 100000
+
+char *live[NLIVE];
+uint seed = 1;
+
+uint
+rnd(void)
+{
+  seed = seed * 1103515245 + 12345;
+  return seed >> 8;
+}
+
+// mostly small blocks, sometimes large ones.
+uint
+size(void)
+{
+  uint r = rnd();
+
+  if(r % 64 == 0)
+    return 1024 + r % 8192;
+  return 1 + r % 200;
+}
+
+void
+report(char *what, uint64 ns, int n)
+{
+  printf("%s: %d ns per malloc/free\n", what, (int)(ns / n));
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i, j;
+  uint64 t0, t1;
+  char *top0, *p;
+
+  top0 = sbrk(0);
+
+  t0 = nsecs();
+  for(i = 0; i < ROUNDS; i++){
+    if((p = malloc(32)) == 0){
+      fprintf(2, "mallocbench: out of memory\n");
+      exit(1);
+    }
+    *p = i;
+    free(p);
+  }
+  t1 = nsecs();
+  report("same size", t1 - t0, ROUNDS);
+
+  for(i = 0; i < NLIVE; i++)
+    if((live[i] = malloc(size())) == 0){
+      fprintf(2, "mallocbench: out of memory\n");
+      exit(1);
+    }
+  t0 = nsecs();
+  for(i = 0; i < ROUNDS; i++){
+    j = rnd() % NLIVE;
+    free(live[j]);
+    if((live[j] = malloc(size())) == 0){
+      fprintf(2, "mallocbench: out of memory\n");
+      exit(1);
+    }
+    *live[j] = i;
+  }
+  t1 = nsecs();
+  report("mixed, 2000 live", t1 - t0, ROUNDS);
+
+  for(i = 0; i < NLIVE; i++)
+    free(live[i]);
+  printf("heap after freeing all: %d KB\n", (int)((sbrk(0) - top0) / 1024));
+  exit(0);
+}
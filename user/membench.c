@@ -0,0 +1,145 @@
+// membench
+//
+// Compare plain byte loops, ulib's word-at-a-time versions
+// (wmemmove() &c) and, with the vector extension, the RVV
+// versions in rvv.S, printing bytes per cycle for a few
+// sizes, with and without src/dst alignment.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/riscv.h"
+#include "kernel/memlayout.h"
+#include "kernel/vdso.h"
+#include "user/user.h"
+
+#define MAXN  8192
+#define BYTES (1 << 22)  // bytes moved per measurement
+
+char src[MAXN + 16] __attribute__((aligned(8)));
+char dst[MAXN + 16] __attribute__((aligned(8)));
+
+void*
+bytemove(void *vdst, const void *vsrc, int n)
+{
+  char *d = vdst;
+  const char *s = vsrc;
+
+  while(n-- > 0)
+    *d++ = *s++;
+  return vdst;
+}
+
+void*
+byteset(void *vdst, int c, uint n)
+{
+  char *d = vdst;
+
+  while(n-- > 0)
+    *d++ = c;
+  return vdst;
+}
+
+int
+bytecmp(const void *v1, const void *v2, uint n)
+{
+  const char *p1 = v1, *p2 = v2;
+
+  for(; n > 0; n--, p1++, p2++)
+    if(*p1 != *p2)
+      return *p1 - *p2;
+  return 0;
+}
+
+uint
+bytelen(const char *s)
+{
+  uint n;
+
+  for(n = 0; s[n]; n++)
+    ;
+  return n;
+}
+
+enum { MOVE, SET, CMP, LEN };
+enum { BYTE, WORD, VEC };
+
+// cycles for running op, implemented by how, on n bytes with
+// dst at offset doff and src at offset soff, enough times to
+// move BYTES bytes.
+uint64
+run(int op, int how, int n, int doff, int soff)
+{
+  char *d = dst + doff, *s = src + soff;
+  int i, iters = BYTES / n;
+  uint64 t0, t1;
+  volatile int r = 0;
+
+  wmemset(d, 'x', n);
+  wmemset(s, 'x', n);
+  s[n-1] = 0;
+  t0 = cycles();
+  for(i = 0; i < iters; i++){
+    switch(op){
+    case MOVE:
+      if(how == BYTE) bytemove(d, s, n);
+      else if(how == WORD) wmemmove(d, s, n);
+      else vmemcpy(d, s, n);
+      break;
+    case SET:
+      if(how == BYTE) byteset(d, i, n);
+      else if(how == WORD) wmemset(d, i, n);
+      else vmemset(d, i, n);
+      break;
+    case CMP:
+      if(how == BYTE) r += bytecmp(d, s, n);
+      else if(how == WORD) r += wmemcmp(d, s, n);
+      else r += vmemcmp(d, s, n);
+      break;
+    case LEN:
+      r += how == VEC ? vstrlen(s) : bytelen(s);
+      break;
+    }
+  }
+  t1 = cycles();
+  return t1 - t0;
+}
+
+// print bytes per cycle with two decimals.
+void
+rate(uint64 cyc)
+{
+  uint64 r = cyc ? (uint64)BYTES * 100 / cyc : 0;
+
+  printf("%d.%d%d", (int)(r / 100), (int)(r / 10 % 10), (int)(r % 10));
+}
+
+int
+main(int argc, char *argv[])
+{
+  static char *names[] = { "memmove", "memset", "memcmp", "strlen" };
+  static int sizes[] = { 64, 512, 4096, MAXN };
+  int op, i, off, vec;
+
+  vec = (((struct ushared *)USHARED)->hwcap & HWCAP_V) != 0;
+  printf("op size align: byte-loop word vector (bytes per cycle)\n");
+  for(op = MOVE; op <= LEN; op++){
+    for(i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++){
+      for(off = 0; off <= 1; off++){
+        printf("%s %d %s ", names[op], sizes[i], off ? "src+1" : "both");
+        rate(run(op, BYTE, sizes[i], 0, off));
+        printf(" ");
+        if(op == LEN)
+          printf("-");
+        else
+          rate(run(op, WORD, sizes[i], 0, off));
+        printf(" ");
+        if(vec)
+          rate(run(op, VEC, sizes[i], 0, off));
+        else
+          printf("-");
+        printf("\n");
+      }
+    }
+  }
+  exit(0);
+}
@@ -0,0 +1,58 @@
+// Measure pipe ping-pong latency between a parent and a
+// child process, which usually end up on different harts.
+// Each round trip needs two cross-hart wakeups, so this shows
+// how quickly an idle hart notices that it has work to do.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+int
+main(int argc, char *argv[])
+{
+  int p1[2], p2[2];
+  int i, n, pid;
+  char c = 'x';
+  uint64 t0, t1;
+
+  n = 1000;
+  if(argc > 1)
+    n = atoi(argv[1]);
+
+  if(pipe(p1) < 0 || pipe(p2) < 0){
+    fprintf(2, "pipelat: pipe failed\n");
+    exit(1);
+  }
+
+  pid = fork();
+  if(pid < 0){
+    fprintf(2, "pipelat: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    close(p1[1]);
+    close(p2[0]);
+    while(read(p1[0], &c, 1) == 1)
+      write(p2[1], &c, 1);
+    exit(0);
+  }
+  close(p1[0]);
+  close(p2[1]);
+
+  t0 = nsecs();
+  for(i = 0; i < n; i++){
+    if(write(p1[1], &c, 1) != 1 || read(p2[0], &c, 1) != 1){
+      fprintf(2, "pipelat: round trip %d failed\n", i);
+      exit(1);
+    }
+  }
+  t1 = nsecs();
+
+  close(p1[1]);
+  close(p2[0]);
+  wait(0);
+
+  printf("pipelat: %d round trips, %d us each\n", n,
+         (int)((t1 - t0) / n / 1000));
+  exit(0);
+}
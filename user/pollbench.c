@@ -0,0 +1,148 @@
+// pollbench
+//
+// An event loop over one busy pipe and n idle ones: write a
+// byte to the busy pipe, wait for a readable pipe with poll()
+// and then with an epoll set (epoll_wait()), and read the
+// byte. Prints nanoseconds per round for a few n. poll()
+// looks at every pipe on each wait; epoll_wait() only at the
+// ones that became ready.
+//
+// Each idle pipe's write end is held open by a child, so the
+// pipe neither becomes readable nor hangs up.
+
+#include "kernel/types.h"
+#include "kernel/poll.h"
+#include "kernel/epoll.h"
+#include "user/user.h"
+
+#define NROUNDS 4000
+#define NIDLE   10     // with stdio, the busy pipe and the set: NOFILE
+
+int idle[NIDLE];       // read ends
+int holders[NIDLE];    // the children holding the write ends
+int busy[2];
+
+// a pipe that stays empty, in idle[i].
+void
+makeidle(int i)
+{
+  int fds[2], pid;
+
+  if(pipe(fds) < 0){
+    fprintf(2, "pollbench: pipe failed\n");
+    exit(1);
+  }
+  if((pid = fork()) < 0){
+    fprintf(2, "pollbench: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    // wait to be killed.
+    close(fds[0]);
+    for(;;)
+      sleep(1000);
+  }
+  close(fds[1]);
+  idle[i] = fds[0];
+  holders[i] = pid;
+}
+
+void
+consume(void)
+{
+  char c;
+
+  if(read(busy[0], &c, 1) != 1){
+    fprintf(2, "pollbench: read failed\n");
+    exit(1);
+  }
+}
+
+uint64
+bypoll(int n)
+{
+  struct pollfd pfd[NIDLE+1];
+  uint64 t0;
+  int i;
+
+  for(i = 0; i < n; i++){
+    pfd[i].fd = idle[i];
+    pfd[i].events = POLLIN;
+  }
+  pfd[n].fd = busy[0];
+  pfd[n].events = POLLIN;
+
+  t0 = nsecs();
+  for(i = 0; i < NROUNDS; i++){
+    write(busy[1], "x", 1);
+    if(poll(pfd, n + 1, -1) != 1 || pfd[n].revents != POLLIN){
+      fprintf(2, "pollbench: poll failed\n");
+      exit(1);
+    }
+    consume();
+  }
+  return nsecs() - t0;
+}
+
+uint64
+byepoll(int n)
+{
+  struct epoll_event ev, out[4];
+  uint64 t0;
+  int ep, i;
+
+  if((ep = epoll_create()) < 0){
+    fprintf(2, "pollbench: epoll_create failed\n");
+    exit(1);
+  }
+  ev.events = POLLIN;
+  for(i = 0; i < n; i++){
+    ev.data = i;
+    epoll_ctl(ep, EPOLL_CTL_ADD, idle[i], &ev);
+  }
+  ev.data = NIDLE;
+  if(epoll_ctl(ep, EPOLL_CTL_ADD, busy[0], &ev) < 0){
+    fprintf(2, "pollbench: epoll_ctl failed\n");
+    exit(1);
+  }
+  // the first wait looks at every file.
+  epoll_wait(ep, out, 4, 0);
+
+  t0 = nsecs();
+  for(i = 0; i < NROUNDS; i++){
+    write(busy[1], "x", 1);
+    if(epoll_wait(ep, out, 4, -1) != 1 || out[0].data != NIDLE){
+      fprintf(2, "pollbench: epoll_wait failed\n");
+      exit(1);
+    }
+    consume();
+  }
+  t0 = nsecs() - t0;
+  close(ep);
+  return t0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  static int ns[] = { 0, 5, NIDLE };
+  int i;
+
+  if(pipe(busy) < 0){
+    fprintf(2, "pollbench: pipe failed\n");
+    exit(1);
+  }
+  for(i = 0; i < NIDLE; i++)
+    makeidle(i);
+
+  for(i = 0; i < sizeof(ns)/sizeof(ns[0]); i++){
+    printf("%d idle pipes: poll %d ns, epoll %d ns per round\n", ns[i],
+           (int)(bypoll(ns[i]) / NROUNDS), (int)(byepoll(ns[i]) / NROUNDS));
+  }
+
+  for(i = 0; i < NIDLE; i++){
+    kill(holders[i]);
+    wait(0);
+  }
+  exit(0);
+}
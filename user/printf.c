@@ -1,23 +1,124 @@
 #include "kernel/types.h"
 #include "kernel/stat.h"
+#include "kernel/param.h"
 #include "user/user.h"
 
 #include <stdarg.h>
 
 static char digits[] = "0123456789ABCDEF";
 
+// Output to each fd goes through a buffer, written out:
+// _IONBF: at the end of each printf() &c (not per character);
+// _IOLBF: at each newline; _IOFBF: when the buffer fills.
+// The standard output is line-buffered if it's the console,
+// fully buffered otherwise; other fds are _IONBF until
+// setvbuf(). Buffers are also written by fflush(), and
+// before exit(), fork(), exec() and reads of the standard
+// input (ulib.c).
+#define STREAMBUF 512
+
+struct stream {
+  int mode;  // 0 until first used
+  int n;     // bytes in buf
+  char buf[STREAMBUF];
+} streams[NOFILE];
+
+extern void (*stdioflush)(void);
+
+static void
+flush(int fd)
+{
+  struct stream *f = &streams[fd];
+
+  if(f->n > 0)
+    write(fd, f->buf, f->n);
+  f->n = 0;
+}
+
+static void
+flushall(void)
+{
+  int fd;
+
+  for(fd = 0; fd < NOFILE; fd++)
+    flush(fd);
+}
+
+// the buffer for fd, or 0 if fd can't be valid.
+static struct stream*
+stream(int fd)
+{
+  struct stream *f;
+  struct stat st;
+
+  if(fd < 0 || fd >= NOFILE)
+    return 0;
+  f = &streams[fd];
+  if(f->mode == 0){
+    f->mode = _IONBF;
+    if(fd == 1)
+      f->mode = fstat(fd, &st) == 0 && st.type == T_DEVICE ? _IOLBF : _IOFBF;
+    stdioflush = flushall;
+  }
+  return f;
+}
+
 static void
 putc(int fd, char c)
 {
-  write(fd, &c, 1);
+  struct stream *f = &streams[fd];
+
+  if(f->n == STREAMBUF)
+    flush(fd);
+  f->buf[f->n++] = c;
+  if(c == '\n' && f->mode == _IOLBF)
+    flush(fd);
+}
+
+// write n bytes of buf to fd through its buffer.
+int
+fwrite(int fd, const void *buf, int n)
+{
+  struct stream *f;
+  const char *s = buf;
+  int i;
+
+  if((f = stream(fd)) == 0)
+    return -1;
+  if(f->mode == _IONBF || n >= STREAMBUF){
+    flush(fd);
+    return write(fd, buf, n);
+  }
+  for(i = 0; i < n; i++)
+    putc(fd, s[i]);
+  return n;
+}
+
+void
+fflush(int fd)
+{
+  if(stream(fd))
+    flush(fd);
+}
+
+// set fd's mode to _IONBF, _IOLBF or _IOFBF.
+void
+setvbuf(int fd, int mode)
+{
+  struct stream *f;
+
+  if((f = stream(fd)) == 0)
+    return;
+  flush(fd);
+  f->mode = mode;
 }
 
 static void
-printint(int fd, int xx, int base, int sgn)
+printint(int fd, long xx, int base, int sgn)
 {
-  char buf[16];
+  char buf[24];
   int i, neg;
-  uint x;
+  uint64 x;
 
   neg = 0;
   if(sgn && xx < 0){
@@ -54,6 +155,8 @@ vprintf(int fd, const char *fmt, va_list ap)
   char *s;
   int c, i, state;
 
+  if(stream(fd) == 0)
+    return;
   state = 0;
   for(i = 0; fmt[i]; i++){
     c = fmt[i] & 0xff;
@@ -69,7 +172,7 @@ vprintf(int fd, const char *fmt, va_list ap)
       } else if(c == 'l') {
         printint(fd, va_arg(ap, uint64), 10, 0);
       } else if(c == 'x') {
-        printint(fd, va_arg(ap, int), 16, 0);
+        printint(fd, va_arg(ap, uint), 16, 0);
       } else if(c == 'p') {
         printptr(fd, va_arg(ap, uint64));
       } else if(c == 's'){
@@ -92,6 +195,8 @@ vprintf(int fd, const char *fmt, va_list ap)
       state = 0;
     }
   }
+  if(streams[fd].mode == _IONBF)
+    flush(fd);
 }
 
 void
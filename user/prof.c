@@ -0,0 +1,115 @@
+// prof command [arg ...]
+//
+// Run command under the timer-driven sampling profiler
+// (kernel/prof.c), printing one line per sample:
+//   prof: cpu pid k|u name pc
+// Capture the console output and feed it to profsym.py
+// on the host for a symbolized profile.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/spinlock.h"
+#include "kernel/sleeplock.h"
+#include "kernel/fs.h"
+#include "kernel/file.h"
+#include "kernel/fcntl.h"
+#include "kernel/prof.h"
+#include "user/user.h"
+
+struct profsample samples[32];
+
+char*
+putnum(char *p, uint64 x, int base)
+{
+  char buf[24];
+  int i = 0;
+
+  do {
+    buf[i++] = "0123456789abcdef"[x % base];
+  } while((x /= base) != 0);
+  while(--i >= 0)
+    *p++ = buf[i];
+  return p;
+}
+
+char*
+putstr(char *p, char *s)
+{
+  while(*s)
+    *p++ = *s++;
+  return p;
+}
+
+// print each sample with a single write(), so that lines
+// don't get mixed up with the command's own output.
+void
+drain(int fd)
+{
+  char line[80], *p;
+  struct profsample *s;
+  int n;
+
+  while((n = read(fd, samples, sizeof(samples))) > 0){
+    for(s = samples; s < samples + n / sizeof(*s); s++){
+      p = putstr(line, "prof: ");
+      p = putnum(p, s->cpu, 10);
+      *p++ = ' ';
+      p = putnum(p, s->pid, 10);
+      p = putstr(p, s->user ? " u " : " k ");
+      p = putstr(p, s->name[0] ? s->name : "-");
+      p = putstr(p, " 0x");
+      p = putnum(p, s->pc, 16);
+      *p++ = '\n';
+      write(1, line, p - line);
+    }
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int fd, pid, drainer;
+
+  if(argc < 2){
+    fprintf(2, "usage: prof command [arg ...]\n");
+    exit(1);
+  }
+
+  if((fd = open("/prof", O_RDWR)) < 0){
+    mknod("/prof", PROF, 0);
+    fd = open("/prof", O_RDWR);
+  }
+  if(fd < 0){
+    fprintf(2, "prof: cannot open /prof\n");
+    exit(1);
+  }
+
+  write(fd, "1", 1);
+
+  // read samples while the command runs, so the
+  // kernel's per-hart rings don't fill up.
+  drainer = fork();
+  if(drainer == 0){
+    drain(fd);
+    exit(0);
+  }
+
+  pid = fork();
+  if(pid == 0){
+    close(fd);
+    exec(argv[1], argv + 1);
+    fprintf(2, "prof: exec %s failed\n", argv[1]);
+    exit(1);
+  }
+  if(drainer < 0 || pid < 0){
+    fprintf(2, "prof: fork failed\n");
+    write(fd, "0", 1);
+    exit(1);
+  }
+
+  while(wait(0) != pid)
+    ;
+  write(fd, "0", 1);
+  wait(0);
+  exit(0);
+}
@@ -0,0 +1,200 @@
+// shmbench
+//
+// Move NBYTES from a parent to its child, in writes of a few
+// sizes, through a pipe and then through a ring buffer in
+// shared memory (mmap(MAP_SHARED|MAP_ANONYMOUS), which fork()
+// shares), and print the throughput of each. The ring only
+// makes system calls when one side has to wait for the other:
+// it sleeps on a futex, which works across processes since
+// both map the same physical page.
+
+#include "kernel/types.h"
+#include "kernel/fcntl.h"
+#include "user/user.h"
+
+#define NBYTES (8*1024*1024)
+#define RING   (64*1024)     // a power of two
+#define SPINS  1000
+
+struct ring {
+  int head;       // bytes written, mod 2^32
+  int tail;       // bytes read
+  int rwaiting;   // the reader sleeps on head
+  int wwaiting;   // the writer sleeps on tail
+  int pad[12];
+  char buf[RING];
+};
+
+char data[4096], buf[4096];
+
+// wait for *p to change from v, which the other side does,
+// and then wakes us if *waiting.
+void
+waitfor(int *p, int v, int *waiting)
+{
+  int i;
+
+  for(i = 0; i < SPINS; i++)
+    if(*(volatile int*)p != v)
+      return;
+  *waiting = 1;
+  __sync_synchronize();
+  if(*(volatile int*)p == v)
+    futex_wait(p, v);
+  *waiting = 0;
+}
+
+void
+advance(int *p, int n, int *waiting)
+{
+  __sync_fetch_and_add(p, n);
+  if(*(volatile int*)waiting)
+    futex_wake(p, 1);
+}
+
+void
+ringwrite(struct ring *r, char *s, int n)
+{
+  int h, m, i;
+
+  while(n > 0){
+    h = r->head;
+    while(h - *(volatile int*)&r->tail == RING)
+      waitfor(&r->tail, h - RING, &r->wwaiting);
+    m = RING - (h - r->tail);
+    if(m > n)
+      m = n;
+    i = RING - (h & (RING-1));   // before the ring wraps
+    if(i > m)
+      i = m;
+    memmove(r->buf + (h & (RING-1)), s, i);
+    memmove(r->buf, s + i, m - i);
+    advance(&r->head, m, &r->rwaiting);
+    s += m;
+    n -= m;
+  }
+}
+
+int
+ringread(struct ring *r, char *s, int n)
+{
+  int t, m, i;
+
+  t = r->tail;
+  while(*(volatile int*)&r->head == t)
+    waitfor(&r->head, t, &r->rwaiting);
+  m = r->head - t;
+  if(m > n)
+    m = n;
+  i = RING - (t & (RING-1));
+  if(i > m)
+    i = m;
+  memmove(s, r->buf + (t & (RING-1)), i);
+  memmove(s + i, r->buf, m - i);
+  advance(&r->tail, m, &r->wwaiting);
+  return m;
+}
+
+// the child checks the bytes it read by their sum.
+uint
+sum(char *s, int n)
+{
+  uint x = 0;
+
+  while(n-- > 0)
+    x += (uchar)*s++;
+  return x;
+}
+
+void
+report(char *what, int chunk, uint64 ns)
+{
+  printf("%s, %d-byte writes: %d MB/s\n", what, chunk,
+         (int)((uint64)NBYTES * 1000 / (ns ? ns : 1)));
+}
+
+// returns the time it took, or 0 if the child got
+// the wrong bytes.
+uint64
+viapipe(int chunk)
+{
+  int fds[2], n, got, status;
+  uint x, want = (uint)NBYTES / chunk * sum(data, chunk);
+  uint64 t0;
+
+  if(pipe(fds) < 0){
+    fprintf(2, "shmbench: pipe failed\n");
+    exit(1);
+  }
+  t0 = nsecs();
+  if(fork() == 0){
+    close(fds[1]);
+    x = 0;
+    for(got = 0; got < NBYTES; got += n){
+      if((n = read(fds[0], buf, sizeof(buf))) <= 0)
+        exit(1);
+      x += sum(buf, n);
+    }
+    exit(x != want);
+  }
+  close(fds[0]);
+  for(n = 0; n < NBYTES; n += chunk)
+    write(fds[1], data, chunk);
+  close(fds[1]);
+  wait(&status);
+  return status == 0 ? nsecs() - t0 : 0;
+}
+
+uint64
+viashm(struct ring *r, int chunk)
+{
+  int n, got, status;
+  uint x, want = (uint)NBYTES / chunk * sum(data, chunk);
+  uint64 t0;
+
+  r->head = r->tail = r->rwaiting = r->wwaiting = 0;
+  t0 = nsecs();
+  if(fork() == 0){
+    x = 0;
+    for(got = 0; got < NBYTES; got += n){
+      n = ringread(r, buf, sizeof(buf));
+      x += sum(buf, n);
+    }
+    exit(x != want);
+  }
+  for(n = 0; n < NBYTES; n += chunk)
+    ringwrite(r, data, chunk);
+  wait(&status);
+  return status == 0 ? nsecs() - t0 : 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  static int chunks[] = { 512, 4096 };
+  struct ring *r;
+  uint64 t;
+  int i;
+
+  for(i = 0; i < sizeof(data); i++)
+    data[i] = i * 7;
+  r = mmap(0, sizeof(*r), PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+  if(r == MAP_FAILED){
+    fprintf(2, "shmbench: mmap failed\n");
+    exit(1);
+  }
+
+  for(i = 0; i < sizeof(chunks)/sizeof(chunks[0]); i++){
+    if((t = viapipe(chunks[i])) == 0){
+      fprintf(2, "shmbench: pipe: wrong data\n");
+      exit(1);
+    }
+    report("pipe", chunks[i], t);
+    if((t = viashm(r, chunks[i])) == 0){
+      fprintf(2, "shmbench: shm: wrong data\n");
+      exit(1);
+    }
+    report("shm ", chunks[i], t);
+  }
+  exit(0);
+}
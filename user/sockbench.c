@@ -0,0 +1,194 @@
+// sockbench
+//
+// A local RPC service in a child: it reads a request and
+// writes back a reply of the same size. Time NRPC round trips
+// through a pair of pipes, one each way, and then through one
+// Unix domain socket connection; then move NBYTES one way
+// through a pipe and a socket. Prints nanoseconds per round
+// trip and MB/s.
+
+#include "kernel/types.h"
+#include "kernel/socket.h"
+#include "user/user.h"
+
+#define NRPC   2000
+#define REQSZ  64
+#define NBYTES (4*1024*1024)
+#define CHUNK  4096
+
+char *name = "sockbench.sock";
+char buf[CHUNK];
+
+void
+fail(char *what)
+{
+  fprintf(2, "sockbench: %s failed\n", what);
+  exit(1);
+}
+
+// read exactly n bytes, or fail.
+void
+readn(int fd, char *p, int n)
+{
+  int m;
+
+  while(n > 0){
+    if((m = read(fd, p, n)) <= 0)
+      fail("read");
+    p += m;
+    n -= m;
+  }
+}
+
+// answer requests on rfd, on wfd, until rfd's writer is gone.
+void
+serve(int rfd, int wfd)
+{
+  char req[REQSZ];
+  int n;
+
+  while((n = read(rfd, req, sizeof(req))) > 0)
+    if(write(wfd, req, n) != n)
+      break;
+  exit(0);
+}
+
+uint64
+rpcs(int rfd, int wfd)
+{
+  char req[REQSZ], rep[REQSZ];
+  uint64 t0 = nsecs();
+  int i;
+
+  for(i = 0; i < NRPC; i++){
+    req[0] = i;
+    if(write(wfd, req, REQSZ) != REQSZ)
+      fail("write");
+    readn(rfd, rep, REQSZ);
+    if(rep[0] != req[0])
+      fail("reply");
+  }
+  return nsecs() - t0;
+}
+
+// read NBYTES from fd and exit.
+void
+sink(int fd)
+{
+  int got, n;
+
+  for(got = 0; got < NBYTES; got += n)
+    if((n = read(fd, buf, sizeof(buf))) <= 0)
+      exit(1);
+  exit(0);
+}
+
+uint64
+stream(int fd)
+{
+  uint64 t0 = nsecs();
+  int n, status;
+
+  for(n = 0; n < NBYTES; n += CHUNK)
+    if(write(fd, buf, CHUNK) != CHUNK)
+      fail("write");
+  close(fd);
+  wait(&status);
+  if(status != 0)
+    fail("sink");
+  return nsecs() - t0;
+}
+
+// a listening socket named name.
+int
+listener(void)
+{
+  int l;
+
+  unlink(name);
+  if((l = socket(AF_UNIX, SOCK_STREAM)) < 0 || bind(l, name) < 0 || listen(l, 1) < 0)
+    fail("socket, bind or listen");
+  return l;
+}
+
+// a socket connected to l, with the other end in the child,
+// which runs fn on it.
+int
+connected(int l, void (*fn)(int))
+{
+  int c, s;
+
+  if((c = socket(AF_UNIX, SOCK_STREAM)) < 0 || connect(c, name) < 0)
+    fail("connect");
+  if((s = accept(l)) < 0)
+    fail("accept");
+  if(fork() == 0){
+    close(c);
+    close(l);
+    fn(s);
+  }
+  close(s);
+  return c;
+}
+
+void
+servesock(int s)
+{
+  serve(s, s);
+}
+
+void
+report(char *what, uint64 ns)
+{
+  printf("%s: %d ns per round trip\n", what, (int)(ns / NRPC));
+}
+
+void
+reportmb(char *what, uint64 ns)
+{
+  printf("%s: %d MB/s\n", what, (int)((uint64)NBYTES * 1000 / (ns ? ns : 1)));
+}
+
+int
+main(int argc, char *argv[])
+{
+  int req[2], rep[2], fds[2], l, c;
+
+  // RPCs over a pipe pair.
+  if(pipe(req) < 0 || pipe(rep) < 0)
+    fail("pipe");
+  if(fork() == 0){
+    close(req[1]);
+    close(rep[0]);
+    serve(req[0], rep[1]);
+  }
+  close(req[0]);
+  close(rep[1]);
+  report("pipe pair", rpcs(rep[0], req[1]));
+  close(req[1]);
+  close(rep[0]);
+  wait(0);
+
+  // RPCs over a socket.
+  l = listener();
+  c = connected(l, servesock);
+  report("socket   ", rpcs(c, c));
+  close(c);
+  wait(0);
+
+  // one way.
+  if(pipe(fds) < 0)
+    fail("pipe");
+  if(fork() == 0){
+    close(fds[1]);
+    sink(fds[0]);
+  }
+  close(fds[0]);
+  reportmb("pipe   stream", stream(fds[1]));
+
+  reportmb("socket stream", stream(connected(l, sink)));
+
+  close(l);
+  unlink(name);
+  exit(0);
+}
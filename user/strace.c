@@ -0,0 +1,281 @@
+// strace [-e call,call,...] command [arg ...]
+//
+// Run command, printing one line per system call it and its
+// children make (kernel/trace.c):
+//   pid name(a0, a1, a2) = ret  us
+// With -e, trace only the named system calls.
+
+#include "kernel/types.h"
+#include "kernel/param.h"
+#include "kernel/stat.h"
+#include "kernel/memlayout.h"
+#include "kernel/syscall.h"
+#include "kernel/time.h"
+#include "kernel/trace.h"
+#include "kernel/poll.h"
+#include "user/user.h"
+
+// name and number of arguments shown for each system call.
+struct {
+  char *name;
+  int nargs;
+} calls[] = {
+[SYS_fork]    { "fork", 0 },
+[SYS_exit]    { "exit", 1 },
+[SYS_wait]    { "wait", 1 },
+[SYS_pipe]    { "pipe", 1 },
+[SYS_read]    { "read", 3 },
+[SYS_kill]    { "kill", 1 },
+[SYS_exec]    { "exec", 2 },
+[SYS_fstat]   { "fstat", 2 },
+[SYS_chdir]   { "chdir", 1 },
+[SYS_dup]     { "dup", 1 },
+[SYS_getpid]  { "getpid", 0 },
+[SYS_sbrk]    { "sbrk", 1 },
+[SYS_sleep]   { "sleep", 1 },
+[SYS_uptime]  { "uptime", 0 },
+[SYS_open]    { "open", 2 },
+[SYS_write]   { "write", 3 },
+[SYS_mknod]   { "mknod", 3 },
+[SYS_unlink]  { "unlink", 1 },
+[SYS_link]    { "link", 2 },
+[SYS_mkdir]   { "mkdir", 1 },
+[SYS_close]   { "close", 1 },
+[SYS_clock_gettime] { "clock_gettime", 1 },
+[SYS_nanosleep] { "nanosleep", 1 },
+[SYS_getlockstat] { "getlockstat", 2 },
+[SYS_resetlockstat] { "resetlockstat", 0 },
+[SYS_trace]   { "trace", 1 },
+[SYS_traceread] { "traceread", 2 },
+[SYS_getsyslat] { "getsyslat", 2 },
+[SYS_resetsyslat] { "resetsyslat", 0 },
+[SYS_mmap]    { "mmap", 6 },
+[SYS_munmap]  { "munmap", 2 },
+[SYS_clone]   { "clone", 3 },
+[SYS_join]    { "join", 2 },
+[SYS_futex_wait] { "futex_wait", 2 },
+[SYS_futex_wake] { "futex_wake", 2 },
+[SYS_memfd]   { "memfd", 1 },
+[SYS_uring_setup] { "uring_setup", 1 },
+[SYS_uring_enter] { "uring_enter", 2 },
+[SYS_pipe2]   { "pipe2", 2 },
+[SYS_poll]    { "poll", 3 },
+[SYS_epoll_create] { "epoll_create", 0 },
+[SYS_epoll_ctl] { "epoll_ctl", 4 },
+[SYS_epoll_wait] { "epoll_wait", 4 },
+[SYS_socket]  { "socket", 2 },
+[SYS_bind]    { "bind", 2 },
+[SYS_listen]  { "listen", 2 },
+[SYS_accept]  { "accept", 1 },
+[SYS_connect] { "connect", 2 },
+};
+
+#define NELEM(x) (sizeof(x)/sizeof((x)[0]))
+#define NCALLS NELEM(calls)
+
+struct tracerec recs[32];
+
+char*
+putnum(char *p, uint64 x, int base)
+{
+  char buf[24];
+  int i = 0;
+
+  do {
+    buf[i++] = "0123456789abcdef"[x % base];
+  } while((x /= base) != 0);
+  while(--i >= 0)
+    *p++ = buf[i];
+  return p;
+}
+
+char*
+putstr(char *p, char *s)
+{
+  while(*s)
+    *p++ = *s++;
+  return p;
+}
+
+// small values in decimal, addresses in hex;
+// negative returns as -n.
+char*
+putval(char *p, uint64 x)
+{
+  if((long)x < 0 && (long)x > -4096){
+    *p++ = '-';
+    return putnum(p, -(long)x, 10);
+  }
+  if(x < 0x10000)
+    return putnum(p, x, 10);
+  p = putstr(p, "0x");
+  return putnum(p, x, 16);
+}
+
+// print each record with a single write(), so that lines
+// don't get mixed up with the command's own output.
+// returns 1 if the record is pid's exit.
+int
+show(struct tracerec *r, int pid)
+{
+  char line[160], *p;
+  int i, nargs;
+
+  p = line;
+  if(r->num == TRACE_LOST){
+    p = putstr(p, "strace: cpu ");
+    p = putnum(p, r->cpu, 10);
+    p = putstr(p, " lost ");
+    p = putnum(p, r->ret, 10);
+    p = putstr(p, " records\n");
+    write(2, line, p - line);
+    return 0;
+  }
+
+  p = putnum(p, r->pid, 10);
+  *p++ = ' ';
+  if(r->num < NCALLS && calls[r->num].name){
+    p = putstr(p, calls[r->num].name);
+    nargs = calls[r->num].nargs;
+  } else {
+    p = putstr(p, "sys");
+    p = putnum(p, r->num, 10);
+    nargs = 6;
+  }
+  *p++ = '(';
+  for(i = 0; i < nargs; i++){
+    if(i > 0)
+      p = putstr(p, ", ");
+    p = putval(p, r->args[i]);
+  }
+  *p++ = ')';
+  if(r->num != SYS_exit){
+    p = putstr(p, " = ");
+    p = putval(p, r->ret);
+    p = putstr(p, "  ");
+    p = putnum(p, (r->texit - r->tenter) * 1000000 / MTIME_FREQ, 10);
+    p = putstr(p, " us");
+  }
+  *p++ = '\n';
+  write(2, line, p - line);
+  return r->num == SYS_exit && r->pid == pid;
+}
+
+// parse a comma-separated list of system call names.
+uint64
+parsemask(char *s)
+{
+  uint64 mask = 0;
+  char *e;
+  int i, n;
+
+  while(*s){
+    for(e = s; *e && *e != ','; e++)
+      ;
+    n = e - s;
+    for(i = 1; i < NCALLS; i++){
+      if(calls[i].name && strlen(calls[i].name) == n &&
+         memcmp(calls[i].name, s, n) == 0)
+        break;
+    }
+    if(i == NCALLS){
+      fprintf(2, "strace: unknown system call %s\n", s);
+      exit(1);
+    }
+    mask |= 1L << i;
+    s = *e ? e + 1 : e;
+  }
+  return mask;
+}
+
+// move fd to NOFILE-1, out of the way of the fds the traced
+// program opens, which then get the numbers they would get
+// without strace. there is no dup2(): dup() until it gets
+// there.
+void
+hidefd(int fd)
+{
+  int fds[NOFILE], n, i;
+
+  for(n = 0; n < NOFILE; n++){
+    if((fds[n] = dup(fd)) < 0)
+      break;
+    if(fds[n] == NOFILE-1){
+      close(fd);
+      break;
+    }
+  }
+  for(i = 0; i < n; i++)
+    close(fds[i]);
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct pollfd pfd;
+  uint64 mask = ~0L;
+  int pid, n, i, done, gone[2];
+
+  if(argc > 2 && strcmp(argv[1], "-e") == 0){
+    mask = parsemask(argv[2]);
+    argc -= 2;
+    argv += 2;
+  }
+  if(argc < 2){
+    fprintf(2, "usage: strace [-e call,...] command [arg ...]\n");
+    exit(1);
+  }
+
+  // discard whatever earlier runs left in the rings.
+  while(traceread(recs, NELEM(recs)) > 0)
+    ;
+
+  // the child holds gone[1] open until it exits, so we see
+  // the exit even if the ring overwrote its record.
+  if(pipe(gone) < 0){
+    fprintf(2, "strace: pipe failed\n");
+    exit(1);
+  }
+  pid = fork();
+  if(pid < 0){
+    fprintf(2, "strace: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    close(gone[0]);
+    hidefd(gone[1]);
+    // always trace exit, so the parent knows when to stop.
+    trace(mask | (1L << SYS_exit));
+    exec(argv[1], argv + 1);
+    fprintf(2, "strace: exec %s failed\n", argv[1]);
+    exit(1);
+  }
+
+  close(gone[1]);
+  pfd.fd = gone[0];
+  pfd.events = POLLIN;
+
+  done = 0;
+  while(!done){
+    n = traceread(recs, NELEM(recs));
+    if(n < 0){
+      fprintf(2, "strace: traceread failed\n");
+      break;
+    }
+    if(n == 0){
+      // wait 5ms for more records, or for the child to be gone.
+      if(poll(&pfd, 1, 5) == 1 && (pfd.revents & POLLHUP))
+        break;
+      continue;
+    }
+    for(i = 0; i < n; i++)
+      done |= show(&recs[i], pid);
+  }
+  // pick up what other harts recorded before the exit.
+  while((n = traceread(recs, NELEM(recs))) > 0)
+    for(i = 0; i < n; i++)
+      show(&recs[i], pid);
+  close(gone[0]);
+  wait(0);
+  exit(0);
+}
@@ -0,0 +1,180 @@
+// syslat [command [arg ...]]
+//
+// Report how long system calls take: count, mean, p50, p99
+// and max per call, in microseconds. With a command, reset
+// the histograms, run the command, and report on just that
+// run; otherwise report everything since boot.
+// p50 and p99 come from log2 buckets, so they are upper
+// bounds, within a factor of two.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/memlayout.h"
+#include "kernel/syscall.h"
+#include "kernel/syslat.h"
+#include "user/user.h"
+
+char *names[] = {
+[SYS_fork]    "fork",
+[SYS_exit]    "exit",
+[SYS_wait]    "wait",
+[SYS_pipe]    "pipe",
+[SYS_read]    "read",
+[SYS_kill]    "kill",
+[SYS_exec]    "exec",
+[SYS_fstat]   "fstat",
+[SYS_chdir]   "chdir",
+[SYS_dup]     "dup",
+[SYS_getpid]  "getpid",
+[SYS_sbrk]    "sbrk",
+[SYS_sleep]   "sleep",
+[SYS_uptime]  "uptime",
+[SYS_open]    "open",
+[SYS_write]   "write",
+[SYS_mknod]   "mknod",
+[SYS_unlink]  "unlink",
+[SYS_link]    "link",
+[SYS_mkdir]   "mkdir",
+[SYS_close]   "close",
+[SYS_clock_gettime] "clock_gettime",
+[SYS_nanosleep] "nanosleep",
+[SYS_getlockstat] "getlockstat",
+[SYS_resetlockstat] "resetlockstat",
+[SYS_trace]   "trace",
+[SYS_traceread] "traceread",
+[SYS_getsyslat] "getsyslat",
+[SYS_resetsyslat] "resetsyslat",
+[SYS_mmap]    "mmap",
+[SYS_munmap]  "munmap",
+[SYS_clone]   "clone",
+[SYS_join]    "join",
+[SYS_futex_wait] "futex_wait",
+[SYS_futex_wake] "futex_wake",
+[SYS_memfd]   "memfd",
+[SYS_uring_setup] "uring_setup",
+[SYS_uring_enter] "uring_enter",
+[SYS_pipe2]   "pipe2",
+[SYS_poll]    "poll",
+[SYS_epoll_create] "epoll_create",
+[SYS_epoll_ctl] "epoll_ctl",
+[SYS_epoll_wait] "epoll_wait",
+[SYS_socket]  "socket",
+[SYS_bind]    "bind",
+[SYS_listen]  "listen",
+[SYS_accept]  "accept",
+[SYS_connect] "connect",
+};
+
+struct syslat st[NSYSLAT];
+
+// print s, padded with spaces on the left to width w.
+void
+col(char *s, int w)
+{
+  for(w -= strlen(s); w > 0; w--)
+    printf(" ");
+  printf("%s", s);
+}
+
+// print mtime units t as microseconds with one decimal,
+// right-aligned in a column of width w.
+void
+us(uint64 t, int w)
+{
+  char buf[24];
+  int i = sizeof(buf) - 1;
+  uint64 v = t * 10000000 / MTIME_FREQ; // tenths of a us
+
+  buf[i] = 0;
+  buf[--i] = '0' + v % 10;
+  buf[--i] = '.';
+  v /= 10;
+  do {
+    buf[--i] = '0' + v % 10;
+  } while((v /= 10) != 0);
+  col(buf + i, w);
+}
+
+void
+num(uint64 v, int w)
+{
+  char buf[24];
+  int i = sizeof(buf) - 1;
+
+  buf[i] = 0;
+  do {
+    buf[--i] = '0' + v % 10;
+  } while((v /= 10) != 0);
+  col(buf + i, w);
+}
+
+// upper bound of the time within which pct percent
+// of the calls in s returned.
+uint64
+percentile(struct syslat *s, int pct)
+{
+  uint64 want, seen = 0, hi;
+  int b;
+
+  want = (s->count * pct + 99) / 100;
+  for(b = 0; b < NLATBUCKET; b++){
+    seen += s->bucket[b];
+    if(seen >= want)
+      break;
+  }
+  hi = (2L << b) - 1;
+  return hi < s->max ? hi : s->max;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i, n, pid;
+  struct syslat *s;
+  char name[16];
+
+  if(argc > 1){
+    resetsyslat();
+    pid = fork();
+    if(pid < 0){
+      fprintf(2, "syslat: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0){
+      exec(argv[1], argv + 1);
+      fprintf(2, "syslat: exec %s failed\n", argv[1]);
+      exit(1);
+    }
+    wait(0);
+  }
+
+  if((n = getsyslat(st, NSYSLAT)) < 0){
+    fprintf(2, "syslat: getsyslat failed\n");
+    exit(1);
+  }
+
+  col("call", 14); col("count", 9); col("mean", 10);
+  col("p50", 10); col("p99", 10); col("max", 12);
+  printf("\n");
+  for(i = 0; i < n; i++){
+    s = &st[i];
+    if(s->count == 0)
+      continue;
+    if(i < sizeof(names)/sizeof(names[0]) && names[i])
+      col(names[i], 14);
+    else {
+      strcpy(name, "sys");
+      name[3] = '0' + i / 10;
+      name[4] = '0' + i % 10;
+      name[5] = 0;
+      col(name, 14);
+    }
+    num(s->count, 9);
+    us(s->total / s->count, 10);
+    us(percentile(s, 50), 10);
+    us(percentile(s, 99), 10);
+    us(s->max, 12);
+    printf("\n");
+  }
+  exit(0);
+}
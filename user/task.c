@@ -0,0 +1,320 @@
+#include "kernel/types.h"
+#include "kernel/param.h"
+#include "kernel/riscv.h"
+#include "kernel/memlayout.h"
+#include "kernel/vdso.h"
+#include "user/user.h"
+
+// Work-stealing tasks on threads (thread.c).
+//
+// task_start(n) starts n workers, one per hart by default:
+// the calling thread, which becomes worker 0, and n-1
+// threads. task_spawn() pushes a task on the bottom of the
+// spawning worker's deque, and the worker pops its own tasks
+// from there, newest first, while idle workers steal the
+// oldest ones, which tend to be the biggest, from the top of
+// someone else's. The deques are Chase-Lev deques: the owner
+// only needs an atomic instruction to take the last task,
+// and thieves one to take any.
+//
+// task_sync() waits for a task by running other tasks,
+// usually that very one if no one stole it, and sleeps on a
+// futex only if it has nothing to do. Idle workers sleep on
+// one too, until task_spawn() has work for them.
+//
+// A worker finds its struct worker in the tp register,
+// which nothing else in user space uses. task_spawn() and
+// task_sync() must be called from a worker: in tasks, or in
+// the thread that called task_start().
+
+#define DEQSIZE 256  // a power of two
+#define SPINS   200  // look for work this often before sleeping
+
+struct worker {
+  volatile long top;     // next task to steal
+  volatile long bottom;  // next free slot; only the owner changes it
+  struct task *buf[DEQSIZE];
+  int tid;
+  uint seed;
+} __attribute__((aligned(64)));
+
+static struct worker workers[NCPU];
+
+static struct {
+  int n;           // workers
+  int stop;        // task_stop() was called
+  int sleepers;    // idle workers in futex_wait(&wakeseq)
+  int wakeseq;     // bumped to wake them
+} rt;
+
+static struct worker*
+self(void)
+{
+  struct worker *w;
+
+  asm volatile("mv %0, tp" : "=r" (w));
+  return w;
+}
+
+static void
+setself(struct worker *w)
+{
+  asm volatile("mv tp, %0" : : "r" (w));
+}
+
+// the owner adds t at the bottom. returns -1 if full.
+static int
+push(struct worker *w, struct task *t)
+{
+  long b = w->bottom;
+
+  if(b - __atomic_load_n(&w->top, __ATOMIC_ACQUIRE) >= DEQSIZE)
+    return -1;
+  w->buf[b & (DEQSIZE-1)] = t;
+  __atomic_store_n(&w->bottom, b + 1, __ATOMIC_RELEASE);
+  return 0;
+}
+
+// the owner takes the newest task, or 0.
+static struct task*
+pop(struct worker *w)
+{
+  long b = w->bottom - 1, t;
+  struct task *task;
+
+  __atomic_store_n(&w->bottom, b, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  t = __atomic_load_n(&w->top, __ATOMIC_RELAXED);
+  if(t > b){
+    // empty.
+    __atomic_store_n(&w->bottom, b + 1, __ATOMIC_RELAXED);
+    return 0;
+  }
+  task = w->buf[b & (DEQSIZE-1)];
+  if(t == b){
+    // the last one: race the thieves for it.
+    if(!__atomic_compare_exchange_n(&w->top, &t, t + 1, 0,
+                                    __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+      task = 0;
+    __atomic_store_n(&w->bottom, b + 1, __ATOMIC_RELAXED);
+  }
+  return task;
+}
+
+// another worker takes w's oldest task, or 0 if there is
+// none or it lost a race for it.
+static struct task*
+steal(struct worker *w)
+{
+  long t, b;
+  struct task *task;
+
+  t = __atomic_load_n(&w->top, __ATOMIC_ACQUIRE);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  b = __atomic_load_n(&w->bottom, __ATOMIC_ACQUIRE);
+  if(t >= b)
+    return 0;
+  task = w->buf[t & (DEQSIZE-1)];
+  if(!__atomic_compare_exchange_n(&w->top, &t, t + 1, 0,
+                                  __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+    return 0;
+  return task;
+}
+
+// a task for w: its own newest, or one stolen from the
+// others, starting at a random one.
+static struct task*
+findwork(struct worker *w)
+{
+  struct task *t;
+  int i, start;
+
+  if((t = pop(w)) != 0)
+    return t;
+  w->seed = w->seed * 1103515245 + 12345;
+  start = (w->seed >> 8) % rt.n;
+  for(i = 0; i < rt.n; i++){
+    if(&workers[(start + i) % rt.n] == w)
+      continue;
+    if((t = steal(&workers[(start + i) % rt.n])) != 0)
+      return t;
+  }
+  return 0;
+}
+
+static int
+anywork(void)
+{
+  int i;
+
+  for(i = 0; i < rt.n; i++)
+    if(workers[i].top < workers[i].bottom)
+      return 1;
+  return 0;
+}
+
+static void
+run(struct task *t)
+{
+  t->fn(t->arg);
+  // 1 is done; 2 means task_sync() sleeps on it.
+  if(__sync_lock_test_and_set(&t->done, 1) == 2)
+    futex_wake(&t->done, 1);
+}
+
+static void
+workerloop(void *a)
+{
+  struct worker *w = a;
+  struct task *t;
+  int spins = 0, seq;
+
+  setself(w);
+  while(!rt.stop){
+    if((t = findwork(w)) != 0){
+      run(t);
+      spins = 0;
+      continue;
+    }
+    if(++spins < SPINS)
+      continue;
+    spins = 0;
+    // sleep until task_spawn() sees us and bumps wakeseq;
+    // it pushes before it looks at sleepers, and we count
+    // ourselves before we look at the deques.
+    seq = rt.wakeseq;
+    __sync_fetch_and_add(&rt.sleepers, 1);
+    if(!anywork() && !rt.stop)
+      futex_wait(&rt.wakeseq, seq);
+    __sync_fetch_and_sub(&rt.sleepers, 1);
+  }
+}
+
+// Start n workers, or one per hart if n is 0, the caller
+// being the first. Returns the number, or -1.
+int
+task_start(int n)
+{
+  int i;
+
+  if(n <= 0)
+    n = ((volatile struct ushared *)USHARED)->ncpu;
+  if(n > NCPU)
+    n = NCPU;
+  if(n < 1)
+    n = 1;
+  memset(&rt, 0, sizeof(rt));
+  memset(workers, 0, sizeof(workers));
+  rt.n = n;
+  for(i = 0; i < n; i++)
+    workers[i].seed = i + 1;
+  setself(&workers[0]);
+  for(i = 1; i < n; i++){
+    if((workers[i].tid = thread_create(workerloop, &workers[i])) < 0){
+      rt.n = i;
+      task_stop();
+      return -1;
+    }
+  }
+  return n;
+}
+
+// Stop the workers, once the tasks are done.
+void
+task_stop(void)
+{
+  int i;
+
+  rt.stop = 1;
+  __sync_fetch_and_add(&rt.wakeseq, 1);
+  futex_wake(&rt.wakeseq, NCPU);
+  for(i = 1; i < rt.n; i++)
+    thread_join(workers[i].tid);
+  rt.n = 0;
+}
+
+// Make fn(arg) a task that another worker may run, until
+// task_sync(t). t must stay put until then.
+void
+task_spawn(struct task *t, void (*fn)(void*), void *arg)
+{
+  t->fn = fn;
+  t->arg = arg;
+  t->done = 0;
+  if(push(self(), t) < 0){
+    // the deque is full: there is plenty of work already.
+    run(t);
+    return;
+  }
+  __sync_synchronize();
+  if(rt.sleepers > 0){
+    __sync_fetch_and_add(&rt.wakeseq, 1);
+    futex_wake(&rt.wakeseq, 1);
+  }
+}
+
+// Wait for t to be done, running tasks meanwhile.
+void
+task_sync(struct task *t)
+{
+  struct worker *w = self();
+  struct task *u;
+  int spins = 0;
+
+  while(t->done != 1){
+    if((u = findwork(w)) != 0){
+      run(u);
+      spins = 0;
+      continue;
+    }
+    if(++spins < SPINS)
+      continue;
+    // a thief is running t, and nothing else is left.
+    if(__sync_bool_compare_and_swap(&t->done, 0, 2) || t->done == 2)
+      futex_wait(&t->done, 2);
+  }
+}
+
+struct forrange {
+  int lo, hi, grain;
+  void (*fn)(int, int, void*);
+  void *arg;
+};
+
+static void
+forrange(void *a)
+{
+  struct forrange *r = a, upper;
+  struct task t;
+  int mid;
+
+  if(r->hi - r->lo <= r->grain){
+    r->fn(r->lo, r->hi, r->arg);
+    return;
+  }
+  // leave the upper half to a thief, and split the lower.
+  mid = r->lo + (r->hi - r->lo) / 2;
+  upper = *r;
+  upper.lo = mid;
+  task_spawn(&t, forrange, &upper);
+  r->hi = mid;
+  forrange(r);
+  task_sync(&t);
+}
+
+// Call fn(lo', hi', arg) for pieces [lo', hi') of [lo, hi)
+// of at most grain, in parallel, and wait for all of them.
+void
+task_for(int lo, int hi, int grain, void (*fn)(int, int, void*), void *arg)
+{
+  struct forrange r;
+
+  if(grain < 1)
+    grain = 1;
+  r.lo = lo;
+  r.hi = hi;
+  r.grain = grain;
+  r.fn = fn;
+  r.arg = arg;
+  forrange(&r);
+}
@@ -0,0 +1,141 @@
+// taskbench [maxworkers]
+//
+// Time two workloads on the work-stealing tasks (task.c)
+// with 1, 2, ... maxworkers workers (default: one per hart)
+// and print the speedup over one worker:
+//
+// primes: count the primes below NPRIMES by trial division,
+//   with task_for() over blocks of numbers; the big ones
+//   take longer, which stealing evens out.
+// grep:   count the lines of a text in memory that contain
+//   a word, as grep would, with task_for() over blocks of
+//   lines.
+
+#include "kernel/types.h"
+#include "kernel/param.h"
+#include "user/user.h"
+
+#define NPRIMES 300000
+#define NLINES  40000
+#define LINELEN 64
+
+char *text;         // NLINES lines of LINELEN bytes, the last '\n'
+int nprimes, nmatch;
+uint seed = 1;
+
+int
+isprime(int n)
+{
+  int d;
+
+  if(n < 2)
+    return 0;
+  for(d = 2; d * d <= n; d++)
+    if(n % d == 0)
+      return 0;
+  return 1;
+}
+
+void
+primes(int lo, int hi, void *arg)
+{
+  int n, c = 0;
+
+  for(n = lo; n < hi; n++)
+    c += isprime(n);
+  __sync_fetch_and_add(&nprimes, c);
+}
+
+// does line s, of n bytes, contain word?
+int
+match(char *s, int n, char *word)
+{
+  int i, j;
+
+  for(i = 0; i < n; i++){
+    for(j = 0; word[j] && i + j < n && s[i+j] == word[j]; j++)
+      ;
+    if(word[j] == 0)
+      return 1;
+  }
+  return 0;
+}
+
+void
+grep(int lo, int hi, void *word)
+{
+  int i, c = 0;
+
+  for(i = lo; i < hi; i++)
+    c += match(text + i*LINELEN, LINELEN - 1, word);
+  __sync_fetch_and_add(&nmatch, c);
+}
+
+// lines of random lowercase words.
+void
+maketext(void)
+{
+  int i, j;
+
+  if((text = malloc(NLINES * LINELEN)) == 0){
+    fprintf(2, "taskbench: out of memory\n");
+    exit(1);
+  }
+  for(i = 0; i < NLINES; i++){
+    for(j = 0; j < LINELEN - 1; j++){
+      seed = seed * 1103515245 + 12345;
+      text[i*LINELEN + j] = (seed >> 8) % 6 == 0 ? ' ' : 'a' + (seed >> 12) % 8;
+    }
+    text[i*LINELEN + j] = '\n';
+  }
+}
+
+void
+report(char *what, int n, int result, uint64 t, uint64 one)
+{
+  printf("%s: %d workers: %d, %d ms, speedup %d.%d\n", what, n, result,
+         (int)(t / 1000000), (int)(one / t), (int)(one * 10 / t % 10));
+}
+
+int
+main(int argc, char *argv[])
+{
+  int n, maxn = 0;
+  uint64 t0, t, onep = 0, oneg = 0;
+
+  if(argc > 1)
+    maxn = atoi(argv[1]);
+  if((n = task_start(maxn)) < 0){
+    fprintf(2, "taskbench: task_start failed\n");
+    exit(1);
+  }
+  maxn = n;
+  task_stop();
+  maketext();
+
+  for(n = 1; n <= maxn; n++){
+    if(task_start(n) != n){
+      fprintf(2, "taskbench: task_start failed\n");
+      exit(1);
+    }
+
+    nprimes = 0;
+    t0 = nsecs();
+    task_for(0, NPRIMES, 1000, primes, 0);
+    t = nsecs() - t0;
+    if(n == 1)
+      onep = t;
+    report("primes", n, nprimes, t, onep);
+
+    nmatch = 0;
+    t0 = nsecs();
+    task_for(0, NLINES, 200, grep, "abcd");
+    t = nsecs() - t0;
+    if(n == 1)
+      oneg = t;
+    report("grep", n, nmatch, t, oneg);
+
+    task_stop();
+  }
+  exit(0);
+}
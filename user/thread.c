@@ -0,0 +1,85 @@
+#include "kernel/types.h"
+#include "kernel/param.h"
+#include "kernel/riscv.h"
+#include "user/user.h"
+
+// Threads on top of clone() and join(). Each thread gets a
+// stack from malloc(), which thread_join() frees.
+//
+// malloc() and buffered printf() are not safe to call from
+// two threads at once.
+
+#define TSTACK (4*PGSIZE)
+
+struct tstart {
+  void (*fn)(void*);
+  void *arg;
+};
+
+// the stacks of threads not joined yet.
+static struct {
+  int tid;
+  char *stack;
+} stacks[NPROC];
+
+// clone() starts the thread here, with its struct tstart
+// at the top of its stack.
+static void
+start(void *a)
+{
+  struct tstart *t = a;
+
+  t->fn(t->arg);
+  exit(0);
+}
+
+// Run fn(arg) in a new thread of this process, which ends
+// when fn returns or calls exit(). Returns its id, or -1.
+int
+thread_create(void (*fn)(void*), void *arg)
+{
+  struct tstart *t;
+  char *stack;
+  int i, tid;
+
+  if((stack = malloc(TSTACK)) == 0)
+    return -1;
+  for(i = 0; i < NPROC; i++)
+    if(__sync_bool_compare_and_swap(&stacks[i].stack, 0, stack))
+      break;
+  if(i == NPROC){
+    free(stack);
+    return -1;
+  }
+
+  t = (struct tstart*)(stack + TSTACK - 16);
+  t->fn = fn;
+  t->arg = arg;
+  if((tid = clone(start, t, t)) < 0){
+    stacks[i].stack = 0;
+    free(stack);
+    return -1;
+  }
+  stacks[i].tid = tid;
+  return tid;
+}
+
+// Wait for thread tid to end and free its stack. Returns
+// its exit status, or -1.
+int
+thread_join(int tid)
+{
+  int i, status;
+
+  if(join(tid, &status) < 0)
+    return -1;
+  for(i = 0; i < NPROC; i++){
+    if(stacks[i].stack && stacks[i].tid == tid){
+      free(stacks[i].stack);
+      stacks[i].tid = 0;
+      stacks[i].stack = 0;
+      break;
+    }
+  }
+  return status;
+}
@@ -0,0 +1,85 @@
+// threadbench [maxthreads]
+//
+// Count the primes below N by trial division, split among
+// 1, 2, ... maxthreads threads (default 4), and print how
+// long each took and the speedup over one thread. Shows
+// whether the threads really run on several harts.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+#define N 200000
+#define MAXT 16
+
+struct work {
+  int id;
+  int nthreads;
+  int count;
+  char pad[52];  // a cache line each
+} work[MAXT];
+
+int
+isprime(int n)
+{
+  int d;
+
+  if(n < 2)
+    return 0;
+  for(d = 2; d * d <= n; d++)
+    if(n % d == 0)
+      return 0;
+  return 1;
+}
+
+// every nthreads'th number, so the threads get about the
+// same amount of work.
+void
+count(void *a)
+{
+  struct work *w = a;
+  int n;
+
+  w->count = 0;
+  for(n = w->id; n < N; n += w->nthreads)
+    w->count += isprime(n);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int maxt = 4, t, i, total, tid[MAXT];
+  uint64 t0, t1, one = 0;
+
+  if(argc > 1)
+    maxt = atoi(argv[1]);
+  if(maxt < 1 || maxt > MAXT){
+    fprintf(2, "usage: threadbench [1-%d]\n", MAXT);
+    exit(1);
+  }
+
+  for(t = 1; t <= maxt; t++){
+    t0 = nsecs();
+    for(i = 0; i < t; i++){
+      work[i].id = i;
+      work[i].nthreads = t;
+      if(i > 0 && (tid[i] = thread_create(count, &work[i])) < 0){
+        fprintf(2, "threadbench: thread_create failed\n");
+        exit(1);
+      }
+    }
+    count(&work[0]);
+    total = work[0].count;
+    for(i = 1; i < t; i++){
+      thread_join(tid[i]);
+      total += work[i].count;
+    }
+    t1 = nsecs();
+    if(t == 1)
+      one = t1 - t0;
+    printf("%d threads: %d primes, %d ms, speedup %d.%d\n", t, total,
+           (int)((t1 - t0) / 1000000), (int)(one / (t1 - t0)),
+           (int)(one * 10 / (t1 - t0) % 10));
+  }
+  exit(0);
+}
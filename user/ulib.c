@@ -1,8 +1,70 @@
 #include "kernel/types.h"
 #include "kernel/stat.h"
 #include "kernel/fcntl.h"
+#include "kernel/time.h"
+#include "kernel/riscv.h"
+#include "kernel/memlayout.h"
+#include "kernel/vdso.h"
 #include "user/user.h"
 
+// the system calls behind fork(), exit(), exec() and read().
+int _fork(void);
+void _exit(int) __attribute__((noreturn));
+int _exec(char*, char**);
+int _read(int, void*, int);
+
+// printf.c sets this once it has buffered output, which
+// must be written before exit() throws it away, fork()
+// copies it, exec() replaces it, or a read() of the
+// standard input waits for an answer to a prompt.
+void (*stdioflush)(void);
+
+int
+fork(void)
+{
+  if(stdioflush)
+    stdioflush();
+  return _fork();
+}
+
+int
+exit(int status)
+{
+  if(stdioflush)
+    stdioflush();
+  _exit(status);
+}
+
+int
+exec(char *path, char **argv)
+{
+  if(stdioflush)
+    stdioflush();
+  return _exec(path, argv);
+}
+
+int
+read(int fd, void *buf, int n)
+{
+  if(fd == 0 && stdioflush)
+    stdioflush();
+  return _read(fd, buf, n);
+}
+
+// getpid() and uptime() read pages the kernel maps into
+// every process (kernel/vdso.h), instead of trapping.
+int
+getpid(void)
+{
+  return ((volatile struct usyscall *)USYSCALL)->pid;
+}
+
+int
+uptime(void)
+{
+  return ((volatile struct ushared *)USHARED)->ticks;
+}
+
 char*
 strcpy(char *s, const char *t)
 {
@@ -22,24 +84,60 @@ strcmp(const char *p, const char *q)
   return (uchar)*p - (uchar)*q;
 }
 
+// with the vector extension, which the kernel reports in
+// the USHARED page, the functions below use rvv.S for jobs
+// big enough to pay for setting up the vector unit.
+#define VECMIN 256
+
+static int
+hasvector(void)
+{
+  return (((volatile struct ushared *)USHARED)->hwcap & HWCAP_V) != 0;
+}
+
 uint
 strlen(const char *s)
 {
   int n;
 
+  if(hasvector())
+    return vstrlen(s);
   for(n = 0; s[n]; n++)
     ;
   return n;
 }
 
+#define WORD     sizeof(uint64)
+#define ALIGNED(p) (((uint64)(p) & (WORD-1)) == 0)
+
+// wmemset(), wmemmove() and wmemcmp() work 8 bytes at a time
+// once the pointers are aligned, like kernel/string.c.
 void*
-memset(void *dst, int c, uint n)
+wmemset(void *dst, int c, uint n)
 {
   char *cdst = (char *) dst;
-  int i;
-  for(i = 0; i < n; i++){
-    cdst[i] = c;
+  uint64 w, *wdst;
+
+  while(n > 0 && !ALIGNED(cdst)){
+    *cdst++ = c;
+    n--;
+  }
+
+  w = (uchar)c;
+  w |= w << 8;
+  w |= w << 16;
+  w |= w << 32;
+  wdst = (uint64 *) cdst;
+  for(; n >= 8*WORD; n -= 8*WORD, wdst += 8){
+    wdst[0] = w; wdst[1] = w; wdst[2] = w; wdst[3] = w;
+    wdst[4] = w; wdst[5] = w; wdst[6] = w; wdst[7] = w;
   }
+  for(; n >= WORD; n -= WORD)
+    *wdst++ = w;
+
+  cdst = (char *) wdst;
+  while(n-- > 0)
+    *cdst++ = c;
   return dst;
 }
 
@@ -97,29 +195,103 @@ atoi(const char *s)
 
 // 将vsrc的n的字节拷贝给vdst
 void*
-memmove(void *vdst, const void *vsrc, int n)
+memset(void *dst, int c, uint n)
+{
+  if(n >= VECMIN && hasvector()){
+    vmemset(dst, c, n);
+    return dst;
+  }
+  return wmemset(dst, c, n);
+}
+
+void*
+wmemmove(void *vdst, const void *vsrc, int n)
 {
   char *dst;
   const char *src;
+  uint64 *wdst, a, b, c, d;
+  const uint64 *wsrc;
+  int words;
 
+  // n is compared with sizeofs below, which are unsigned.
+  if(n <= 0)
+    return vdst;
   dst = vdst;
   src = vsrc;
+  words = (((uint64)src ^ (uint64)dst) & (WORD-1)) == 0;
   if (src > dst) {
+    if (words) {
+      while (n > 0 && !ALIGNED(dst)) {
+        *dst++ = *src++;
+        n--;
+      }
+      wdst = (uint64 *) dst;
+      wsrc = (const uint64 *) src;
+      for (; n >= 4*WORD; n -= 4*WORD, wsrc += 4, wdst += 4) {
+        a = wsrc[0]; b = wsrc[1]; c = wsrc[2]; d = wsrc[3];
+        wdst[0] = a; wdst[1] = b; wdst[2] = c; wdst[3] = d;
+      }
+      for (; n >= WORD; n -= WORD)
+        *wdst++ = *wsrc++;
+      dst = (char *) wdst;
+      src = (const char *) wsrc;
+    }
     while(n-- > 0)
       *dst++ = *src++;
   } else {
     dst += n;
     src += n;
+    if (words) {
+      while (n > 0 && !ALIGNED(dst)) {
+        *--dst = *--src;
+        n--;
+      }
+      wdst = (uint64 *) dst;
+      wsrc = (const uint64 *) src;
+      for (; n >= 4*WORD; n -= 4*WORD) {
+        wsrc -= 4, wdst -= 4;
+        a = wsrc[3]; b = wsrc[2]; c = wsrc[1]; d = wsrc[0];
+        wdst[3] = a; wdst[2] = b; wdst[1] = c; wdst[0] = d;
+      }
+      for (; n >= WORD; n -= WORD)
+        *--wdst = *--wsrc;
+      dst = (char *) wdst;
+      src = (const char *) wsrc;
+    }
     while(n-- > 0)
       *--dst = *--src;
   }
   return vdst;
 }
 
+void*
+memmove(void *vdst, const void *vsrc, int n)
+{
+  // the vector copy only goes forwards.
+  if(n >= VECMIN && hasvector() &&
+     ((char*)vdst < (char*)vsrc || (char*)vdst >= (char*)vsrc + n)){
+    vmemcpy(vdst, vsrc, n);
+    return vdst;
+  }
+  return wmemmove(vdst, vsrc, n);
+}
+
 int
-memcmp(const void *s1, const void *s2, uint n)
+wmemcmp(const void *s1, const void *s2, uint n)
 {
   const char *p1 = s1, *p2 = s2;
+
+  if ((((uint64)p1 ^ (uint64)p2) & (WORD-1)) == 0) {
+    while (n > 0 && !ALIGNED(p1)) {
+      if (*p1 != *p2)
+        return *p1 - *p2;
+      p1++, p2++, n--;
+    }
+    // skip equal words; the bytes below find the difference.
+    for (; n >= WORD; n -= WORD, p1 += WORD, p2 += WORD)
+      if (*(uint64 *)p1 != *(uint64 *)p2)
+        break;
+  }
   while (n-- > 0) {
     if (*p1 != *p2) {
       return *p1 - *p2;
@@ -130,8 +302,107 @@ memcmp(const void *s1, const void *s2, uint n)
   return 0;
 }
 
+int
+memcmp(const void *s1, const void *s2, uint n)
+{
+  if(n >= VECMIN && hasvector())
+    return vmemcmp(s1, s2, n);
+  return wmemcmp(s1, s2, n);
+}
+
 void *
 memcpy(void *dst, const void *src, uint n)
 {
   return memmove(dst, src, n);
 }
+
+// nanoseconds since boot, for timing things.
+uint64
+nsecs(void)
+{
+  struct timespec ts;
+
+  if(clock_gettime(&ts) < 0)
+    return 0;
+  return ts.sec * 1000000000 + ts.nsec;
+}
+
+// this hart's cycle counter; the kernel lets user mode
+// read it (scounteren.CY). not comparable across harts.
+uint64
+cycles(void)
+{
+  uint64 x;
+
+  asm volatile("csrr %0, cycle" : "=r" (x));
+  return x;
+}
+
+// Locks for threads (thread.c) or processes sharing memory.
+// Uncontended, mutex_lock() and mutex_unlock() are one
+// atomic instruction each; a thread only makes a system
+// call to sleep on a lock that is held (futex_wait()) or
+// to wake one that sleeps (futex_wake()). m->state is 0
+// when unlocked, 1 when locked, and 2 when locked and
+// someone may be sleeping on it.
+void
+mutex_lock(struct mutex *m)
+{
+  int c;
+
+  if((c = __sync_val_compare_and_swap(&m->state, 0, 1)) == 0)
+    return;
+  // say we are waiting, and sleep until it is unlocked.
+  if(c != 2)
+    c = __sync_lock_test_and_set(&m->state, 2);
+  while(c != 0){
+    futex_wait(&m->state, 2);
+    c = __sync_lock_test_and_set(&m->state, 2);
+  }
+}
+
+// returns 0 if m was already locked.
+int
+mutex_trylock(struct mutex *m)
+{
+  return __sync_bool_compare_and_swap(&m->state, 0, 1);
+}
+
+void
+mutex_unlock(struct mutex *m)
+{
+  if(__sync_fetch_and_sub(&m->state, 1) != 1){
+    __sync_lock_release(&m->state);
+    futex_wake(&m->state, 1);
+  }
+}
+
+// Wait for cond_signal() or cond_broadcast() on c, with m
+// unlocked meanwhile. Wakeups can be spurious, so callers
+// check their condition in a loop.
+void
+cond_wait(struct cond *c, struct mutex *m)
+{
+  int seq = c->seq;
+
+  mutex_unlock(m);
+  futex_wait(&c->seq, seq);
+  // others may be waiting for m too, having been woken by
+  // the same broadcast: take it as contended.
+  while(__sync_lock_test_and_set(&m->state, 2) != 0)
+    futex_wait(&m->state, 2);
+}
+
+void
+cond_signal(struct cond *c)
+{
+  __sync_fetch_and_add(&c->seq, 1);
+  futex_wake(&c->seq, 1);
+}
+
+void
+cond_broadcast(struct cond *c)
+{
+  __sync_fetch_and_add(&c->seq, 1);
+  futex_wake(&c->seq, 0x7fffffff);
+}
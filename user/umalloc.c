@@ -2,89 +2,222 @@
 #include "kernel/stat.h"
 #include "user/user.h"
 #include "kernel/param.h"
+#include "kernel/riscv.h"
 
-// Memory allocator by Kernighan and Ritchie,
-// The C programming Language, 2nd ed.  Section 8.7.
+// Memory allocator with size classes.
+//
+// Memory comes from sbrk() in page-aligned runs of pages.
+// Every page malloc() hands out memory from starts with a
+// struct page, so free(ap) finds it at PGROUNDDOWN(ap):
+//
+// * small blocks (up to MAXSMALL bytes) come from slabs: a
+//   page divided into blocks of one size class, with a list
+//   of its free blocks. Each class keeps a list of the slabs
+//   that have a free block, so malloc() and free() of small
+//   blocks take constant time. A slab whose blocks are all
+//   free goes back to the free runs, unless it is the last
+//   one of its class and there are no free pages below it.
+// * a large block is a run of its own, with the header in
+//   its first page.
+// * free runs are kept in address order and merged with
+//   their neighbours; once there are TRIMPAGES or more free
+//   at the top of the heap, they go back to the kernel.
 
-typedef long Align;
+#define HDRSIZE   48      // sizeof(struct page), rounded up to 16
+#define MAXSMALL  1024
+#define NCLASS    11
+#define LARGE     NCLASS  // page.cls of a large block
+#define FREERUN   (NCLASS+1) // page.cls of a free run
+#define GROWPAGES 8       // get at least this many pages from sbrk()
+#define TRIMPAGES 16
 
-union header {
-  struct {
-    union header *ptr;
-    uint size;
-  } s;
-  Align x;
+struct page {
+  int cls;              // size class, LARGE or FREERUN
+  int nfree;            // slab: free blocks
+  uint npages;          // large block or free run: pages
+  void *free;           // slab: its free blocks
+  struct page *next;    // slab with free blocks, or free run
+  struct page *prev;
 };
 
-typedef union header Header;
+static uint classes[NCLASS] = {
+  16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 1024
+};
+static struct page *partial[NCLASS]; // slabs with free blocks
+static struct page *runs;            // free runs, in address order
+
+// the size class for n bytes, n <= MAXSMALL.
+static int
+sizeclass(uint n)
+{
+  int c;
+
+  for(c = 0; classes[c] < n; c++)
+    ;
+  return c;
+}
+
+static void
+drop(struct page **list, struct page *pg)
+{
+  if(pg->prev)
+    pg->prev->next = pg->next;
+  else
+    *list = pg->next;
+  if(pg->next)
+    pg->next->prev = pg->prev;
+}
+
+static void
+push(struct page **list, struct page *pg)
+{
+  pg->prev = 0;
+  pg->next = *list;
+  if(*list)
+    (*list)->prev = pg;
+  *list = pg;
+}
+
+// give npages at pg back to the free runs, merging it with
+// its neighbours, and the top of the heap back to the kernel.
+static void
+putpages(struct page *pg, uint npages)
+{
+  struct page *p, *prev = 0;
+
+  pg->cls = FREERUN;
+  pg->npages = npages;
+  for(p = runs; p && p < pg; p = p->next)
+    prev = p;
+  pg->prev = prev;
+  pg->next = p;
+  if(prev)
+    prev->next = pg;
+  else
+    runs = pg;
+  if(p)
+    p->prev = pg;
+
+  if(p && (char*)pg + pg->npages*PGSIZE == (char*)p){
+    pg->npages += p->npages;
+    drop(&runs, p);
+  }
+  if(prev && (char*)prev + prev->npages*PGSIZE == (char*)pg){
+    prev->npages += pg->npages;
+    drop(&runs, pg);
+    pg = prev;
+  }
+
+  // sbrk() could have been called by someone else since.
+  if(pg->npages >= TRIMPAGES && (char*)pg + pg->npages*PGSIZE == sbrk(0)){
+    drop(&runs, pg);
+    sbrk(-(int)(pg->npages*PGSIZE));
+  }
+}
+
+// npages contiguous pages, first fit, or 0.
+static struct page*
+getpages(uint64 npages)
+{
+  struct page *pg;
+  char *p;
+  uint n, pad;
+
+  for(pg = runs; pg; pg = pg->next){
+    if(pg->npages >= npages){
+      drop(&runs, pg);
+      if(pg->npages > npages)
+        putpages((struct page*)((char*)pg + npages*PGSIZE), pg->npages - npages);
+      pg->npages = npages;
+      return pg;
+    }
+  }
 
-static Header base;
-static Header *freep;
+  n = npages > GROWPAGES ? npages : GROWPAGES;
+  p = sbrk(0);
+  pad = PGROUNDUP((uint64)p) - (uint64)p;
+  if(npages > (1 << 18) || (p = sbrk(n*PGSIZE + pad)) == (char*)-1)
+    return 0;
+  pg = (struct page*)(p + pad);
+  if(n > npages)
+    putpages((struct page*)((char*)pg + npages*PGSIZE), n - npages);
+  pg->npages = npages;
+  return pg;
+}
 
 void
 free(void *ap)
 {
-  Header *bp, *p;
-
-  bp = (Header*)ap - 1;
-  for(p = freep; !(bp > p && bp < p->s.ptr); p = p->s.ptr)
-    if(p >= p->s.ptr && (bp > p || bp < p->s.ptr))
-      break;
-  if(bp + bp->s.size == p->s.ptr){
-    bp->s.size += p->s.ptr->s.size;
-    bp->s.ptr = p->s.ptr->s.ptr;
-  } else
-    bp->s.ptr = p->s.ptr;
-  if(p + p->s.size == bp){
-    p->s.size += bp->s.size;
-    p->s.ptr = bp->s.ptr;
-  } else
-    p->s.ptr = bp;
-  freep = p;
+  struct page *pg;
+  void **b = ap;
+  int c;
+
+  if(ap == 0)
+    return;
+  pg = (struct page*)PGROUNDDOWN((uint64)ap);
+  if(pg->cls == LARGE){
+    putpages(pg, pg->npages);
+    return;
+  }
+
+  c = pg->cls;
+  *b = pg->free;
+  pg->free = b;
+  if(pg->nfree++ == 0)
+    push(&partial[c], pg);
+  // keep the class's last slab, so that malloc(); free();
+  // in a loop doesn't get and put a page each time, unless
+  // there are free pages below it: newslab() will use those,
+  // which lets the top of the heap be trimmed.
+  if(pg->nfree == (PGSIZE - HDRSIZE) / classes[c] &&
+     (pg->prev || pg->next || (runs && runs < pg))){
+    drop(&partial[c], pg);
+    putpages(pg, 1);
+  }
 }
 
-static Header*
-morecore(uint nu)
+// a new slab of class c, or 0.
+static struct page*
+newslab(int c)
 {
-  char *p;
-  Header *hp;
+  struct page *pg;
+  char *b;
+  int i, n = (PGSIZE - HDRSIZE) / classes[c];
 
-  if(nu < 4096)
-    nu = 4096;
-  p = sbrk(nu * sizeof(Header));
-  if(p == (char*)-1)
+  if((pg = getpages(1)) == 0)
     return 0;
-  hp = (Header*)p;
-  hp->s.size = nu;
-  free((void*)(hp + 1));
-  return freep;
+  pg->cls = c;
+  pg->nfree = n;
+  pg->free = 0;
+  b = (char*)pg + HDRSIZE + (n-1)*classes[c];
+  for(i = 0; i < n; i++, b -= classes[c]){
+    *(void**)b = pg->free;
+    pg->free = b;
+  }
+  push(&partial[c], pg);
+  return pg;
 }
 
 void*
 malloc(uint nbytes)
 {
-  Header *p, *prevp;
-  uint nunits;
+  struct page *pg;
+  void **b;
+  int c;
 
-  nunits = (nbytes + sizeof(Header) - 1)/sizeof(Header) + 1;
-  if((prevp = freep) == 0){
-    base.s.ptr = freep = prevp = &base;
-    base.s.size = 0;
-  }
-  for(p = prevp->s.ptr; ; prevp = p, p = p->s.ptr){
-    if(p->s.size >= nunits){
-      if(p->s.size == nunits)
-        prevp->s.ptr = p->s.ptr;
-      else {
-        p->s.size -= nunits;
-        p += p->s.size;
-        p->s.size = nunits;
-      }
-      freep = prevp;
-      return (void*)(p + 1);
-    }
-    if(p == freep)
-      if((p = morecore(nunits)) == 0)
-        return 0;
+  if(nbytes > MAXSMALL){
+    if((pg = getpages(((uint64)nbytes + HDRSIZE + PGSIZE - 1) / PGSIZE)) == 0)
+      return 0;
+    pg->cls = LARGE;
+    return (char*)pg + HDRSIZE;
   }
+
+  c = sizeclass(nbytes);
+  if((pg = partial[c]) == 0 && (pg = newslab(c)) == 0)
+    return 0;
+  b = pg->free;
+  pg->free = *b;
+  if(--pg->nfree == 0)
+    drop(&partial[c], pg);
+  return b;
 }
@@ -0,0 +1,147 @@
+// uringbench
+//
+// Time NOPS 512-byte reads of a cached file, and NOPS 512-byte
+// writes to a file, made one system call at a time and then
+// through the submission and completion queues (uring.c),
+// BATCH per uring_enter(), with 1, 2 and 4 kernel threads.
+// Prints nanoseconds per operation.
+
+#include "kernel/types.h"
+#include "kernel/fcntl.h"
+#include "kernel/uring.h"
+#include "user/user.h"
+
+#define NOPS   4096
+#define BLKSZ  512
+#define FILESZ (64*1024)
+#define BATCH  32
+
+char buf[BATCH][BLKSZ];
+
+void
+report(char *what, uint64 ns)
+{
+  printf("%s: %d ns per op\n", what, (int)(ns / NOPS));
+}
+
+// make file name FILESZ bytes long, and return an fd of it
+// open for mode.
+int
+makefile(char *name, int mode)
+{
+  int fd, i;
+
+  unlink(name);
+  if((fd = open(name, O_CREATE|O_RDWR)) < 0){
+    fprintf(2, "uringbench: can't create %s\n", name);
+    exit(1);
+  }
+  for(i = 0; i < FILESZ; i += BLKSZ)
+    write(fd, buf[0], BLKSZ);
+  close(fd);
+  return open(name, mode);
+}
+
+uint64
+bysyscalls(int fd, int writing)
+{
+  uint64 t0 = nsecs();
+  int i;
+
+  for(i = 0; i < NOPS; i++){
+    if(i % (FILESZ / BLKSZ) == 0){
+      // back to the start.
+      close(fd);
+      fd = open("uringbench.tmp", writing ? O_WRONLY : O_RDONLY);
+    }
+    if((writing ? write(fd, buf[0], BLKSZ) : read(fd, buf[0], BLKSZ)) != BLKSZ){
+      fprintf(2, "uringbench: read/write failed\n");
+      exit(1);
+    }
+  }
+  close(fd);
+  return nsecs() - t0;
+}
+
+// NOPS operations through r, BATCH at a time.
+uint64
+byring(struct uringpage *r, int fd, int writing)
+{
+  uint64 t0 = nsecs();
+  struct usqe *e;
+  struct ucqe *c;
+  int i, j;
+
+  for(i = 0; i < NOPS; i += BATCH){
+    for(j = 0; j < BATCH; j++){
+      e = &r->sq[(r->sqtail + j) % URINGSIZE];
+      e->op = writing ? UR_WRITE : UR_READ;
+      e->fd = fd;
+      e->addr = (uint64)buf[j];
+      e->off = (uint64)(i + j) * BLKSZ % FILESZ;
+      e->len = BLKSZ;
+      e->data = j;
+    }
+    __atomic_store_n(&r->sqtail, r->sqtail + BATCH, __ATOMIC_RELEASE);
+    for(j = 0; j < BATCH; ){
+      if(uring_enter(BATCH, BATCH) < 0){
+        fprintf(2, "uringbench: uring_enter failed\n");
+        exit(1);
+      }
+      while(r->cqhead != __atomic_load_n(&r->cqtail, __ATOMIC_ACQUIRE)){
+        c = &r->cq[r->cqhead % URINGSIZE];
+        if(c->res != BLKSZ){
+          fprintf(2, "uringbench: op %d returned %d\n", (int)c->data, c->res);
+          exit(1);
+        }
+        __atomic_store_n(&r->cqhead, r->cqhead + 1, __ATOMIC_RELEASE);
+        j++;
+      }
+    }
+  }
+  return nsecs() - t0;
+}
+
+// in a child, since a process sets up its queues only once.
+void
+ringrun(int nworkers)
+{
+  struct uringpage *r;
+  char what[32];
+  int fd, pid, xstatus;
+
+  if((pid = fork()) < 0){
+    fprintf(2, "uringbench: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    if((r = uring_setup(nworkers)) == (struct uringpage*)-1){
+      fprintf(2, "uringbench: uring_setup failed\n");
+      exit(1);
+    }
+    fd = open("uringbench.tmp", O_RDWR);
+    strcpy(what, "ring read,  x threads");
+    what[12] = '0' + nworkers;
+    report(what, byring(r, fd, 0));
+    strcpy(what, "ring write, x threads");
+    what[12] = '0' + nworkers;
+    report(what, byring(r, fd, 1));
+    exit(0);
+  }
+  wait(&xstatus);
+  if(xstatus != 0)
+    exit(1);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int n;
+
+  report("read() ", bysyscalls(makefile("uringbench.tmp", O_RDONLY), 0));
+  report("write()", bysyscalls(open("uringbench.tmp", O_WRONLY), 1));
+  for(n = 1; n <= URINGWORKERS; n *= 2)
+    ringrun(n);
+  unlink("uringbench.tmp");
+  exit(0);
+}
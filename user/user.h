@@ -1,5 +1,27 @@
 struct stat;
 struct rtcdate;
+struct timespec;
+struct lockstat;
+struct tracerec;
+struct syslat;
+struct pollfd;
+struct epoll_event;
+
+// ulib.c: locks for threads, on futex_wait() and
+// futex_wake(). Zero-initialized is unlocked.
+struct mutex {
+  int state;  // 0 unlocked, 1 locked, 2 locked with waiters
+};
+struct cond {
+  int seq;    // changed by every signal
+};
+
+// task.c: a task made by task_spawn().
+struct task {
+  void (*fn)(void*);
+  void *arg;
+  int done;   // 0 not yet, 1 done, 2 not yet and task_sync() sleeps
+};
 
 // system calls
 int fork(void);
@@ -19,12 +41,44 @@ int link(const char*, const char*);
 int mkdir(const char*);
 int chdir(const char*);
 int dup(int);
-int getpid(void);
 char* sbrk(int);
 int sleep(int);
-int uptime(void);
+int clock_gettime(struct timespec*);
+int nanosleep(const struct timespec*);
+int getlockstat(struct lockstat*, int);
+int resetlockstat(void);
+int trace(uint64);
+int traceread(struct tracerec*, int);
+int getsyslat(struct syslat*, int);
+int resetsyslat(void);
+void* mmap(void*, uint64, int, int, int, uint64);
+int munmap(void*, uint64);
+int clone(void(*)(void*), void*, void*);
+int join(int, int*);
+int futex_wait(int*, int);
+int futex_wake(int*, int);
+int memfd(uint64);
+struct uringpage* uring_setup(int);
+int uring_enter(int, int);
+int pipe2(int*, int);
+int poll(struct pollfd*, int, int);
+int epoll_create(void);
+int epoll_ctl(int, int, int, struct epoll_event*);
+int epoll_wait(int, struct epoll_event*, int, int);
+int socket(int, int);
+int bind(int, const char*);
+int listen(int, int);
+int accept(int);
+int connect(int, const char*);
+
+// setvbuf() modes (printf.c)
+#define _IONBF 1  // write at the end of each call
+#define _IOLBF 2  // write at each newline
+#define _IOFBF 3  // write when the buffer is full
 
 // ulib.c
+int getpid(void);
+int uptime(void);
 int stat(const char*, struct stat*);
 char* strcpy(char*, const char*);
 void *memmove(void*, const void*, int);
@@ -32,6 +86,9 @@ char* strchr(const char*, char c);
 int strcmp(const char*, const char*);
 void fprintf(int, const char*, ...);
 void printf(const char*, ...);
+int fwrite(int, const void*, int);
+void fflush(int);
+void setvbuf(int, int);
 char* gets(char*, int max);
 uint strlen(const char*);
 void* memset(void*, int, uint);
@@ -40,3 +97,31 @@ void free(void*);
 int atoi(const char*);
 int memcmp(const void *, const void *, uint);
 void *memcpy(void *, const void *, uint);
+uint64 nsecs(void);
+uint64 cycles(void);
+void mutex_lock(struct mutex*);
+int mutex_trylock(struct mutex*);
+void mutex_unlock(struct mutex*);
+void cond_wait(struct cond*, struct mutex*);
+void cond_signal(struct cond*);
+void cond_broadcast(struct cond*);
+void* wmemset(void*, int, uint);
+void* wmemmove(void*, const void*, int);
+int wmemcmp(const void*, const void*, uint);
+
+// thread.c
+int thread_create(void(*)(void*), void*);
+int thread_join(int);
+
+// task.c
+int task_start(int);
+void task_stop(void);
+void task_spawn(struct task*, void(*)(void*), void*);
+void task_sync(struct task*);
+void task_for(int, int, int, void(*)(int, int, void*), void*);
+
+// rvv.S; only with vectors (USHARED hwcap & HWCAP_V)
+void vmemcpy(void*, const void*, uint);
+void vmemset(void*, int, uint);
+int vmemcmp(const void*, const void*, uint);
+uint vstrlen(const char*);
@@ -7,6 +7,14 @@
 #include "kernel/syscall.h"
 #include "kernel/memlayout.h"
 #include "kernel/riscv.h"
+#include "kernel/time.h"
+#include "kernel/trace.h"
+#include "kernel/syslat.h"
+#include "kernel/uring.h"
+#include "kernel/poll.h"
+#include "kernel/epoll.h"
+#include "kernel/socket.h"
+#include "kernel/vdso.h"
 
 //
 // Tests xv6 system calls.  usertests without arguments runs them all
@@ -2526,6 +2534,1424 @@ execout(char *s)
   exit(0);
 }
 
+// does nanosleep() sleep at least as long as asked, and does
+// it wake up well before the next clock tick would have?
+void
+nanosleeptest(char *s)
+{
+  struct timespec t0, t1, req;
+  uint64 ns, best = ~0L;
+
+  req.sec = 0;
+  req.nsec = 1000000000;
+  if(nanosleep(&req) != -1){
+    printf("%s: nanosleep accepted nsec=%l\n", s, req.nsec);
+    exit(1);
+  }
+
+  req.nsec = 2000000; // 2 ms
+  for(int i = 0; i < 10; i++){
+    clock_gettime(&t0);
+    if(nanosleep(&req) < 0){
+      printf("%s: nanosleep failed\n", s);
+      exit(1);
+    }
+    clock_gettime(&t1);
+    if(t1.sec < t0.sec || (t1.sec == t0.sec && t1.nsec < t0.nsec)){
+      printf("%s: clock_gettime went backwards\n", s);
+      exit(1);
+    }
+    ns = (t1.sec - t0.sec) * 1000000000 + t1.nsec - t0.nsec;
+    if(ns < req.nsec){
+      printf("%s: slept %l ns, wanted %l\n", s, ns, req.nsec);
+      exit(1);
+    }
+    if(ns < best)
+      best = ns;
+  }
+
+  // a clock tick is about 100 ms in qemu.
+  if(best >= 50000000){
+    printf("%s: nanosleep took %l ns for a 2 ms sleep\n", s, best);
+    exit(1);
+  }
+
+  exit(0);
+}
+
+// are traced system calls, and only those, recorded with
+// their arguments and return values?
+void
+tracetest(char *s)
+{
+  struct tracerec r[16];
+  int n, i, pid, found = 0;
+
+  while(traceread(r, sizeof(r)/sizeof(r[0])) > 0)
+    ;
+  pid = getpid();
+  trace(1L << SYS_dup);
+  close(dup(1));
+  trace(0);
+
+  while((n = traceread(r, sizeof(r)/sizeof(r[0]))) > 0){
+    for(i = 0; i < n; i++){
+      if(r[i].pid != pid)
+        continue;
+      if(r[i].num != SYS_dup){
+        printf("%s: untraced call %d recorded\n", s, r[i].num);
+        exit(1);
+      }
+      if(r[i].args[0] != 1 || (long)r[i].ret < 0 || r[i].texit < r[i].tenter){
+        printf("%s: bad dup record\n", s);
+        exit(1);
+      }
+      found++;
+    }
+  }
+  if(found != 1){
+    printf("%s: %d dup records, wanted 1\n", s, found);
+    exit(1);
+  }
+  exit(0);
+}
+
+// do the latency histograms count calls, and do
+// their buckets add up?
+void
+syslattest(char *s)
+{
+  static struct syslat st[NSYSLAT]; // too big for the stack
+  uint64 before, sum;
+  int i, b;
+
+  if(getsyslat(st, NSYSLAT) != NSYSLAT){
+    printf("%s: getsyslat failed\n", s);
+    exit(1);
+  }
+  before = st[SYS_close].count;
+  for(i = 0; i < 100; i++)
+    close(-1);
+  getsyslat(st, NSYSLAT);
+  if(st[SYS_close].count < before + 100){
+    printf("%s: %d close calls counted, wanted 100\n", s,
+           (int)(st[SYS_close].count - before));
+    exit(1);
+  }
+  for(i = 0; i < NSYSLAT; i++){
+    sum = 0;
+    for(b = 0; b < NLATBUCKET; b++)
+      sum += st[i].bucket[b];
+    // other harts may be updating while we read.
+    if(sum + 8 < st[i].count || sum > st[i].count + 8){
+      printf("%s: call %d has %d calls but %d in buckets\n", s,
+             i, (int)st[i].count, (int)sum);
+      exit(1);
+    }
+  }
+  exit(0);
+}
+
+// do getpid() and uptime(), which read pages the kernel maps
+// instead of trapping, agree with the kernel, and are those
+// pages read-only?
+void
+vdsotest(char *s)
+{
+  int pid, xstatus, fds[2];
+  char buf[8];
+  uint t0;
+
+  if(((struct ushared *)USHARED)->mtimefreq != MTIME_FREQ){
+    printf("%s: bad mtimefreq\n", s);
+    exit(1);
+  }
+
+  if(pipe(fds) < 0){
+    printf("%s: pipe failed\n", s);
+    exit(1);
+  }
+  pid = fork();
+  if(pid < 0){
+    printf("%s: fork failed\n", s);
+    exit(1);
+  }
+  if(pid == 0){
+    pid = getpid();
+    write(fds[1], &pid, sizeof(pid));
+    exit(0);
+  }
+  if(read(fds[0], buf, sizeof(int)) != sizeof(int) || *(int*)buf != pid){
+    printf("%s: child's getpid() isn't what fork() returned\n", s);
+    exit(1);
+  }
+  wait(0);
+  close(fds[0]);
+  close(fds[1]);
+
+  t0 = uptime();
+  sleep(2);
+  if(uptime() < t0 + 2){
+    printf("%s: uptime() didn't advance\n", s);
+    exit(1);
+  }
+
+  // writing either page should kill the process.
+  for(int i = 0; i < 2; i++){
+    pid = fork();
+    if(pid < 0){
+      printf("%s: fork failed\n", s);
+      exit(1);
+    }
+    if(pid == 0){
+      *(volatile int *)(i ? USHARED : USYSCALL) = 1;
+      exit(0);
+    }
+    wait(&xstatus);
+    if(xstatus != -1){
+      printf("%s: wrote a read-only page\n", s);
+      exit(1);
+    }
+  }
+  exit(0);
+}
+
+// check the word-at-a-time memmove(), memset() and memcmp()
+// against byte loops, for every alignment and overlap.
+void
+memopstest(char *s)
+{
+  static char a[96], b[96], ref[96];
+  int n, so, doff, i, c;
+
+  for(n = 0; n <= 40; n++){
+    for(so = 0; so < 16; so++){
+      for(doff = 0; doff < 16; doff++){
+        for(i = 0; i < sizeof(a); i++)
+          a[i] = ref[i] = i * 7;
+        // overlapping move within a, and a reference copy.
+        for(i = 0; i < n; i++)
+          b[i] = ref[so + 20 + i];
+        for(i = 0; i < n; i++)
+          ref[doff + 20 + i] = b[i];
+        memmove(a + doff + 20, a + so + 20, n);
+        if(memcmp(a, ref, sizeof(a)) != 0){
+          printf("%s: memmove n=%d src+%d dst+%d wrong\n", s, n, so, doff);
+          exit(1);
+        }
+
+        memset(a + doff, 0xa5, n + so);
+        for(i = 0; i < sizeof(a); i++){
+          c = (i >= doff && i < doff + n + so) ? 0xa5 : ref[i];
+          if((a[i] & 0xff) != (c & 0xff)){
+            printf("%s: memset n=%d at %d wrong\n", s, n + so, doff);
+            exit(1);
+          }
+        }
+      }
+    }
+  }
+
+  for(i = 0; i < sizeof(a); i++)
+    a[i] = b[i] = i;
+  for(so = 0; so < 8; so++){
+    for(i = so; i < 64; i++){
+      b[i] = a[i] + 1;
+      if(memcmp(a + so, b + so, 64) >= 0 || memcmp(b + so, a + so, 64) <= 0 ||
+         memcmp(a + so, b + so, i - so) != 0){
+        printf("%s: memcmp wrong at %d+%d\n", s, so, i);
+        exit(1);
+      }
+      b[i] = a[i];
+    }
+  }
+  exit(0);
+}
+
+// do FP registers survive switches between processes that
+// use them, and do the vector routines match the word ones?
+void
+xregstest(char *s)
+{
+  static char a[1100], b[1100];
+  int pid, i, n, off, xstatus;
+  double x, start;
+
+  for(i = 0; i < 4; i++){
+    pid = fork();
+    if(pid < 0){
+      printf("%s: fork failed\n", s);
+      exit(1);
+    }
+    if(pid == 0){
+      start = x = getpid() * 0.5;
+      for(n = 0; n < 40; n++){
+        x = x + 1.0;
+        if(n % 8 == 0)
+          sleep(1);
+      }
+      exit(x == start + 40.0 ? 0 : 1);
+    }
+  }
+  for(i = 0; i < 4; i++){
+    wait(&xstatus);
+    if(xstatus != 0){
+      printf("%s: lost FP registers\n", s);
+      exit(1);
+    }
+  }
+
+  if((((struct ushared *)USHARED)->hwcap & HWCAP_V) == 0)
+    exit(0);
+  for(n = 0; n < 1024; n += 61){
+    for(off = 0; off < 8; off++){
+      for(i = 0; i < sizeof(a); i++)
+        a[i] = i * 3, b[i] = 0;
+      vmemcpy(b + off, a, n);
+      if(wmemcmp(b + off, a, n) != 0 || vmemcmp(b + off, a, n) != 0){
+        printf("%s: vmemcpy %d wrong\n", s, n);
+        exit(1);
+      }
+      b[off + n/2] ^= 0x80;
+      if(n > 0 && (vmemcmp(b + off, a, n) < 0) != (wmemcmp(b + off, a, n) < 0)){
+        printf("%s: vmemcmp %d wrong\n", s, n);
+        exit(1);
+      }
+      vmemset(a + off, 'x', n);
+      a[off + n] = 0;
+      if(vstrlen(a + off) != n){
+        printf("%s: vstrlen %d wrong\n", s, n);
+        exit(1);
+      }
+    }
+  }
+  exit(0);
+}
+
+// copyin() and copyout() go straight to user memory through
+// the process's kernel page table; a buffer or string that
+// runs off the end of memory must still fail cleanly.
+void
+ucopytest(char *s)
+{
+  char *top, *p;
+  int fd, fds[2], n;
+
+  // the last page of memory is mapped up to its end.
+  top = (char*)PGROUNDUP((uint64)sbrk(0));
+  p = top - 100;
+  memset(p, 'u', 100);
+
+  fd = open("ucopy1", O_CREATE|O_WRONLY);
+  if(fd < 0){
+    printf("%s: open failed\n", s);
+    exit(1);
+  }
+  if((n = write(fd, p, 200)) >= 0){
+    printf("%s: write past end of memory returned %d\n", s, n);
+    exit(1);
+  }
+  if((n = write(fd, p, 100)) != 100){
+    printf("%s: write to end of memory returned %d\n", s, n);
+    exit(1);
+  }
+  close(fd);
+
+  fd = open("ucopy1", O_RDONLY);
+  if((n = read(fd, p + 50, 100)) > 0){
+    printf("%s: read past end of memory returned %d\n", s, n);
+    exit(1);
+  }
+  close(fd);
+  unlink("ucopy1");
+
+  if(pipe(fds) < 0){
+    printf("%s: pipe failed\n", s);
+    exit(1);
+  }
+  if(write(fds[1], "abc", 3) != 3 || read(fds[0], p + 97, 3) != 3 ||
+     memcmp(p + 97, "abc", 3) != 0){
+    printf("%s: pipe to end of memory failed\n", s);
+    exit(1);
+  }
+  close(fds[0]);
+  close(fds[1]);
+
+  // no terminating 0 before the end of memory.
+  if(open(p, O_RDONLY) >= 0 || unlink(p) >= 0){
+    printf("%s: unterminated path accepted\n", s);
+    exit(1);
+  }
+  p[99] = 0;
+  if(open(p, O_RDONLY) >= 0){
+    printf("%s: open of missing file succeeded\n", s);
+    exit(1);
+  }
+}
+
+// with ASIDs the TLB keeps a process's entries across traps
+// and context switches; memory given back with sbrk() must
+// still become unreachable at once, and come back zeroed.
+void
+tlbtest(char *s)
+{
+  char *a;
+  int i, round, pid, xstatus;
+
+  for(round = 0; round < 8; round++){
+    a = sbrk(8*PGSIZE);
+    if(a == (char*)-1){
+      printf("%s: sbrk failed\n", s);
+      exit(1);
+    }
+    for(i = 0; i < 8; i++){
+      if(a[i*PGSIZE] != 0){
+        printf("%s: page %d not zero after sbrk\n", s, i);
+        exit(1);
+      }
+      a[i*PGSIZE] = 1 + round;
+    }
+    sleep(round % 2);   // perhaps move to another hart
+    sbrk(-8*PGSIZE);
+
+    pid = fork();
+    if(pid < 0){
+      printf("%s: fork failed\n", s);
+      exit(1);
+    }
+    if(pid == 0){
+      a = sbrk(PGSIZE);
+      a[0] = 1;
+      sbrk(-PGSIZE);
+      a[0] = 2;   // should be killed here
+      exit(0);
+    }
+    wait(&xstatus);
+    if(xstatus != -1){
+      printf("%s: freed memory still usable\n", s);
+      exit(1);
+    }
+  }
+}
+
+// a big sbrk() gets 2 MB superpages; fork() has to copy them,
+// and shrinking into one has to split it.
+void
+superpagetest(char *s)
+{
+  char *a, *top;
+  uint64 n, i;
+  int pid, xstatus;
+
+  // start at a 2 MB boundary so that superpages are possible.
+  top = sbrk(0);
+  n = ((uint64)top + (1 << 21) - 1) / (1 << 21) * (1 << 21) - (uint64)top;
+  if(sbrk(n) == (char*)-1){
+    printf("%s: sbrk failed\n", s);
+    exit(1);
+  }
+  a = sbrk(3 << 21);
+  if(a == (char*)-1){
+    printf("%s: sbrk failed\n", s);
+    exit(1);
+  }
+  for(i = 0; i < (3 << 21); i += 512)
+    a[i] = i / 512;
+
+  pid = fork();
+  if(pid < 0){
+    printf("%s: fork failed\n", s);
+    exit(1);
+  }
+  if(pid == 0){
+    for(i = 0; i < (3 << 21); i += 512){
+      if(a[i] != (char)(i / 512)){
+        printf("%s: child saw wrong data\n", s);
+        exit(1);
+      }
+      a[i] = 0;
+    }
+    exit(0);
+  }
+  wait(&xstatus);
+  if(xstatus != 0)
+    exit(1);
+
+  // give back half a superpage, then grow again.
+  sbrk(-(1 << 20) - (1 << 21));
+  for(i = 0; i < (1 << 21) + (1 << 20); i += 512){
+    if(a[i] != (char)(i / 512)){
+      printf("%s: data changed\n", s);
+      exit(1);
+    }
+  }
+  a = sbrk(1 << 20);
+  for(i = 0; i < (1 << 20); i++){
+    if(a[i] != 0){
+      printf("%s: new memory not zero\n", s);
+      exit(1);
+    }
+  }
+  sbrk(-(2 << 21) - n);
+}
+
+// mmap() of a file, private and shared, and of zeroed memory.
+// read() and write() with a buffer in mmap()ed pages not yet
+// touched: into a pipe, whose lock is a spinlock, and from and
+// to the mapped files themselves and each other.
+void
+mmapcopy(char *s)
+{
+  static char buf[PGSIZE];
+  char *a, *b;
+  int fa, fb, p[2], i;
+
+  for(i = 0; i < PGSIZE; i++)
+    buf[i] = 'a' + i % 19;
+  fa = open("mmapcopy.a", O_CREATE|O_RDWR);
+  fb = open("mmapcopy.b", O_CREATE|O_RDWR);
+  if(fa < 0 || fb < 0 || write(fa, buf, PGSIZE) != PGSIZE || write(fb, buf, PGSIZE) != PGSIZE){
+    printf("%s: create failed\n", s);
+    exit(1);
+  }
+  a = mmap(0, PGSIZE, PROT_READ|PROT_WRITE, MAP_SHARED, fa, 0);
+  b = mmap(0, PGSIZE, PROT_READ|PROT_WRITE, MAP_PRIVATE, fb, 0);
+  if(a == MAP_FAILED || b == MAP_FAILED || pipe(p) < 0){
+    printf("%s: mmap or pipe failed\n", s);
+    exit(1);
+  }
+  if(write(p[1], "xyz", 3) != 3 || read(p[0], a, 3) != 3 || memcmp(a, "xyz", 3) != 0){
+    printf("%s: pipe read into a mapping failed\n", s);
+    exit(1);
+  }
+  if(write(p[1], b, 100) != 100 || read(p[0], buf, 100) != 100 || memcmp(buf, b, 100) != 0){
+    printf("%s: pipe write from a mapping failed\n", s);
+    exit(1);
+  }
+  // a file into its own mapping, and into the other's.
+  close(fa);
+  close(fb);
+  fa = open("mmapcopy.a", O_RDWR);
+  fb = open("mmapcopy.b", O_RDONLY);
+  if(fa < 0 || fb < 0 || read(fa, a + 100, 50) != 50 || read(fb, a + 200, 50) != 50 ||
+     write(fa, b + 10, 20) != 20){
+    printf("%s: file read into a mapping failed\n", s);
+    exit(1);
+  }
+  munmap(a, PGSIZE);
+  munmap(b, PGSIZE);
+  close(p[0]);
+  close(p[1]);
+  close(fa);
+  close(fb);
+  unlink("mmapcopy.a");
+  unlink("mmapcopy.b");
+}
+
+void
+mmaptest(char *s)
+{
+  static char buf[2*PGSIZE + 100];
+  char *a, *b;
+  int fd, fd2, i, pid, xstatus;
+  int n = sizeof(buf);
+
+  for(i = 0; i < n; i++)
+    buf[i] = 'a' + i % 23;
+  fd = open("mmap1", O_CREATE|O_RDWR);
+  if(fd < 0 || write(fd, buf, n) != n){
+    printf("%s: create mmap1 failed\n", s);
+    exit(1);
+  }
+
+  // private: the file's contents, zeroed past its end,
+  // and writes stay here.
+  a = mmap(0, 3*PGSIZE, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+  if(a == MAP_FAILED){
+    printf("%s: mmap private failed\n", s);
+    exit(1);
+  }
+  if(memcmp(a, buf, n) != 0 || a[n] != 0 || a[3*PGSIZE-1] != 0){
+    printf("%s: private mapping has wrong contents\n", s);
+    exit(1);
+  }
+  a[0] = 'X';
+
+  // the child gets a copy, including what we wrote.
+  pid = fork();
+  if(pid == 0){
+    exit(a[0] == 'X' && a[PGSIZE] == buf[PGSIZE] ? 0 : 1);
+  }
+  wait(&xstatus);
+  if(xstatus != 0){
+    printf("%s: child saw wrong mapping\n", s);
+    exit(1);
+  }
+  if(munmap(a, 3*PGSIZE) != 0){
+    printf("%s: munmap failed\n", s);
+    exit(1);
+  }
+
+  // shared: writes reach the file, but don't make it longer.
+  b = mmap(0, 3*PGSIZE, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+  if(b == MAP_FAILED){
+    printf("%s: mmap shared failed\n", s);
+    exit(1);
+  }
+  if(b[0] != 'a'){
+    printf("%s: private write reached the file\n", s);
+    exit(1);
+  }
+  b[1] = 'Y';
+  b[PGSIZE + 1] = 'Z';
+  b[n + 10] = 'W';
+  // read() into a mapping.
+  fd2 = open("mmap1", O_RDONLY);
+  if(read(fd2, b + 2*PGSIZE, 10) != 10 || b[2*PGSIZE] != 'a'){
+    printf("%s: read into mapping failed\n", s);
+    exit(1);
+  }
+  close(fd2);
+  munmap(b, PGSIZE);
+  munmap(b + PGSIZE, 2*PGSIZE);
+  close(fd);
+
+  fd = open("mmap1", O_RDONLY);
+  if(read(fd, buf, sizeof(buf)) != n || buf[1] != 'Y' ||
+     buf[PGSIZE+1] != 'Z' || read(fd, buf, 1) != 0){
+    printf("%s: shared writes didn't reach the file\n", s);
+    exit(1);
+  }
+
+  // a read-only file can't have a shared writable mapping.
+  if(mmap(0, PGSIZE, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0) != MAP_FAILED){
+    printf("%s: mmap of read-only file for writing succeeded\n", s);
+    exit(1);
+  }
+  close(fd);
+  unlink("mmap1");
+
+  // anonymous memory; touching it after munmap() is fatal.
+  a = mmap(0, 10*PGSIZE, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+  if(a == MAP_FAILED){
+    printf("%s: mmap anonymous failed\n", s);
+    exit(1);
+  }
+  for(i = 0; i < 10*PGSIZE; i += PGSIZE){
+    if(a[i] != 0){
+      printf("%s: anonymous memory not zero\n", s);
+      exit(1);
+    }
+    a[i] = 1;
+  }
+  munmap(a + 4*PGSIZE, 2*PGSIZE);
+  if(a[3*PGSIZE] != 1 || a[6*PGSIZE] != 1){
+    printf("%s: munmap of the middle lost data\n", s);
+    exit(1);
+  }
+  pid = fork();
+  if(pid == 0){
+    a[5*PGSIZE] = 1;
+    exit(0);
+  }
+  wait(&xstatus);
+  if(xstatus != -1){
+    printf("%s: unmapped memory still usable\n", s);
+    exit(1);
+  }
+  munmap(a, 10*PGSIZE);
+}
+
+// file data in the page cache: shared mappings are the
+// cached pages themselves, and truncation forgets them.
+void
+pagecachetest(char *s)
+{
+  static char buf[4*PGSIZE];
+  char *a;
+  int fd, fd2, i, pid, xstatus;
+
+  for(i = 0; i < sizeof(buf); i++)
+    buf[i] = 'a' + i % 13;
+  fd = open("pcache1", O_CREATE|O_RDWR);
+  if(fd < 0 || write(fd, buf, sizeof(buf)) != sizeof(buf)){
+    printf("%s: create pcache1 failed\n", s);
+    exit(1);
+  }
+  a = mmap(0, sizeof(buf), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+  if(a == MAP_FAILED){
+    printf("%s: mmap failed\n", s);
+    exit(1);
+  }
+  if(a[0] != 'a' || a[3*PGSIZE] != buf[3*PGSIZE]){
+    printf("%s: mapping has wrong contents\n", s);
+    exit(1);
+  }
+
+  // a child's store is visible here at once, through our own
+  // mapping and through read().
+  pid = fork();
+  if(pid == 0){
+    a[0] = 'X';
+    a[3*PGSIZE] = 'Y';
+    exit(0);
+  }
+  wait(&xstatus);
+  if(xstatus != 0 || a[0] != 'X' || a[3*PGSIZE] != 'Y'){
+    printf("%s: child's store not seen\n", s);
+    exit(1);
+  }
+
+  // and so is write().
+  fd2 = open("pcache1", O_RDWR);
+  if(read(fd2, buf, PGSIZE + 5) != PGSIZE + 5 || write(fd2, "Z", 1) != 1 ||
+     a[PGSIZE + 5] != 'Z'){
+    printf("%s: write() not seen in mapping\n", s);
+    exit(1);
+  }
+  close(fd2);
+  munmap(a, sizeof(buf));
+  close(fd);
+
+  // reading it again comes from the cache; truncating and
+  // rewriting it must not.
+  fd = open("pcache1", O_RDONLY);
+  if(read(fd, buf, sizeof(buf)) != sizeof(buf) || buf[0] != 'X' ||
+     buf[PGSIZE + 5] != 'Z' || buf[3*PGSIZE] != 'Y'){
+    printf("%s: file has wrong contents\n", s);
+    exit(1);
+  }
+  close(fd);
+  fd = open("pcache1", O_TRUNC|O_RDWR);
+  if(fd < 0 || write(fd, "new", 3) != 3){
+    printf("%s: truncate pcache1 failed\n", s);
+    exit(1);
+  }
+  close(fd);
+  fd = open("pcache1", O_RDONLY);
+  memset(buf, 0, sizeof(buf));
+  if(read(fd, buf, sizeof(buf)) != 3 || strcmp(buf, "new") != 0){
+    printf("%s: stale data after truncate\n", s);
+    exit(1);
+  }
+  close(fd);
+  unlink("pcache1");
+}
+
+// printf() buffers its output, and exit() writes it.
+void
+stdiotest(char *s)
+{
+  int fds[2], pid, i, n, tot, xstatus;
+  char buf[64];
+
+  if(pipe(fds) < 0){
+    printf("%s: pipe failed\n", s);
+    exit(1);
+  }
+  pid = fork();
+  if(pid < 0){
+    printf("%s: fork failed\n", s);
+    exit(1);
+  }
+  if(pid == 0){
+    close(1);
+    dup(fds[1]);
+    close(fds[0]);
+    close(fds[1]);
+    setvbuf(1, _IOFBF);
+    for(i = 0; i < 100; i++)
+      printf("%d\n", i % 10);
+    fwrite(1, "end\n", 4);
+    exit(0);
+  }
+  close(fds[1]);
+  tot = 0;
+  while((n = read(fds[0], buf, sizeof(buf))) > 0){
+    for(i = 0; i < n; i++, tot++){
+      if((tot < 200 && buf[i] != (tot % 2 ? '\n' : '0' + tot / 2 % 10)) ||
+         (tot >= 200 && buf[i] != "end\n"[tot - 200])){
+        printf("%s: wrong output at %d\n", s, tot);
+        exit(1);
+      }
+    }
+  }
+  close(fds[0]);
+  wait(&xstatus);
+  if(tot != 204 || xstatus != 0){
+    printf("%s: got %d bytes\n", s, tot);
+    exit(1);
+  }
+}
+
+// threads (clone()) share memory, sbrk() and file
+// descriptors, join() returns their exit status, and
+// exit() in the process ends its threads.
+volatile int tcount[4];
+int tfds[2];
+char *tbrk;
+
+void
+threadadd(void *a)
+{
+  int i, id = (uint64)a;
+
+  for(i = 0; i < 100000; i++)
+    tcount[id]++;
+  if(id == 3)
+    exit(7);
+}
+
+void
+threadmisc(void *a)
+{
+  tbrk = sbrk(PGSIZE);
+  tbrk[0] = 'y';
+  write(tfds[1], "x", 1);
+}
+
+void
+threadspin(void *a)
+{
+  for(;;)
+    ;
+}
+
+void
+threadnop(void *a)
+{
+}
+
+void
+threadtest(char *s)
+{
+  int i, n, tid[4], pid, xstatus;
+  char c;
+
+  for(i = 0; i < 4; i++){
+    if((tid[i] = thread_create(threadadd, (void*)(uint64)i)) < 0){
+      printf("%s: thread_create failed\n", s);
+      exit(1);
+    }
+  }
+  for(i = 0; i < 4; i++){
+    xstatus = thread_join(tid[i]);
+    if(xstatus != (i == 3 ? 7 : 0) || tcount[i] != 100000){
+      printf("%s: thread %d: status %d count %d\n", s, i, xstatus, tcount[i]);
+      exit(1);
+    }
+  }
+  if(join(tid[0], 0) != -1){
+    printf("%s: joined a thread twice\n", s);
+    exit(1);
+  }
+
+  if(pipe(tfds) < 0){
+    printf("%s: pipe failed\n", s);
+    exit(1);
+  }
+  if((tid[0] = thread_create(threadmisc, 0)) < 0 || thread_join(tid[0]) != 0){
+    printf("%s: thread failed\n", s);
+    exit(1);
+  }
+  if(read(tfds[0], &c, 1) != 1 || c != 'x' || tbrk == (char*)-1 || tbrk[0] != 'y'){
+    printf("%s: thread's write or sbrk lost\n", s);
+    exit(1);
+  }
+  close(tfds[0]);
+  close(tfds[1]);
+
+  pid = fork();
+  if(pid < 0){
+    printf("%s: fork failed\n", s);
+    exit(1);
+  }
+  if(pid == 0){
+    for(i = 0; i < 2; i++)
+      if(thread_create(threadspin, 0) < 0)
+        exit(1);
+    sleep(1);
+    exit(5);
+  }
+  wait(&xstatus);
+  if(xstatus != 5){
+    printf("%s: process with threads exited with %d\n", s, xstatus);
+    exit(1);
+  }
+
+  // threads that exited and were never joined are freed with
+  // their process: more of them than proc[] holds.
+  for(n = 0; n < NPROC/3 + 4; n++){
+    pid = fork();
+    if(pid < 0){
+      printf("%s: fork failed after %d processes\n", s, n);
+      exit(1);
+    }
+    if(pid == 0){
+      for(i = 0; i < 3; i++)
+        if(thread_create(threadnop, 0) < 0)
+          exit(1);
+      sleep(1);
+      exit(0);
+    }
+    wait(&xstatus);
+    if(xstatus != 0){
+      printf("%s: thread_create failed after %d processes\n", s, n);
+      exit(1);
+    }
+  }
+}
+
+// futexes, and the mutex and condition variable on them.
+struct mutex fmutex;
+struct cond fcond;
+int fcount, fready, fseen;
+
+void
+futexadd(void *a)
+{
+  int i;
+
+  for(i = 0; i < 10000; i++){
+    mutex_lock(&fmutex);
+    fcount++;
+    mutex_unlock(&fmutex);
+  }
+}
+
+void
+futexwaiter(void *a)
+{
+  mutex_lock(&fmutex);
+  while(!fready)
+    cond_wait(&fcond, &fmutex);
+  fseen = 1;
+  mutex_unlock(&fmutex);
+}
+
+void
+futextest(char *s)
+{
+  int i, tid[4], word = 5;
+
+  if(futex_wait(&word, 6) != -1 || futex_wake(&word, 1) != 0){
+    printf("%s: futex_wait slept on the wrong value\n", s);
+    exit(1);
+  }
+  if(futex_wait((int*)0xffffffffff, 0) != -1){
+    printf("%s: futex_wait on a bad address\n", s);
+    exit(1);
+  }
+
+  for(i = 0; i < 4; i++){
+    if((tid[i] = thread_create(futexadd, 0)) < 0){
+      printf("%s: thread_create failed\n", s);
+      exit(1);
+    }
+  }
+  for(i = 0; i < 4; i++)
+    thread_join(tid[i]);
+  if(fcount != 40000 || fmutex.state != 0){
+    printf("%s: count %d, mutex %d\n", s, fcount, fmutex.state);
+    exit(1);
+  }
+
+  if((tid[0] = thread_create(futexwaiter, 0)) < 0){
+    printf("%s: thread_create failed\n", s);
+    exit(1);
+  }
+  sleep(1);
+  mutex_lock(&fmutex);
+  fready = 1;
+  cond_signal(&fcond);
+  mutex_unlock(&fmutex);
+  thread_join(tid[0]);
+  if(!fseen){
+    printf("%s: condition variable waiter didn't see it\n", s);
+    exit(1);
+  }
+}
+
+// work-stealing tasks: task_for() covers the range once,
+// and spawned tasks nest.
+int tasksum;
+
+void
+taskadd(int lo, int hi, void *arg)
+{
+  int i, s = 0;
+
+  for(i = lo; i < hi; i++)
+    s += i;
+  __sync_fetch_and_add(&tasksum, s);
+}
+
+struct fibarg {
+  int n, r;
+};
+
+void
+taskfib(void *a)
+{
+  struct fibarg *f = a, f1, f2;
+  struct task t;
+
+  if(f->n < 2){
+    f->r = f->n;
+    return;
+  }
+  f1.n = f->n - 1;
+  f2.n = f->n - 2;
+  task_spawn(&t, taskfib, &f1);
+  taskfib(&f2);
+  task_sync(&t);
+  f->r = f1.r + f2.r;
+}
+
+void
+tasktest(char *s)
+{
+  struct fibarg f;
+  int n;
+
+  for(n = 1; n <= 3; n += 2){
+    if(task_start(n) != n){
+      printf("%s: task_start(%d) failed\n", s, n);
+      exit(1);
+    }
+    tasksum = 0;
+    task_for(0, 10000, 7, taskadd, 0);
+    f.n = 18;
+    taskfib(&f);
+    task_stop();
+    if(tasksum != 10000 * 9999 / 2 || f.r != 2584){
+      printf("%s: %d workers: sum %d fib %d\n", s, n, tasksum, f.r);
+      exit(1);
+    }
+  }
+}
+
+// memfd() and MAP_SHARED|MAP_ANONYMOUS memory, shared across
+// fork() and freed with the last mapping.
+void
+shmtest(char *s)
+{
+  char *a, *b;
+  int fd, i, pid, xstatus;
+
+  if((fd = memfd(2*PGSIZE)) < 0){
+    printf("%s: memfd failed\n", s);
+    exit(1);
+  }
+  if(read(fd, &i, 1) != -1 ||
+     mmap(0, PGSIZE, PROT_READ, MAP_PRIVATE, fd, 0) != MAP_FAILED){
+    printf("%s: read or private mmap of memfd worked\n", s);
+    exit(1);
+  }
+  a = mmap(0, 3*PGSIZE, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+  b = mmap(0, 2*PGSIZE, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+  if(a == MAP_FAILED || b == MAP_FAILED){
+    printf("%s: mmap failed\n", s);
+    exit(1);
+  }
+  a[0] = 'a';
+  close(fd);
+
+  pid = fork();
+  if(pid < 0){
+    printf("%s: fork failed\n", s);
+    exit(1);
+  }
+  if(pid == 0){
+    if(a[0] != 'a')
+      exit(1);
+    a[PGSIZE] = 'b';
+    b[PGSIZE+1] = 'c';
+    exit(0);
+  }
+  wait(&xstatus);
+  if(xstatus != 0 || a[PGSIZE] != 'b' || b[PGSIZE+1] != 'c'){
+    printf("%s: child's writes not shared\n", s);
+    exit(1);
+  }
+
+  // past the end of the memfd.
+  pid = fork();
+  if(pid == 0){
+    a[2*PGSIZE] = 1;
+    exit(0);
+  }
+  wait(&xstatus);
+  if(xstatus != -1){
+    printf("%s: write past the end of a memfd worked\n", s);
+    exit(1);
+  }
+  munmap(a, 3*PGSIZE);
+  munmap(b, 2*PGSIZE);
+
+  // more memory than there is, unless it is freed.
+  for(i = 0; i < 300; i++){
+    if((fd = memfd(128*PGSIZE)) < 0 ||
+       (a = mmap(0, 128*PGSIZE, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED){
+      printf("%s: memfd %d failed\n", s, i);
+      exit(1);
+    }
+    close(fd);
+    for(b = a; b < a + 128*PGSIZE; b += PGSIZE)
+      *b = i;
+    munmap(a, 128*PGSIZE);
+  }
+}
+
+// put op on r's submission queue.
+void
+uringsubmit(struct uringpage *r, int op, int fd, void *addr, uint len, uint64 off, uint64 data)
+{
+  struct usqe *e = &r->sq[r->sqtail % URINGSIZE];
+
+  e->op = op;
+  e->fd = fd;
+  e->addr = (uint64)addr;
+  e->len = len;
+  e->off = off;
+  e->data = data;
+  __atomic_store_n(&r->sqtail, r->sqtail + 1, __ATOMIC_RELEASE);
+}
+
+// submit what's queued, wait for n completions, and put
+// their results in res[data].
+void
+uringwait(char *s, struct uringpage *r, int n, int *res)
+{
+  struct ucqe *c;
+
+  if(uring_enter(URINGSIZE, n) < 0){
+    printf("%s: uring_enter failed\n", s);
+    exit(1);
+  }
+  while(n-- > 0){
+    if(r->cqhead == __atomic_load_n(&r->cqtail, __ATOMIC_ACQUIRE)){
+      printf("%s: missing completion\n", s);
+      exit(1);
+    }
+    c = &r->cq[r->cqhead % URINGSIZE];
+    res[c->data] = c->res;
+    __atomic_store_n(&r->cqhead, r->cqhead + 1, __ATOMIC_RELEASE);
+  }
+}
+
+// open, write, fsync and read through the submission and
+// completion queues.
+void
+uringtest(char *s)
+{
+  struct uringpage *r;
+  char buf[16];
+  int fds[2], res[4], fd, pid, xstatus;
+
+  pid = fork();
+  if(pid < 0){
+    printf("%s: fork failed\n", s);
+    exit(1);
+  }
+  if(pid == 0){
+    r = uring_setup(2);
+    if(r == (struct uringpage*)-1 || uring_setup(2) != (struct uringpage*)-1){
+      printf("%s: uring_setup\n", s);
+      exit(1);
+    }
+    unlink("uring1");
+    uringsubmit(r, UR_OPEN, 0, "uring1", O_CREATE|O_RDWR, 0, 0);
+    uringwait(s, r, 1, res);
+    if((fd = res[0]) < 0){
+      printf("%s: open failed\n", s);
+      exit(1);
+    }
+    uringsubmit(r, UR_WRITE, fd, "hello", 5, 0, 0);
+    uringsubmit(r, UR_WRITE, fd, "world", 5, 5, 1);
+    uringsubmit(r, UR_WRITE, 99, "x", 1, 0, 2);
+    uringsubmit(r, UR_FSYNC, fd, 0, 0, 0, 3);
+    uringwait(s, r, 4, res);
+    if(res[0] != 5 || res[1] != 5 || res[2] != -1 || res[3] != 0){
+      printf("%s: writes returned %d %d %d %d\n", s, res[0], res[1], res[2], res[3]);
+      exit(1);
+    }
+    memset(buf, 0, sizeof(buf));
+    uringsubmit(r, UR_READ, fd, buf, sizeof(buf), 0, 0);
+    uringwait(s, r, 1, res);
+    if(res[0] != 10 || strcmp(buf, "helloworld") != 0){
+      printf("%s: read returned %d %s\n", s, res[0], buf);
+      exit(1);
+    }
+
+    // exit() must end a read that will never complete.
+    if(pipe(fds) < 0)
+      exit(1);
+    uringsubmit(r, UR_READ, fds[0], buf, 1, UR_CUROFF, 0);
+    uring_enter(1, 0);
+    exit(0);
+  }
+  wait(&xstatus);
+  unlink("uring1");
+  if(xstatus != 0)
+    exit(1);
+}
+
+// poll() on pipes, with and without a timeout, and pipes
+// with O_NONBLOCK.
+void
+polltest(char *s)
+{
+  struct pollfd pfd[3];
+  int a[2], b[2], n, pid, xstatus;
+  uint64 t0;
+  static char buf[600];
+
+  if(pipe(a) < 0 || pipe2(b, O_NONBLOCK) < 0){
+    printf("%s: pipe failed\n", s);
+    exit(1);
+  }
+  pfd[0].fd = a[0];
+  pfd[0].events = POLLIN;
+  pfd[1].fd = b[0];
+  pfd[1].events = POLLIN;
+  pfd[2].fd = b[1];
+  pfd[2].events = POLLOUT;
+  if(poll(pfd, 2, 0) != 0){
+    printf("%s: empty pipes ready\n", s);
+    exit(1);
+  }
+  t0 = nsecs();
+  if(poll(pfd, 2, 50) != 0 || nsecs() - t0 < 40*1000*1000){
+    printf("%s: timeout wrong\n", s);
+    exit(1);
+  }
+  if(read(b[0], buf, 1) != -1){
+    printf("%s: non-blocking read of an empty pipe worked\n", s);
+    exit(1);
+  }
+
+  pid = fork();
+  if(pid < 0){
+    printf("%s: fork failed\n", s);
+    exit(1);
+  }
+  if(pid == 0){
+    sleep(1);
+    write(a[1], "x", 1);
+    exit(0);
+  }
+  if(poll(pfd, 2, -1) != 1 || pfd[0].revents != POLLIN || pfd[1].revents != 0 ||
+     poll(pfd + 2, 1, 0) != 1 || pfd[2].revents != POLLOUT){
+    printf("%s: poll for a write returned wrong events\n", s);
+    exit(1);
+  }
+  wait(&xstatus);
+
+  // fill b without waiting.
+  if((n = write(b[1], buf, sizeof(buf))) <= 0 || n == sizeof(buf) ||
+     write(b[1], buf, 1) != -1){
+    printf("%s: non-blocking write wrote %d\n", s, n);
+    exit(1);
+  }
+  if(poll(pfd + 1, 2, 0) != 1 || pfd[1].revents != POLLIN || pfd[2].revents != 0){
+    printf("%s: full pipe events wrong\n", s);
+    exit(1);
+  }
+
+  close(a[1]);
+  if(read(a[0], buf, 1) != 1 || poll(pfd, 1, -1) != 1 || pfd[0].revents != POLLHUP){
+    printf("%s: no hangup\n", s);
+    exit(1);
+  }
+  close(b[1]);
+  pfd[2].events = POLLIN;
+  if(poll(pfd + 2, 1, 0) != 1 || pfd[2].revents != POLLNVAL){
+    printf("%s: closed fd not POLLNVAL\n", s);
+    exit(1);
+  }
+  close(a[0]);
+  close(b[0]);
+}
+
+// an epoll set watching a pipe: level-triggered events,
+// waiting, timeouts, and removal.
+void
+epolltest(char *s)
+{
+  struct epoll_event ev, out[2];
+  int ep, a[2], pid, xstatus;
+  uint64 t0;
+  char c;
+
+  if((ep = epoll_create()) < 0 || pipe(a) < 0){
+    printf("%s: epoll_create or pipe failed\n", s);
+    exit(1);
+  }
+  ev.events = POLLIN;
+  ev.data = 77;
+  if(epoll_ctl(ep, EPOLL_CTL_ADD, a[0], &ev) < 0 ||
+     epoll_ctl(ep, EPOLL_CTL_ADD, a[0], &ev) != -1 ||
+     epoll_ctl(ep, EPOLL_CTL_ADD, ep, &ev) != -1){
+    printf("%s: epoll_ctl add wrong\n", s);
+    exit(1);
+  }
+  if(epoll_wait(ep, out, 2, 0) != 0){
+    printf("%s: empty pipe ready\n", s);
+    exit(1);
+  }
+  t0 = nsecs();
+  if(epoll_wait(ep, out, 2, 50) != 0 || nsecs() - t0 < 40*1000*1000){
+    printf("%s: timeout wrong\n", s);
+    exit(1);
+  }
+
+  pid = fork();
+  if(pid < 0){
+    printf("%s: fork failed\n", s);
+    exit(1);
+  }
+  if(pid == 0){
+    sleep(1);
+    write(a[1], "x", 1);
+    exit(0);
+  }
+  if(epoll_wait(ep, out, 2, -1) != 1 || out[0].events != POLLIN || out[0].data != 77){
+    printf("%s: wait for a write returned wrong events\n", s);
+    exit(1);
+  }
+  wait(&xstatus);
+  // still ready until read.
+  if(epoll_wait(ep, out, 2, 0) != 1 || read(a[0], &c, 1) != 1 ||
+     epoll_wait(ep, out, 2, 0) != 0){
+    printf("%s: not level-triggered\n", s);
+    exit(1);
+  }
+
+  ev.data = 78;
+  if(epoll_ctl(ep, EPOLL_CTL_MOD, a[0], &ev) < 0){
+    printf("%s: epoll_ctl mod failed\n", s);
+    exit(1);
+  }
+  close(a[1]);
+  if(epoll_wait(ep, out, 2, -1) != 1 || out[0].events != POLLHUP || out[0].data != 78){
+    printf("%s: no hangup\n", s);
+    exit(1);
+  }
+  if(epoll_ctl(ep, EPOLL_CTL_DEL, a[0], 0) < 0 ||
+     epoll_ctl(ep, EPOLL_CTL_DEL, a[0], 0) != -1 ||
+     epoll_wait(ep, out, 2, 0) != 0){
+    printf("%s: epoll_ctl del wrong\n", s);
+    exit(1);
+  }
+  if(read(ep, &c, 1) != -1){
+    printf("%s: read of an epoll set worked\n", s);
+    exit(1);
+  }
+  close(a[0]);
+  close(ep);
+}
+
+// Unix domain sockets: names, connecting, data both ways,
+// more than a buffer's worth, and hangups.
+void
+socktest(char *s)
+{
+  struct pollfd pfd;
+  struct epoll_event ev;
+  int l, c, a, ep, i, n, pid, xstatus;
+  static char buf[10000];
+  char *name = "socktest.sock";
+
+  unlink(name);
+  if((l = socket(AF_UNIX, SOCK_STREAM)) < 0 || socket(AF_UNIX + 1, SOCK_STREAM) != -1){
+    printf("%s: socket wrong\n", s);
+    exit(1);
+  }
+  if((c = socket(AF_UNIX, SOCK_STREAM)) < 0 || connect(c, name) != -1){
+    printf("%s: connect to nothing worked\n", s);
+    exit(1);
+  }
+  if(bind(l, name) < 0 || bind(c, name) != -1 || open(name, O_RDWR) != -1 ||
+     connect(c, name) != -1){
+    printf("%s: bind wrong\n", s);
+    exit(1);
+  }
+  if(listen(l, 1) < 0 || connect(c, name) < 0){
+    printf("%s: listen or connect failed\n", s);
+    exit(1);
+  }
+  pfd.fd = l;
+  pfd.events = POLLIN;
+  if(poll(&pfd, 1, 0) != 1 || (a = accept(l)) < 0 || poll(&pfd, 1, 0) != 0){
+    printf("%s: accept failed\n", s);
+    exit(1);
+  }
+  if(write(c, "ping", 4) != 4 || read(a, buf, sizeof(buf)) != 4 || memcmp(buf, "ping", 4) != 0 ||
+     write(a, "pong", 4) != 4 || read(c, buf, sizeof(buf)) != 4 || memcmp(buf, "pong", 4) != 0){
+    printf("%s: data wrong\n", s);
+    exit(1);
+  }
+
+  // more than fits in the buffer.
+  pid = fork();
+  if(pid < 0){
+    printf("%s: fork failed\n", s);
+    exit(1);
+  }
+  if(pid == 0){
+    for(i = 0; i < sizeof(buf); i++)
+      buf[i] = i % 251;
+    exit(write(a, buf, sizeof(buf)) != sizeof(buf));
+  }
+  close(a);
+  for(i = 0; i < sizeof(buf); i += n){
+    if((n = read(c, buf + i, sizeof(buf) - i)) <= 0){
+      printf("%s: read returned %d\n", s, n);
+      exit(1);
+    }
+  }
+  for(i = 0; i < sizeof(buf); i++){
+    if(buf[i] != (char)(i % 251)){
+      printf("%s: wrong byte at %d\n", s, i);
+      exit(1);
+    }
+  }
+  wait(&xstatus);
+  if(xstatus != 0){
+    printf("%s: write failed\n", s);
+    exit(1);
+  }
+  // the child had the other end.
+  if(read(c, buf, 1) != 0 || write(c, buf, 1) != -1){
+    printf("%s: no hangup\n", s);
+    exit(1);
+  }
+  close(c);
+
+  // an epoll set watching a socket from before it connects.
+  if((ep = epoll_create()) < 0 || (c = socket(AF_UNIX, SOCK_STREAM)) < 0){
+    printf("%s: epoll_create or socket failed\n", s);
+    exit(1);
+  }
+  ev.events = POLLIN;
+  ev.data = 5;
+  if(epoll_ctl(ep, EPOLL_CTL_ADD, c, &ev) < 0 || epoll_wait(ep, &ev, 1, 0) != 0 ||
+     connect(c, name) < 0 || (a = accept(l)) < 0 || write(a, "x", 1) != 1 ||
+     epoll_wait(ep, &ev, 1, 1000) != 1 || ev.data != 5){
+    printf("%s: epoll missed a socket's data\n", s);
+    exit(1);
+  }
+  close(ep);
+  close(a);
+  close(c);
+  close(l);
+  if(unlink(name) < 0){
+    printf("%s: unlink failed\n", s);
+    exit(1);
+  }
+}
+
 //
 // use sbrk() to count how many free physical memory pages there are.
 // touches the pages to force allocation.
@@ -2693,6 +4119,27 @@ main(int argc, char *argv[])
     {dirfile, "dirfile"},
     {iref, "iref"},
     {forktest, "forktest"},
+    {nanosleeptest, "nanosleep"},
+    {tracetest, "trace"},
+    {syslattest, "syslat"},
+    {vdsotest, "vdso"},
+    {memopstest, "memops"},
+    {xregstest, "xregs"},
+    {ucopytest, "ucopy"},
+    {tlbtest, "tlb"},
+    {superpagetest, "superpage"},
+    {mmaptest, "mmap"},
+    {mmapcopy, "mmapcopy"},
+    {pagecachetest, "pagecache"},
+    {stdiotest, "stdio"},
+    {threadtest, "thread"},
+    {futextest, "futex"},
+    {tasktest, "task"},
+    {shmtest, "shm"},
+    {uringtest, "uring"},
+    {polltest, "poll"},
+    {epolltest, "epoll"},
+    {socktest, "sock"},
     {bigdir, "bigdir"}, // slow
     { 0, 0},
   };
@@ -6,24 +6,27 @@ print "# generated by usys.pl - do not edit\n";
 
 print "#include \"kernel/syscall.h\"\n";
 
+# entry("name", "label") names the stub label instead: ulib.c
+# wraps those calls, to flush printf()'s buffers first.
 sub entry {
     my $name = shift;
-    print ".global $name\n";
-    print "${name}:\n";
+    my $label = @_ ? shift : $name;
+    print ".global $label\n";
+    print "${label}:\n";
     print " li a7, SYS_${name}\n";
     print " ecall\n";
     print " ret\n";
 }
 	
-entry("fork");
-entry("exit");
+entry("fork", "_fork");
+entry("exit", "_exit");
 entry("wait");
 entry("pipe");
-entry("read");
+entry("read", "_read");
 entry("write");
 entry("close");
 entry("kill");
-entry("exec");
+entry("exec", "_exec");
 entry("open");
 entry("mknod");
 entry("unlink");
@@ -32,7 +35,32 @@ entry("link");
 entry("mkdir");
 entry("chdir");
 entry("dup");
-entry("getpid");
 entry("sbrk");
 entry("sleep");
-entry("uptime");
+entry("clock_gettime");
+entry("nanosleep");
+entry("getlockstat");
+entry("resetlockstat");
+entry("trace");
+entry("traceread");
+entry("getsyslat");
+entry("resetsyslat");
+entry("mmap");
+entry("munmap");
+entry("clone");
+entry("join");
+entry("futex_wait");
+entry("futex_wake");
+entry("memfd");
+entry("uring_setup");
+entry("uring_enter");
+entry("pipe2");
+entry("poll");
+entry("epoll_create");
+entry("epoll_ctl");
+entry("epoll_wait");
+entry("socket");
+entry("bind");
+entry("listen");
+entry("accept");
+entry("connect");